@@ -79,9 +79,22 @@ void AMantleActor::RegisterWithMantle()
 		return;
 	}
 
+	// Actors can be spawned while an async engine loop is running. In that case the entity is added (and the actor
+	// components are initialized) at the start of the engine's next game thread loop.
+	MantleDB->ExecuteOrQueue([WeakThis = TWeakObjectPtr<AMantleActor>(this)](UMantleDB& QueuedDB)
+	{
+		if (WeakThis.IsValid())
+		{
+			WeakThis->AddMantleEntity(QueuedDB);
+		}
+	});
+}
+
+void AMantleActor::AddMantleEntity(UMantleDB& QueuedDB)
+{
 	TArray<FInstancedStruct> MantleComponents;
 	InitializeMantleComponents(MantleComponents);
-	FGuid EntityId = MantleDB->AddEntity(MantleComponents);
+	FGuid EntityId = QueuedDB.AddEntity(MantleComponents);
 	if(!EntityId.IsValid())
 	{
 		ANANKE_LOG_OBJECT(this, LogMantle, Error, TEXT("Expected AddEntity to have a valid result."));
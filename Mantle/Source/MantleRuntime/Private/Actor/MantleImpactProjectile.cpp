@@ -39,7 +39,6 @@
 #include "MantleComponents/MC_Owner.h"
 #include "MantleComponents/MC_SimpleImpactDamage.h"
 #include "MantleRuntimeLoggingDefs.h"
-#include "FunctionLibraries/MantleEntityLibrary.h"
 #include "MantleComponents/MC_TemporaryEntity.h"
 
 AMantleImpactProjectile::AMantleImpactProjectile(const FObjectInitializer& Initializer): Super(Initializer)
@@ -55,22 +54,18 @@ AMantleImpactProjectile::AMantleImpactProjectile(const FObjectInitializer& Initi
 	bRemoveEntityOnDestruction = true;
 }
 
-void AMantleImpactProjectile::PostInitializeComponents()
+void AMantleImpactProjectile::InitializeActorComponents(FGuid& EntityId)
 {
-	Super::PostInitializeComponents();
-	
-	if (!bIsRegisteredWithMantle)
-	{
-		return;
-	}
+	Super::InitializeActorComponents(EntityId);
 
 	// Note: GetOwner will return whatever actor is specified as the owner when this projectile is spawned using the
 	//       SpawnActor blueprint node.
-	if (UMantleAvatarComponent* OwnerAvatar = UMantleEntityLibrary::GetAvatarFromActor(GetOwner()))
+	FGuid OwnerEntityId = MantleDB->FindEntityByActor(GetOwner());
+	if (OwnerEntityId.IsValid())
 	{
-		if (FMC_Owner* OwnerComponent = MantleDB->GetComponent<FMC_Owner>(AvatarComponent->GetEntityId()))
+		if (FMC_Owner* OwnerComponent = MantleDB->GetComponent<FMC_Owner>(EntityId))
 		{
-			OwnerComponent->EntityId = OwnerAvatar->GetEntityId();
+			OwnerComponent->EntityId = OwnerEntityId;
 		}
 	}
 }
@@ -129,17 +124,22 @@ bool AMantleImpactProjectile::ProcessMantleCollision(AActor* OtherActor)
 		return false;
 	}
 	
-	if (UMantleAvatarComponent* OtherAvatar = UMantleEntityLibrary::GetAvatarFromActor(OtherActor))
+	FGuid OtherEntityId = MantleDB->FindEntityByActor(OtherActor);
+	if (!OtherEntityId.IsValid())
 	{
-		if (FMC_Collision* Collision = MantleDB->GetComponent<FMC_Collision>(AvatarComponent->GetEntityId()))
-		{
-			Collision->Entities.Add(OtherAvatar->GetEntityId());
-			return true;
-		}
-
-		ANANKE_LOG_OBJECT(this, LogMantle, Error, TEXT("Expected valid FMC_Collision"));
+		return false;
 	}
 
-	return false;
+	// Hit events can arrive while the engine is running operations, so the collision is recorded by a queued command
+	// instead of writing to the component directly.
+	MantleDB->QueueComponentUpdate<FMC_Collision>(
+		AvatarComponent->GetEntityId(),
+		[OtherEntityId](FMC_Collision& Collision)
+		{
+			Collision.Entities.Add(OtherEntityId);
+		}
+	);
+	
+	return true;
 }
 
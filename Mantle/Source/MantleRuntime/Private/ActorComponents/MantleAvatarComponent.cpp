@@ -68,16 +68,22 @@ void UMantleAvatarComponent::MaybeRemoveEntityComponent()
 		return;
 	}
 	
-	auto* Avatar = MantleDB->GetComponent<FMC_AvatarActor>(EntityId);
-
-	// Do nothing if the entity no longer has an avatar or if some other actor represents the entity now.
-	if (!Avatar || Avatar->GetAvatarActor() != GetOwner())
+	// Components are often destroyed while an async engine loop is running (e.g. when an actor is destroyed by a hit
+	// event), in which case the entity is updated at the start of the engine's next game thread loop.
+	MantleDB->ExecuteOrQueue([EntityId = EntityId, WeakOwner = TWeakObjectPtr<AActor>(GetOwner())](UMantleDB& QueuedDB)
 	{
-		return;
-	}
+		auto* Avatar = QueuedDB.GetComponent<FMC_AvatarActor>(EntityId);
+
+		// Do nothing if the entity no longer has an avatar or if some other actor represents the entity now.
+		if (!Avatar || Avatar->GetAvatarActor() != WeakOwner.Get())
+		{
+			return;
+		}
 
-	const bool bRemoveOldComponent = false; // This component is already being destroyed, no need to call Destroy again.
-	UMantleEntityLibrary::ClearEntityAvatar(MantleDB.Get(), EntityId, bRemoveOldComponent);
+		const bool bRemoveOldComponent = false; // This component is already being destroyed, no need to call Destroy again.
+		FGuid AvatarEntityId = EntityId;
+		UMantleEntityLibrary::ClearEntityAvatar(&QueuedDB, AvatarEntityId, bRemoveOldComponent);
+	});
 }
 
 void UMantleAvatarComponent::MaybeRemoveEntity()
@@ -91,12 +97,15 @@ void UMantleAvatarComponent::MaybeRemoveEntity()
 		return;
 	}
 	
-	if (auto* TemporaryEntity = MantleDB->GetComponent<FMC_TemporaryEntity>(EntityId))
+	MantleDB->ExecuteOrQueue([EntityId = EntityId](UMantleDB& QueuedDB)
 	{
-		TemporaryEntity->bReadyForDeletion = true;
-	}
-	else
-	{
-		MantleDB->RemoveEntity(EntityId);
-	}
+		if (auto* TemporaryEntity = QueuedDB.GetComponent<FMC_TemporaryEntity>(EntityId))
+		{
+			TemporaryEntity->bReadyForDeletion = true;
+		}
+		else
+		{
+			QueuedDB.RemoveEntity(EntityId);
+		}
+	});
 }
\ No newline at end of file
@@ -0,0 +1,167 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "ActorComponents/MantleViewpointPublisherComponent.h"
+
+#include "MantleRuntimeLoggingDefs.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Foundation/MantleEngine.h"
+#include "GameFramework/Controller.h"
+#include "Macros/AnankeCoreLoggingMacros.h"
+#include "MantleComponents/MC_Viewpoint.h"
+#include "Operations/MO_ViewpointCollector.h"
+
+UMantleViewpointPublisherComponent::UMantleViewpointPublisherComponent(const FObjectInitializer& Initializer)
+	: Super(Initializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = true;
+}
+
+void UMantleViewpointPublisherComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Publish after the owner has updated its view for this frame.
+	PrimaryComponentTick.AddPrerequisite(GetOwner(), GetOwner()->PrimaryActorTick);
+	
+	auto* MantleEngine = UGameInstance::GetSubsystem<UMantleEngine>(GetWorld()->GetGameInstance());
+	if (!MantleEngine)
+	{
+		ANANKE_LOG_OBJECT(this, LogMantle, Error, TEXT("Expected valid MantleEngine instance."));
+		return;
+	}
+
+	MantleDB = MantleEngine->GetDB();
+	ViewpointCollector = MantleEngine->GetOperation<UMO_ViewpointCollector>();
+
+	if (!ViewpointCollector.IsValid())
+	{
+		ANANKE_LOG_OBJECT(this, LogMantle, Warning, TEXT("No viewpoint collector found; viewpoints will not be published."));
+		return;
+	}
+
+	// The entity may have been assigned before BeginPlay.
+	SetViewpointUpdateMode(EMantleViewpointUpdateMode::Push);
+}
+
+void UMantleViewpointPublisherComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ClearViewpointEntity();
+	
+	Super::EndPlay(EndPlayReason);
+}
+
+void UMantleViewpointPublisherComponent::SetViewpointEntity(FGuid NewEntityId)
+{
+	ClearViewpointEntity();
+	
+	EntityId = NewEntityId;
+	bHasPublished = false;
+
+	if (ViewpointCollector.IsValid())
+	{
+		SetViewpointUpdateMode(EMantleViewpointUpdateMode::Push);
+	}
+}
+
+void UMantleViewpointPublisherComponent::ClearViewpointEntity()
+{
+	// Hand the viewpoint back to the collector.
+	SetViewpointUpdateMode(EMantleViewpointUpdateMode::Poll);
+	EntityId = FGuid();
+}
+
+void UMantleViewpointPublisherComponent::TickComponent(
+	float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!EntityId.IsValid() || !ViewpointCollector.IsValid())
+	{
+		return;
+	}
+
+	FVector Location;
+	FRotator Rotation;
+	if (!GetOwnerViewPoint(Location, Rotation))
+	{
+		return;
+	}
+
+	if (
+		bHasPublished &&
+		FVector::DistSquared(Location, LastPublishedLocation) <= FMath::Square(LocationTolerance) &&
+		Rotation.Equals(LastPublishedRotation, RotationToleranceDeg)
+	)
+	{
+		return;
+	}
+
+	ViewpointCollector->PublishViewpoint(EntityId, Location, Rotation);
+	LastPublishedLocation = Location;
+	LastPublishedRotation = Rotation;
+	bHasPublished = true;
+}
+
+bool UMantleViewpointPublisherComponent::GetOwnerViewPoint(FVector& OutLocation, FRotator& OutRotation) const
+{
+	if (const APlayerCameraManager* CameraManager = Cast<APlayerCameraManager>(GetOwner()))
+	{
+		CameraManager->GetCameraViewPoint(OutLocation, OutRotation);
+		return true;
+	}
+	if (const AController* Controller = Cast<AController>(GetOwner()))
+	{
+		Controller->GetPlayerViewPoint(OutLocation, OutRotation);
+		return true;
+	}
+
+	ANANKE_LOG_PERIODIC(Error, TEXT("Viewpoint publisher must be owned by a controller or a camera manager."), 1.0);
+	return false;
+}
+
+void UMantleViewpointPublisherComponent::SetViewpointUpdateMode(EMantleViewpointUpdateMode NewMode)
+{
+	if (!EntityId.IsValid() || !MantleDB.IsValid())
+	{
+		return;
+	}
+
+	// Viewpoints can be handed over while an async engine loop is running.
+	MantleDB->ExecuteOrQueue([EntityId = EntityId, NewMode](UMantleDB& QueuedDB)
+	{
+		if (FMC_Viewpoint* Viewpoint = QueuedDB.GetComponent<FMC_Viewpoint>(EntityId))
+		{
+			Viewpoint->UpdateMode = NewMode;
+		}
+	});
+}
@@ -0,0 +1,142 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/MantleAsyncOperation.h"
+
+#include "MantleRuntimeLoggingDefs.h"
+
+void FMantleAsyncCommandBuffer::TrackEntity(const UMantleDB& MantleDB, const FGuid& EntityId)
+{
+	if (const FMantleEntity* Entity = MantleDB.FindEntity(EntityId))
+	{
+		TrackedGenerations.Add(EntityId, Entity->Generation);
+	}
+}
+
+void FMantleAsyncCommandBuffer::TrackEntities(const UMantleDB& MantleDB, TConstArrayView<FGuid> EntityIds)
+{
+	TrackedGenerations.Reserve(TrackedGenerations.Num() + EntityIds.Num());
+	for (const FGuid& EntityId : EntityIds)
+	{
+		TrackEntity(MantleDB, EntityId);
+	}
+}
+
+int32 FMantleAsyncCommandBuffer::Apply(UMantleDB& MantleDB)
+{
+	int32 NumSkipped = 0;
+	for (FEntityCommand& EntityCommand : Commands)
+	{
+		if (EntityCommand.EntityId.IsValid() && IsStale(MantleDB, EntityCommand.EntityId))
+		{
+			NumSkipped++;
+			continue;
+		}
+		
+		EntityCommand.Command(MantleDB);
+	}
+
+	Commands.Empty();
+	return NumSkipped;
+}
+
+bool FMantleAsyncCommandBuffer::IsStale(const UMantleDB& MantleDB, const FGuid& EntityId) const
+{
+	const FMantleEntity* Entity = MantleDB.FindEntity(EntityId);
+	if (!Entity)
+	{
+		return true;
+	}
+
+	// Entities that weren't tracked at launch are only checked for existence.
+	const uint32* TrackedGeneration = TrackedGenerations.Find(EntityId);
+	return TrackedGeneration && *TrackedGeneration != Entity->Generation;
+}
+
+void UMantleAsyncOperation::PerformOperation(FMantleOperationContext& Ctx)
+{
+	if (IsTaskInFlight())
+	{
+		return;
+	}
+
+	TSharedRef<FMantleAsyncCommandBuffer, ESPMode::ThreadSafe> Results =
+		MakeShared<FMantleAsyncCommandBuffer, ESPMode::ThreadSafe>();
+	Results->LaunchFrame = GFrameCounter;
+	
+	FMantleAsyncTask Task = LaunchTask(Ctx, *Results);
+	if (!Task)
+	{
+		PendingTask = UE::Tasks::FTask();
+		PendingResults.Reset();
+		return;
+	}
+
+	Results->bIsPending = true;
+	PendingResults = Results;
+
+	// The task doesn't reference the operation or the DB, only the DB's command queue, so it is fine for either to be
+	// destroyed while it is running.
+	TSharedRef<FMantleCommandQueue, ESPMode::ThreadSafe> CommandQueue = Ctx.MantleDB->GetSharedCommandQueue();
+	PendingTask = UE::Tasks::Launch(
+		UE_SOURCE_LOCATION,
+		[Task = MoveTemp(Task), Results, CommandQueue, MaxAge = MaxResultAgeFrames]() mutable
+		{
+			Task(*Results);
+
+			if (Results->IsEmpty())
+			{
+				Results->bIsPending = false;
+				return;
+			}
+
+			CommandQueue->Enqueue([Results, MaxAge](UMantleDB& MantleDB)
+			{
+				if (MaxAge > 0 && GFrameCounter - Results->LaunchFrame > static_cast<uint64>(MaxAge))
+				{
+					UE_LOG(LogMantle, Verbose, TEXT("Dropping %d async results that are too old."), Results->Num());
+				}
+				else
+				{
+					Results->Apply(MantleDB);
+				}
+
+				Results->bIsPending = false;
+			});
+		}
+	);
+}
+
+FMantleAsyncTask UMantleAsyncOperation::LaunchTask(FMantleOperationContext& Ctx, FMantleAsyncCommandBuffer& Results)
+{
+	UE_LOG(LogMantle, Fatal, TEXT("LaunchTask must be overriden."));
+	return FMantleAsyncTask();
+}
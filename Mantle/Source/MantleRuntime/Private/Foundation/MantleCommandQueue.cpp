@@ -0,0 +1,72 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/MantleCommandQueue.h"
+
+#include "Foundation/MantleDB.h"
+
+int32 FMantleCommandQueue::Drain(UMantleDB& MantleDB)
+{
+	int32 NumCommands = 0;
+	
+	while (TOptional<FMantleCommand> Command = Commands.Dequeue())
+	{
+		(*Command)(MantleDB);
+		NumCommands++;
+	}
+
+	return NumCommands;
+}
+
+int32 FMantleCommandBuffer::Playback(UMantleDB& MantleDB)
+{
+	// Commands may defer more commands (for example when an operation is run without an engine loop), so take the list
+	// before running anything.
+	TArray<FMantleCommand> CommandsToRun = MoveTemp(Commands);
+	Commands.Reset();
+
+	for (FMantleCommand& Command : CommandsToRun)
+	{
+		Command(MantleDB);
+	}
+
+	return CommandsToRun.Num();
+}
+
+void FMantleCommandBuffer::MoveTo(FMantleCommandQueue& Queue)
+{
+	for (FMantleCommand& Command : Commands)
+	{
+		Queue.Enqueue(MoveTemp(Command));
+	}
+
+	Commands.Reset();
+}
@@ -0,0 +1,171 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/MantleComponentAccess.h"
+
+#include "MantleRuntimeLoggingDefs.h"
+#include "HAL/CriticalSection.h"
+#include "Misc/ScopeLock.h"
+
+namespace
+{
+	thread_local FMantleAccessChecker* GActiveAccessChecker = nullptr;
+
+	// Each violation is only reported once per session to avoid spamming the log every frame.
+	FCriticalSection GReportedViolationsLock;
+	TSet<FString> GReportedViolations;
+	int32 GNumViolations = 0;
+}
+
+void FMantleComponentAccess::AddRead(const UScriptStruct* ComponentType)
+{
+	if (!ComponentType)
+	{
+		UE_LOG(LogMantle, Error, TEXT("FMantleComponentAccess::AddRead: ComponentType is null."));
+		return;
+	}
+	
+	bIsDeclared = true;
+	ReadComponents.Add(ComponentType->GetName());
+}
+
+void FMantleComponentAccess::AddWrite(const UScriptStruct* ComponentType)
+{
+	if (!ComponentType)
+	{
+		UE_LOG(LogMantle, Error, TEXT("FMantleComponentAccess::AddWrite: ComponentType is null."));
+		return;
+	}
+	
+	bIsDeclared = true;
+	WriteComponents.Add(ComponentType->GetName());
+}
+
+bool FMantleComponentAccess::ConflictsWith(const FMantleComponentAccess& Other) const
+{
+	if (IsSyncPoint() || Other.IsSyncPoint())
+	{
+		return true;
+	}
+
+	for (const FString& ComponentName : WriteComponents)
+	{
+		if (Other.CanAccess(ComponentName))
+		{
+			return true;
+		}
+	}
+	for (const FString& ComponentName : Other.WriteComponents)
+	{
+		if (ReadComponents.Contains(ComponentName))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+FMantleAccessChecker::FMantleAccessChecker(const FMantleComponentAccess& NewAccess, const UObject* NewOwner)
+	: Access(NewAccess), Owner(NewOwner)
+{
+	PreviousChecker = GActiveAccessChecker;
+	GActiveAccessChecker = this;
+}
+
+FMantleAccessChecker::~FMantleAccessChecker()
+{
+	GActiveAccessChecker = PreviousChecker;
+}
+
+void FMantleAccessChecker::CheckComponentAccess(const FString& ComponentName, bool bIsWrite)
+{
+	const FMantleAccessChecker* Checker = GActiveAccessChecker;
+	if (!Checker || !Checker->Access.IsDeclared())
+	{
+		return;
+	}
+
+	if (!Checker->Access.CanAccess(ComponentName))
+	{
+		Checker->ReportViolation(FString::Printf(TEXT("accessed undeclared component %s"), *ComponentName));
+	}
+	else if (bIsWrite && !Checker->Access.CanWrite(ComponentName))
+	{
+		// The schedule lets operations that only read a component run alongside each other, so this is a data race.
+		Checker->ReportViolation(
+			FString::Printf(TEXT("wrote to component %s, which it only declared as read"), *ComponentName));
+	}
+}
+
+void FMantleAccessChecker::CheckStructuralChange()
+{
+	const FMantleAccessChecker* Checker = GActiveAccessChecker;
+	if (!Checker || !Checker->Access.IsDeclared())
+	{
+		return;
+	}
+
+	if (!Checker->Access.MakesStructuralChanges())
+	{
+		Checker->ReportViolation(TEXT("made a structural change without declaring it"));
+	}
+}
+
+void FMantleAccessChecker::ReportViolation(const FString& Description) const
+{
+	const FString OwnerName = Owner ? Owner->GetClass()->GetName() : TEXT("Unknown");
+	const FString Violation = FString::Printf(TEXT("%s %s"), *OwnerName, *Description);
+
+	{
+		FScopeLock Lock(&GReportedViolationsLock);
+		GNumViolations++;
+		if (GReportedViolations.Contains(Violation))
+		{
+			return;
+		}
+		GReportedViolations.Add(Violation);
+	}
+
+	UE_LOG(LogMantle, Error, TEXT("Component access violation: operation %s."), *Violation);
+}
+
+int32 FMantleAccessChecker::GetNumViolations()
+{
+	FScopeLock Lock(&GReportedViolationsLock);
+	return GNumViolations;
+}
+
+void FMantleAccessChecker::ResetReportedViolations()
+{
+	FScopeLock Lock(&GReportedViolationsLock);
+	GReportedViolations.Reset();
+}
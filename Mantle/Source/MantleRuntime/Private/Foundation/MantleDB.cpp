@@ -30,12 +30,59 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Foundation/MantleDB.h"
+#include "Foundation/MantleComponentSnapshot.h"
 #include "Foundation/MantleQueries.h"
+#include "Foundation/MantleFrameArena.h"
 #include "Containers/AnankeUntypedArrayView.h"
 
 #include "MantleRuntimeLoggingDefs.h"
 #include "FunctionLibraries/AnankeBitArrayLibrary.h"
+#include "MantleComponents/MC_Avatar.h"
 #include "MantleComponents/MC_TemporaryEntity.h"
+#include "Misc/ScopeRWLock.h"
+#include "CoreGlobals.h"
+
+namespace
+{
+	// Set on the thread that is running an async engine loop, which is allowed to use the DB directly.
+	thread_local bool GIsRunningAsyncLoop = false;
+	
+	// The bare chunk's id column starts out with room for this many entities, and at least doubles when it grows.
+	constexpr int32 kMinBareChunkCapacity = 64;
+
+	// How many rows ahead of the current one to prefetch when gathering components for a list of entities.
+	constexpr int32 kGatherPrefetchDistance = 4;
+
+	struct FGatherRow
+	{
+		const FMantleEntity* Entity = nullptr;
+		int32 EntityIndex = 0;
+	};
+	
+	int32 GetEntityIdsOffset(int32 NumColumns)
+	{
+		// The header is followed by the column offsets and the column change flags.
+		const int32 HeaderSize = static_cast<int32>(sizeof(FMantleDBChunkHeader) + 2 * NumColumns * sizeof(int32));
+		return Align(HeaderSize, Ananke::Mantle::kChunkColumnAlignment);
+	}
+	
+	// Assigns each column its offset within the blob, and returns the number of blob bytes needed for NumEntities
+	// (including the header and the entity id column).
+	int32 LayoutChunkColumns(TArrayView<FMantleComponentInfo> Columns, int32 NumEntities)
+	{
+		int64 NextOffset = GetEntityIdsOffset(Columns.Num()) + static_cast<int64>(sizeof(FGuid)) * NumEntities;
+		for (FMantleComponentInfo& Column : Columns)
+		{
+			const int64 ColumnAlignment = FMath::Max(Column.StructAlignment, Ananke::Mantle::kChunkColumnAlignment);
+			const int64 ColumnStart = Align(NextOffset, ColumnAlignment);
+			
+			Column.ChunkOffset = static_cast<int32>(FMath::Min<int64>(ColumnStart, MAX_int32));
+			NextOffset = ColumnStart + static_cast<int64>(Column.StructSize) * NumEntities;
+		}
+
+		return static_cast<int32>(FMath::Min<int64>(NextOffset, MAX_int32));
+	}
+}
 
 // FMantleDBChunk -------------------------------------------------------------------------------------------------------
 FMantleDBChunk::FMantleDBChunk(
@@ -45,48 +92,31 @@ FMantleDBChunk::FMantleDBChunk(
 	Archetype = NewArchetype;
 	Entry = NewEntry;
 	MasterRecord = NewMasterRecord;
-	
-	int32 BytesPerEntity = 0;
-	int32 MaxPossibleAlignmentPadding = 0;
 
-	// First, compute sizes
-	for (auto Iterator = MasterRecord->ComponentInfoMap.CreateConstIterator(); Iterator; ++Iterator)
+	// The layout is computed once per entry. The blob itself isn't allocated until entities are added.
+	TotalCapacity = Entry->ChunkCapacity;
+}
+
+FMantleDBChunk::~FMantleDBChunk()
+{
+	if (ComponentBlob)
 	{
-		FMantleComponentInfo ComponentInfo = Iterator.Value();
-		if (!ValidateComponentInfo(ComponentInfo))
-		{
-			UE_LOG(LogMantle, Warning, TEXT("Found invalid component (name: %s) while initializing DB chunk. Skipping this component."), *ComponentInfo.Name);
-			continue;
-		}
-		if (!Archetype[ComponentInfo.ArchetypeIndex])
+		const int32 NumEntities = GetNumEntities();
+		for (int32 EntityIndex = 0; EntityIndex < NumEntities; ++EntityIndex)
 		{
-			continue;
+			DestroyComponents(EntityIndex);
 		}
 
-		BytesPerEntity += ComponentInfo.StructSize;
-		MaxPossibleAlignmentPadding += ComponentInfo.StructAlignment;
-		ComponentTypeInfo.Add(Iterator.Key(), ComponentInfo);
-	}
-
-	if (BytesPerEntity > 0)
-	{
-		TotalCapacity = (MasterRecord->ChunkComponentBlobSize - MaxPossibleAlignmentPadding) / BytesPerEntity;
-		if (TotalCapacity <= 0)
+		if (NumEntities > 0)
 		{
-			UE_LOG(LogMantle, Fatal, TEXT("MantleDB does not support entity size."));
-			return;
+			DEC_DWORD_STAT_BY(STAT_Mantle_EntityCount, NumEntities);
 		}
-	}
-}
-
-FMantleDBChunk::~FMantleDBChunk()
-{
-	DeallocateBlob();
 
-	if (EntityIds.Num() > 0)
-	{
-		DEC_DWORD_STAT_BY(STAT_Mantle_EntityCount, EntityIds.Num());
-		EntityIds.Empty();
+		// The master record may already be destroyed at this point, so the blob is freed instead of being pooled.
+		FMemory::Free(ComponentBlob);
+		ComponentBlob = nullptr;
+		MaxLocation = nullptr;
+		BlobSize = 0;
 	}
 }
 
@@ -103,6 +133,11 @@ int32 FMantleDBChunk::AddEntities(
 
 	if (UAnankeBitArrayLibrary::IsZero(Archetype))
 	{
+		if (!ReserveBareEntities(NumEntities))
+		{
+			return 0;
+		}
+
 		RegisterEntities(NumEntities, OutResult);
 		return NumEntities;
 	}
@@ -112,16 +147,16 @@ int32 FMantleDBChunk::AddEntities(
 		return 0;
 	}
 
-	const int32 NumExistingEntities = EntityIds.Num();
+	const int32 NumExistingEntities = GetNumEntities();
 	const int32 NumEntitiesToAdd = FMath::Min(NumEntities, GetRemainingCapacity());
 	RegisterEntities(NumEntitiesToAdd, OutResult);
-	
+
 	for (FInstancedStruct ComponentInstance : ComponentsToAdd)
 	{
 		FString TypeName = ComponentInstance.GetScriptStruct()->GetName();
-		FMantleComponentInfo* ComponentInfo = ComponentTypeInfo.Find(TypeName);
+		const FMantleComponentInfo* ComponentInfo = Entry->FindColumn(TypeName);
 
-		if (!ComponentInfo || !ComponentInfo->ChunkLocation)
+		if (!ComponentInfo)
 		{
 			// todo(): Rollback changes and continue.
 			UE_LOG(LogMantle, Fatal,
@@ -130,10 +165,10 @@ int32 FMantleDBChunk::AddEntities(
 			return 0;
 		}
 
-		uint8* StartingLocation = ComponentInfo->ChunkLocation + (NumExistingEntities * ComponentInfo->StructSize);
+		uint8* StartingLocation = GetColumn(*ComponentInfo) + (NumExistingEntities * ComponentInfo->StructSize);
 		uint8* DestLocation = StartingLocation;
 		const uint8* SrcLocation = ComponentInstance.GetMemory();
-		
+
 		for (int EntityIndex = 0; EntityIndex < NumEntitiesToAdd; EntityIndex++)
 		{
 			if (!LocationIsValid(DestLocation))
@@ -147,19 +182,19 @@ int32 FMantleDBChunk::AddEntities(
 			// immediately overwrite the data with the instance data.
 			ComponentInstance.GetScriptStruct()->InitializeStruct(DestLocation);
 			ComponentInstance.GetScriptStruct()->CopyScriptStruct(DestLocation, SrcLocation); // TODO(): make optional.
-			
+
 			DestLocation += ComponentInfo->StructSize;
 		}
 
 		OutResult.ChunkedComponents.FindOrAdd(TypeName).Add(FAnankeUntypedArrayView(StartingLocation, NumEntitiesToAdd));
 	}
-	
+
 	return NumEntitiesToAdd;
 }
 
 void FMantleDBChunk::RemoveEntity(FMantleEntity& ToRemove, bool bEntityWasMoved)
 {
-	if (ToRemove.Index < 0 || ToRemove.Index >= EntityIds.Num())
+	if (ToRemove.Index < 0 || ToRemove.Index >= GetNumEntities())
 	{
 		UE_LOG(LogMantle, Error, TEXT("Entity %s has invalid index"), *ToRemove.Id.ToString());
 		return;
@@ -168,13 +203,17 @@ void FMantleDBChunk::RemoveEntity(FMantleEntity& ToRemove, bool bEntityWasMoved)
 	bool bWasFull = (GetRemainingCapacity() == 0);
 
 	int32 SwapIndex = ToRemove.Index;
-	int32 LastEntityIndex = EntityIds.Num() - 1;
+	int32 LastEntityIndex = GetNumEntities() - 1;
 
+	FGuid* EntityIds = GetEntityIdData();
 	EntityIds[SwapIndex] = EntityIds[LastEntityIndex];
-	EntityIds.Pop();
+	GetHeader()->NumEntities--;
+	MarkEntitiesChanged();
 
 	if (!bEntityWasMoved)
 	{
+		// Moved entities have already relocated (or destroyed) their components.
+		DestroyComponents(SwapIndex);
 		DEC_DWORD_STAT(STAT_Mantle_EntityCount);
 
 		if (MasterRecord->ArchetypeHasComponent(ToRemove.Archetype, FMC_TemporaryEntity::StaticStruct()))
@@ -182,14 +221,14 @@ void FMantleDBChunk::RemoveEntity(FMantleEntity& ToRemove, bool bEntityWasMoved)
 			INC_DWORD_STAT(STAT_Mantle_TempararyEntitiesRemoved);
 		}
 	}
-	
+
 	if (SwapIndex == LastEntityIndex)
 	{
 		if (LastEntityIndex > 0)
 		{
 			return;
 		}
-		
+
 		// TODO(): Consider just removing this entry entirely.
 		DeallocateBlob();
 
@@ -198,18 +237,17 @@ void FMantleDBChunk::RemoveEntity(FMantleEntity& ToRemove, bool bEntityWasMoved)
 		{
 			Entry->MakeAvailable(ChunkId);
 		}
-		
+
 		return;
 	}
 
 	// Swap data.
 	FMantleEntity* SwapEntity = MasterRecord->EntitiesById.Find(EntityIds[SwapIndex]);
-	
-	for (auto Iterator = ComponentTypeInfo.CreateConstIterator(); Iterator; ++Iterator)
+
+	for (const FMantleComponentInfo& TypeInfo : Entry->Columns)
 	{
-		FMantleComponentInfo* TypeInfo = ComponentTypeInfo.Find(Iterator.Key());
-		uint8* OldLoc = TypeInfo->ChunkLocation + (LastEntityIndex * TypeInfo->StructSize);
-		uint8* SwapLoc = TypeInfo->ChunkLocation + (SwapIndex * TypeInfo->StructSize);
+		uint8* OldLoc = GetColumn(TypeInfo) + (LastEntityIndex * TypeInfo.StructSize);
+		uint8* SwapLoc = GetColumn(TypeInfo) + (SwapIndex * TypeInfo.StructSize);
 
 		if (SwapLoc < ComponentBlob || SwapLoc > MaxLocation)
 		{
@@ -218,7 +256,7 @@ void FMantleDBChunk::RemoveEntity(FMantleEntity& ToRemove, bool bEntityWasMoved)
 		}
 		// todo(): Make sure subchunk bounds are valid as well.
 
-		FMemory::Memcpy(SwapLoc, OldLoc, TypeInfo->StructSize);
+		FMemory::Memcpy(SwapLoc, OldLoc, TypeInfo.StructSize);
 	}
 
 	SwapEntity->Index = SwapIndex;
@@ -251,11 +289,11 @@ int32 FMantleDBChunk::TakeEntities(
 	{
 		return 0;
 	}
-	
-	const int32 OldEntityCount = EntityIds.Num();
+
+	const int32 OldEntityCount = GetNumEntities();
 	const int32 ResultChunkIndex = OutResult.ChunkedEntityIds.Num();
 	int32 EntitiesSkipped = 0;
-	
+
 	for (int IdIndex = 0; IdIndex < IdsToTake.Num() && GetRemainingCapacity() > 0; ++IdIndex)
 	{
 		FMantleEntity* Entity = MasterRecord->EntitiesById.Find(IdsToTake[IdIndex]);
@@ -276,19 +314,21 @@ int32 FMantleDBChunk::TakeEntities(
 		}
 
 		TSet<FString> TypesUpdated;
-		const int32 NewEntityIndex = EntityIds.Num();
-		
-		for (auto OldTypeInfo = OldChunk->ComponentTypeInfo.CreateConstIterator(); OldTypeInfo; ++OldTypeInfo)
+		const int32 NewEntityIndex = GetNumEntities();
+
+		for (const FMantleComponentInfo& OldTypeInfo : TakeFrom.Columns)
 		{
-			FString TypeName = OldTypeInfo.Key();
-			FMantleComponentInfo* LocalComponentInfo = ComponentTypeInfo.Find(TypeName);
-			
+			const FString& TypeName = OldTypeInfo.Name;
+			const FMantleComponentInfo* LocalComponentInfo = Entry->FindColumn(TypeName);
+
 			if (!LocalComponentInfo)
 			{
+				// This component is being stripped from the entity.
+				OldChunk->DestroyComponent(OldTypeInfo, Entity->Index);
 				continue;
 			}
 
-			const int32 StructSize = OldTypeInfo.Value().StructSize;
+			const int32 StructSize = OldTypeInfo.StructSize;
 			if (StructSize != LocalComponentInfo->StructSize)
 			{
 				// TODO(): rollback and continue.
@@ -296,8 +336,8 @@ int32 FMantleDBChunk::TakeEntities(
 				return 0;
 			}
 
-			uint8* DestLocation = LocalComponentInfo->ChunkLocation + (NewEntityIndex * StructSize);
-			uint8* SrcLocation = OldTypeInfo.Value().ChunkLocation + (Entity->Index * StructSize);
+			uint8* DestLocation = GetColumn(*LocalComponentInfo) + (NewEntityIndex * StructSize);
+			uint8* SrcLocation = OldChunk->GetColumn(OldTypeInfo) + (Entity->Index * StructSize);
 
 			if (!LocationIsValid(DestLocation))
 			{
@@ -325,26 +365,30 @@ int32 FMantleDBChunk::TakeEntities(
 		for (FInstancedStruct ComponentInstance : ComponentsToAdd)
 		{
 			FString TypeName = ComponentInstance.GetScriptStruct()->GetName();
-			FMantleComponentInfo* ComponentInfo = ComponentTypeInfo.Find(TypeName);
+			const FMantleComponentInfo* ComponentInfo = Entry->FindColumn(TypeName);
 
-			if (!ComponentInfo || !ComponentInfo->ChunkLocation)
+			if (!ComponentInfo)
 			{
 				// todo(): Rollback changes and continue.
-				UE_LOG(LogMantle, Fatal, TEXT("AddEntities: ComponentInfo for type %s is invalid."), *ComponentInfo->Name);
+				UE_LOG(LogMantle, Fatal, TEXT("AddEntities: ComponentInfo for type %s is invalid."), *TypeName);
 				return 0;
 			}
-			
-			uint8* DestLocation = ComponentInfo->ChunkLocation + (NewEntityIndex * ComponentInfo->StructSize);
+
+			uint8* DestLocation = GetColumn(*ComponentInfo) + (NewEntityIndex * ComponentInfo->StructSize);
 			const uint8* SrcLocation = ComponentInstance.GetMemory();
-		
+
 			if (!LocationIsValid(DestLocation))
 			{
 				// todo(): Rollback changes and continue.
 				UE_LOG(LogMantle, Fatal, TEXT("Attempted to copy to memory address outside of chunk range."));
 				return 0;
 			}
-			
-			ComponentInstance.GetScriptStruct()->InitializeStruct(DestLocation);
+
+			// If the entity already had this component, the relocated instance is overwritten instead.
+			if (!TypesUpdated.Contains(TypeName))
+			{
+				ComponentInstance.GetScriptStruct()->InitializeStruct(DestLocation);
+			}
 			ComponentInstance.GetScriptStruct()->CopyScriptStruct(DestLocation, SrcLocation);
 			TypesUpdated.Add(TypeName);
 
@@ -357,15 +401,13 @@ int32 FMantleDBChunk::TakeEntities(
 		}
 
 		// Sanity check. All types should have been updated.
-		for (auto TypeIterator = ComponentTypeInfo.CreateConstIterator(); TypeIterator; ++TypeIterator)
+		for (const FMantleComponentInfo& ExpectedTypeInfo : Entry->Columns)
 		{
-			FString ExpectedType = TypeIterator.Key();
-			
-			if (!TypesUpdated.Contains(ExpectedType))
+			if (!TypesUpdated.Contains(ExpectedTypeInfo.Name))
 			{
 				// TODO(): Add support for initializing all types, even if they are missing. Then we can log an error
 				//         here instead of fatal.
-				UE_LOG(LogMantle, Fatal, TEXT("Expected type: %s to be updated."), *TypeIterator.Key());
+				UE_LOG(LogMantle, Fatal, TEXT("Expected type: %s to be updated."), *ExpectedTypeInfo.Name);
 				return 0;
 			}
 		}
@@ -375,17 +417,22 @@ int32 FMantleDBChunk::TakeEntities(
 		Entity->Archetype = Archetype;
 		Entity->ChunkId = ChunkId;
 		Entity->Index = NewEntityIndex;
-		EntityIds.Add(Entity->Id);
+		Entity->Generation++;
+		GetEntityIdData()[NewEntityIndex] = Entity->Id;
+		GetHeader()->NumEntities++;
 	}
 
-	int32 EntitiesAdded = EntityIds.Num() - OldEntityCount;
+	int32 EntitiesAdded = GetNumEntities() - OldEntityCount;
 
 	if (EntitiesAdded <= 0)
 	{
 		return 0;
 	}
-	
-	OutResult.ChunkedEntityIds.Add(TArrayView<FGuid>(&EntityIds[OldEntityCount], EntitiesAdded));
+	MarkEntitiesChanged();
+
+	OutResult.ChunkedEntityIds.Add(TArrayView<FGuid>(GetEntityIdData() + OldEntityCount, EntitiesAdded));
+	OutResult.ChunkIds.Add(ChunkId);
+	OutResult.ChunkHeaders.Add(GetHeader());
 
 	// Update the entity sizes on all the result array views.
 	for (auto ResultIterator = OutResult.ChunkedComponents.CreateIterator(); ResultIterator; ++ResultIterator)
@@ -407,57 +454,181 @@ bool FMantleDBChunk::MaybeAllocateBlob()
 {
 	if (!ComponentBlob)
 	{
-		ComponentBlob = (uint8*)FMemory::Malloc(MasterRecord->ChunkComponentBlobSize);
-		uint8* NextSubchunkLocation = ComponentBlob;
-		MaxLocation = ComponentBlob + MasterRecord->ChunkComponentBlobSize;
-
-		// Compute positions for each subchunk.
-		for (auto Iterator = ComponentTypeInfo.CreateIterator(); Iterator; ++Iterator)
+		ComponentBlob = MasterRecord->FreeBlobs.Num() > 0
+			? MasterRecord->FreeBlobs.Pop(EAllowShrinking::No)
+			: (uint8*)FMemory::Malloc(MasterRecord->ChunkComponentBlobSize, Ananke::Mantle::kChunkColumnAlignment);
+		BlobSize = MasterRecord->ChunkComponentBlobSize;
+		MaxLocation = ComponentBlob + BlobSize;
+
+		// The column offsets were computed when the entry was created.
+		for (const FMantleComponentInfo& ComponentInfo : Entry->Columns)
 		{
-			FMantleComponentInfo& ComponentInfo = Iterator.Value();
-
-			// Align() adds a bit of padding so that the struct starts at a safe address.
-			ComponentInfo.ChunkLocation = Align(NextSubchunkLocation, ComponentInfo.StructAlignment);
-			NextSubchunkLocation = ComponentInfo.ChunkLocation + (ComponentInfo.StructSize * TotalCapacity);
-
-			if (NextSubchunkLocation > MaxLocation)
+			uint8* SubchunkEnd = GetColumn(ComponentInfo) + (ComponentInfo.StructSize * TotalCapacity);
+			if (SubchunkEnd > MaxLocation)
 			{
-				UE_LOG(LogMantle, Fatal, TEXT("Subchunk location %p exceeds max location %p."), NextSubchunkLocation, MaxLocation);
+				UE_LOG(LogMantle, Fatal, TEXT("Subchunk location %p exceeds max location %p."), SubchunkEnd, MaxLocation);
 				return false;
 			}
 		}
+
+		InitializeHeader();
 	}
 
 	return true;
 }
 
-void FMantleDBChunk::RegisterEntities(int32 NumEntities, FMantleCachedEntry& OutResult)
+bool FMantleDBChunk::ReserveBareEntities(int32 NumToAdd)
 {
-	const int32 EntityIndexOffset = EntityIds.Num();
-	const int32 StartIndex = EntityIds.Num();
-	
-	for (int EntityIndex = 0; EntityIndex < NumEntities; EntityIndex++)
+	const int32 NumEntities = GetNumEntities();
+	const int32 OldCapacity = ComponentBlob ? GetHeader()->TotalCapacity : 0;
+	if (NumEntities + NumToAdd <= OldCapacity)
 	{
-		int32 NewEntityIndex = EntityIndexOffset + EntityIndex;
-		FGuid NewEntityId = MasterRecord->RegisterEntity(Archetype, ChunkId, NewEntityIndex);
-		EntityIds.Add(NewEntityId);
-		INC_DWORD_STAT(STAT_Mantle_EntityCount);
+		return true;
+	}
 
-		if (MasterRecord->ArchetypeHasComponent(Archetype, FMC_TemporaryEntity::StaticStruct()))
+	const int32 NewCapacity = FMath::Max3(NumEntities + NumToAdd, OldCapacity * 2, kMinBareChunkCapacity);
+	const int64 NewSize = Entry->EntityIdsOffset + static_cast<int64>(sizeof(FGuid)) * NewCapacity;
+	if (NewSize > MAX_int32)
+	{
+		UE_LOG(LogMantle, Error, TEXT("ReserveBareEntities: Unable to fit %d bare entities in one chunk."), NewCapacity);
+		return false;
+	}
+
+	const bool bIsNewBlob = (ComponentBlob == nullptr);
+	ComponentBlob = (uint8*)FMemory::Realloc(ComponentBlob, NewSize, Ananke::Mantle::kChunkColumnAlignment);
+	BlobSize = static_cast<int32>(NewSize);
+	MaxLocation = ComponentBlob + BlobSize;
+
+	if (bIsNewBlob)
+	{
+		InitializeHeader();
+	}
+	GetHeader()->TotalCapacity = NewCapacity;
+
+	return true;
+}
+
+void FMantleDBChunk::InitializeHeader()
+{
+	FMantleDBChunkHeader* Header = GetHeader();
+	Header->NumEntities = 0;
+	Header->TotalCapacity = TotalCapacity;
+	Header->EntryIndex = Entry->EntryIndex;
+	Header->NumColumns = Entry->Columns.Num();
+	Header->EntityIdsOffset = Entry->EntityIdsOffset;
+
+	int32* ColumnOffsets = Header->GetColumnOffsets();
+	for (int32 ColumnIndex = 0; ColumnIndex < Entry->Columns.Num(); ++ColumnIndex)
+	{
+		ColumnOffsets[ColumnIndex] = Entry->Columns[ColumnIndex].ChunkOffset;
+	}
+	MarkEntitiesChanged();
+}
+
+void FMantleDBChunk::MarkEntitiesChanged()
+{
+	FMantleDBChunkHeader* Header = GetHeader();
+	Header->EntitiesVersion = ++MasterRecord->LastEntitiesVersion;
+	Header->MarkAllColumnsChanged();
+}
+
+int32 FMantleDBChunk::RemoveAllEntities()
+{
+	const int32 NumRemoved = GetNumEntities();
+	if (NumRemoved == 0)
+	{
+		return 0;
+	}
+
+	const bool bWasFull = (GetRemainingCapacity() == 0);
+
+	// Each column is contiguous, so it can be destroyed in one call.
+	for (const FMantleComponentInfo& TypeInfo : Entry->Columns)
+	{
+		if (TypeInfo.ScriptStruct)
 		{
-			INC_DWORD_STAT(STAT_Mantle_TempararyEntitiesAdded);
+			TypeInfo.ScriptStruct->DestroyStruct(GetColumn(TypeInfo), NumRemoved);
 		}
 	}
 
-	const int32 EntitiesAdded = EntityIds.Num() - StartIndex;
+	for (FGuid& EntityId : GetEntityIds())
+	{
+		MasterRecord->RemoveEntity(EntityId);
+	}
+	GetHeader()->NumEntities = 0;
 
-	if (EntitiesAdded <= 0)
+	DEC_DWORD_STAT_BY(STAT_Mantle_EntityCount, NumRemoved);
+	if (MasterRecord->ArchetypeHasComponent(Archetype, FMC_TemporaryEntity::StaticStruct()))
+	{
+		INC_DWORD_STAT_BY(STAT_Mantle_TempararyEntitiesRemoved, NumRemoved);
+	}
+
+	DeallocateBlob();
+
+	// The 'bare' Archetype is always available since it does not store any component data.
+	if (bWasFull && !UAnankeBitArrayLibrary::IsZero(Archetype))
+	{
+		Entry->MakeAvailable(ChunkId);
+	}
+
+	return NumRemoved;
+}
+
+void FMantleDBChunk::DestroyComponent(const FMantleComponentInfo& TypeInfo, int32 EntityIndex)
+{
+	if (!TypeInfo.ScriptStruct || !ComponentBlob)
+	{
+		return;
+	}
+
+	uint8* Location = GetColumn(TypeInfo) + (EntityIndex * TypeInfo.StructSize);
+	if (!LocationIsValid(Location))
+	{
+		UE_LOG(LogMantle, Error, TEXT("DestroyComponent: Location for type %s is invalid."), *TypeInfo.Name);
+		return;
+	}
+
+	TypeInfo.ScriptStruct->DestroyStruct(Location);
+}
+
+void FMantleDBChunk::DestroyComponents(int32 EntityIndex)
+{
+	for (const FMantleComponentInfo& TypeInfo : Entry->Columns)
+	{
+		DestroyComponent(TypeInfo, EntityIndex);
+	}
+}
+
+void FMantleDBChunk::RegisterEntities(int32 NumEntities, FMantleCachedEntry& OutResult)
+{
+	if (NumEntities <= 0)
 	{
 		OutResult.ChunkedEntityIds.Add(TArrayView<FGuid>());
+		OutResult.ChunkIds.Add(ChunkId);
+		OutResult.ChunkHeaders.Add(GetHeader());
 		return;
 	}
 
-	OutResult.ChunkedEntityIds.Add(TArrayView<FGuid>(&EntityIds[StartIndex], EntitiesAdded));
+	const int32 StartIndex = GetNumEntities();
+	FGuid* EntityIds = GetEntityIdData();
+
+	for (int EntityIndex = 0; EntityIndex < NumEntities; EntityIndex++)
+	{
+		int32 NewEntityIndex = StartIndex + EntityIndex;
+		EntityIds[NewEntityIndex] = MasterRecord->RegisterEntity(Archetype, ChunkId, NewEntityIndex);
+		INC_DWORD_STAT(STAT_Mantle_EntityCount);
+
+		if (MasterRecord->ArchetypeHasComponent(Archetype, FMC_TemporaryEntity::StaticStruct()))
+		{
+			INC_DWORD_STAT(STAT_Mantle_TempararyEntitiesAdded);
+		}
+	}
+	GetHeader()->NumEntities += NumEntities;
+	MarkEntitiesChanged();
+
+	OutResult.ChunkedEntityIds.Add(TArrayView<FGuid>(EntityIds + StartIndex, NumEntities));
+	OutResult.ChunkIds.Add(ChunkId);
+	OutResult.ChunkHeaders.Add(GetHeader());
 }
 
 int32 FMantleDBChunk::TakeBareArchetypeEntities (
@@ -466,9 +637,14 @@ int32 FMantleDBChunk::TakeBareArchetypeEntities (
 	FMantleCachedEntry& OutResult
 )
 {
-	const int32 StartIndex = EntityIds.Num();
+	if (!ReserveBareEntities(IdsToTake.Num()))
+	{
+		return 0;
+	}
+
+	const int32 StartIndex = GetNumEntities();
 	int32 EntitiesSkipped = 0;
-	
+
 	for (const FGuid EntityId : IdsToTake)
 	{
 		FMantleEntity* Entity = MasterRecord->EntitiesById.Find(EntityId);
@@ -487,21 +663,49 @@ int32 FMantleDBChunk::TakeBareArchetypeEntities (
 			continue;
 		}
 
-		EntityIds.Add(EntityId);
+		GetEntityIdData()[GetNumEntities()] = EntityId;
+		GetHeader()->NumEntities++;
+		TakeFromChunk->DestroyComponents(Entity->Index);
 		TakeFromChunk->RemoveEntity(*Entity, true);
+		Entity->Generation++;
 	}
 
-	const int32 EntitiesAdded = EntityIds.Num() - StartIndex;
+	const int32 EntitiesAdded = GetNumEntities() - StartIndex;
 
 	if (EntitiesAdded <= 0)
 	{
 		OutResult.ChunkedEntityIds.Add(TArrayView<FGuid>());
+		OutResult.ChunkIds.Add(ChunkId);
+		OutResult.ChunkHeaders.Add(GetHeader());
 		return 0;
 	}
 
-	OutResult.ChunkedEntityIds.Add(TArrayView<FGuid>(&EntityIds[StartIndex], EntitiesAdded));
+	OutResult.ChunkedEntityIds.Add(TArrayView<FGuid>(GetEntityIdData() + StartIndex, EntitiesAdded));
+	OutResult.ChunkIds.Add(ChunkId);
+	OutResult.ChunkHeaders.Add(GetHeader());
 	return EntitiesAdded + EntitiesSkipped;
 }
+
+void* FMantleDBChunk::GetComponentInternal(FString& TypeName, int32 EntityIndex)
+{
+	const FMantleComponentInfo* TypeInfo = Entry->FindColumn(TypeName);
+
+	if (!TypeInfo || !ComponentBlob)
+	{
+		return nullptr;
+	}
+
+	return GetColumn(*TypeInfo) + (EntityIndex * TypeInfo->StructSize);
+}
+
+void FMantleDBChunk::MarkColumnChanged(const FString& TypeName)
+{
+	const int32* ColumnIndex = Entry->ColumnIndices.Find(TypeName);
+	if (ColumnIndex && ComponentBlob)
+	{
+		GetHeader()->MarkColumnChanged(*ColumnIndex);
+	}
+}
 // End FMantleDBChunk ---------------------------------------------------------------------------------------------------
 
 // FMantleDBEntry -----------------------------------------------------------------------------------------------------
@@ -509,22 +713,72 @@ FMantleDBEntry::FMantleDBEntry(TBitArray<>& NewArchetype, FMantleDBMasterRecord&
 {
 	Archetype = NewArchetype;
 	MasterRecord = &NewMasterRecord;
+	EntryIndex = MasterRecord->NextEntryIndex++;
+
+	int32 BytesPerEntity = 0;
 
 	for (auto Iterator = MasterRecord->ComponentInfoMap.CreateConstIterator(); Iterator; ++Iterator)
 	{
 		FMantleComponentInfo ComponentInfo = Iterator.Value();
-			
+
 		if (!Archetype[ComponentInfo.ArchetypeIndex])
 		{
 			continue;
 		}
 
 		ComponentTypes.Add(ComponentInfo.Name);
+
+		if (ComponentInfo.Name.Equals(TEXT("")) || ComponentInfo.StructSize <= 0 || ComponentInfo.StructAlignment <= 0)
+		{
+			UE_LOG(LogMantle, Warning, TEXT("Found invalid component (name: %s) while initializing DB entry. Skipping this component."), *ComponentInfo.Name);
+			continue;
+		}
+
+		BytesPerEntity += ComponentInfo.StructSize;
+		Columns.Add(ComponentInfo);
+	}
+
+	EntityIdsOffset = GetEntityIdsOffset(Columns.Num());
+
+	// The bare archetype has no columns, and its one chunk grows as needed (see FMantleDBChunk::ReserveBareEntities).
+	if (Columns.IsEmpty())
+	{
+		return;
+	}
+
+	// Most aligned columns first, so that alignments above a cache line don't leave gaps between columns.
+	Columns.Sort([](const FMantleComponentInfo& A, const FMantleComponentInfo& B)
+	{
+		if (A.StructAlignment != B.StructAlignment)
+		{
+			return A.StructAlignment > B.StructAlignment;
+		}
+		return A.ArchetypeIndex < B.ArchetypeIndex;
+	});
+
+	// Start from the capacity we'd get with no padding at all, and back off until the real layout fits.
+	const int32 BlobSize = MasterRecord->ChunkComponentBlobSize;
+	ChunkCapacity = FMath::Max(BlobSize - EntityIdsOffset, 0) / (BytesPerEntity + static_cast<int32>(sizeof(FGuid)));
+	while (ChunkCapacity > 0 && LayoutChunkColumns(Columns, ChunkCapacity) > BlobSize)
+	{
+		ChunkCapacity--;
+	}
+
+	if (ChunkCapacity <= 0)
+	{
+		UE_LOG(LogMantle, Fatal, TEXT("MantleDB does not support entity size."));
+		return;
+	}
+
+	for (int32 ColumnIndex = 0; ColumnIndex < Columns.Num(); ++ColumnIndex)
+	{
+		ColumnIndices.Add(Columns[ColumnIndex].Name, ColumnIndex);
 	}
 }
 
 void FMantleDBEntry::AddEntities(const TArray<FInstancedStruct>& ComponentsToAdd, const int32 NumEntities, FMantleCachedEntry& OutResult)
 {
+	OutResult.ColumnIndices = ColumnIndices;
 	int32 PendingAllocations = NumEntities;
 
 	while (PendingAllocations > 0)
@@ -548,6 +802,8 @@ void FMantleDBEntry::TakeEntities(
 	FMantleCachedEntry& OutResult
 )
 {
+	OutResult.ColumnIndices = ColumnIndices;
+	
 	int32 EntitiesToTake = EntityIds.Num();
 
 	while (EntitiesToTake > 0)
@@ -656,6 +912,7 @@ void UMantleDB::Initialize(TArray<UScriptStruct*>& ComponentTypes, int32 ChunkSi
 		NewComponentInfo.ArchetypeIndex = NextArchetypeIndex;
 		NewComponentInfo.StructSize = ComponentType->GetStructureSize();
 		NewComponentInfo.StructAlignment = ComponentType->GetMinAlignment();
+		NewComponentInfo.ScriptStruct = ComponentType;
 
 		MasterRecord.ComponentInfoMap.Add(NewComponentInfo.Name, NewComponentInfo);
 		NextArchetypeIndex++;
@@ -691,6 +948,9 @@ FGuid UMantleDB::AddEntity(const TArray<FInstancedStruct>& InitialComposition)
 
 FMantleIterator UMantleDB::AddEntities(const TArray<FInstancedStruct>& InitialComposition, const int32 NumEntities)
 {
+	MANTLE_CHECK_STRUCTURAL_CHANGE();
+	MANTLE_CHECK_DIRECT_ACCESS();
+	
 	TBitArray<> Archetype = TBitArray<>(false, MasterRecord.ComponentInfoMap.Num());
 	TArray<FString> ComponentTypes;
 
@@ -708,9 +968,16 @@ FMantleIterator UMantleDB::AddEntities(const TArray<FInstancedStruct>& InitialCo
 	ResultIterator.LocalCache.QueryArchetype = Archetype;
 	ResultIterator.LocalCache.MatchingEntries.Add(FMantleCachedEntry(Archetype));
 	
-	DBEntry->AddEntities(InitialComposition, NumEntities, ResultIterator.LocalCache.MatchingEntries[0]);
+	FMantleCachedEntry& AddedEntities = ResultIterator.LocalCache.MatchingEntries[0];
+	DBEntry->AddEntities(InitialComposition, NumEntities, AddedEntities);
 	EntryWasModified(Archetype);
 
+	for (TArrayView<FGuid>& ChunkEntityIds : AddedEntities.ChunkedEntityIds)
+	{
+		AddAvatarIndex(InitialComposition, ChunkEntityIds);
+		RecordComponentEvents(EMantleComponentEvent::Add, DBEntry->ComponentTypes, ChunkEntityIds);
+	}
+
 	// Make sure that the ResultIterator has a valid matching query in the cache.
 	if (!RefreshCachedQuery(Archetype))
 	{
@@ -722,8 +989,11 @@ FMantleIterator UMantleDB::AddEntities(const TArray<FInstancedStruct>& InitialCo
 	return ResultIterator;
 }
 
-void UMantleDB::RemoveEntities(const TArray<FGuid>& EntityIds)
+void UMantleDB::RemoveEntities(TConstArrayView<FGuid> EntityIds)
 {
+	MANTLE_CHECK_STRUCTURAL_CHANGE();
+	MANTLE_CHECK_DIRECT_ACCESS();
+	
 	TSet<TBitArray<>> ModifiedArchetypes;
 	
 	for (FGuid EntityId : EntityIds)
@@ -749,6 +1019,9 @@ void UMantleDB::RemoveEntities(const TArray<FGuid>& EntityIds)
 			continue;
 		}
 		
+		RemoveAvatarIndex(EntityId);
+		RemoveFromSideTables(TConstArrayView<FGuid>(&EntityId, 1));
+		RecordComponentEvents(EMantleComponentEvent::Remove, Chunk->Entry->ComponentTypes, TConstArrayView<FGuid>(&EntityId, 1));
 		Chunk->RemoveEntity(*Entity);
 		MasterRecord.RemoveEntity(Entity->Id);
 		ModifiedArchetypes.Add(Chunk->Archetype);
@@ -760,6 +1033,88 @@ void UMantleDB::RemoveEntities(const TArray<FGuid>& EntityIds)
 	}
 }
 
+int32 UMantleDB::RemoveEntitiesWhere(
+	FMantleComponentQuery& Query,
+	TFunctionRef<void(FMantleIterator& Iterator, TBitArray<>& OutShouldRemove)> ShouldRemove
+)
+{
+	MANTLE_CHECK_STRUCTURAL_CHANGE();
+	MANTLE_CHECK_DIRECT_ACCESS();
+
+	// The DB can't be modified while the query results are being iterated, so removals are collected first.
+	TArray<FMantleDBChunk*, FMantleScratchAllocator> ChunksToClear;
+	TArray<FGuid, FMantleScratchAllocator> EntitiesToRemove;
+	TBitArray<> RemoveMask;
+
+	FMantleIterator Iterator = RunQuery(Query);
+	while (Iterator.Next())
+	{
+		TArrayView<FGuid> Entities = Iterator.GetEntities();
+		if (Entities.IsEmpty())
+		{
+			continue;
+		}
+		
+		RemoveMask.Init(false, Entities.Num());
+		ShouldRemove(Iterator, RemoveMask);
+		
+		const int32 NumToRemove = RemoveMask.CountSetBits();
+		if (NumToRemove == 0)
+		{
+			continue;
+		}
+
+		const FMantleEntity* FirstEntity = FindEntity(Entities[0]);
+		FMantleDBChunk* Chunk = FirstEntity ? GetChunk(FirstEntity->Archetype, FirstEntity->ChunkId) : nullptr;
+		if (!Chunk)
+		{
+			UE_LOG(LogMantle, Error, TEXT("RemoveEntitiesWhere: Invalid chunk"));
+			continue;
+		}
+
+		if (NumToRemove == Chunk->GetNumEntities())
+		{
+			ChunksToClear.Add(Chunk);
+			continue;
+		}
+
+		// Mixed chunk, fall back to removing entities one by one.
+		for (TConstSetBitIterator<> BitIterator(RemoveMask); BitIterator; ++BitIterator)
+		{
+			EntitiesToRemove.Add(Entities[BitIterator.GetIndex()]);
+		}
+	}
+
+	int32 NumRemoved = 0;
+	TSet<TBitArray<>> ModifiedArchetypes;
+	
+	for (FMantleDBChunk* Chunk : ChunksToClear)
+	{
+		for (const FGuid& EntityId : Chunk->GetEntityIds())
+		{
+			RemoveAvatarIndex(EntityId);
+		}
+		RemoveFromSideTables(Chunk->GetEntityIds());
+		RecordComponentEvents(EMantleComponentEvent::Remove, Chunk->Entry->ComponentTypes, Chunk->GetEntityIds());
+		
+		NumRemoved += Chunk->RemoveAllEntities();
+		ModifiedArchetypes.Add(Chunk->Archetype);
+	}
+
+	for (TBitArray<> Archetype : ModifiedArchetypes)
+	{
+		EntryWasModified(Archetype);
+	}
+
+	if (EntitiesToRemove.Num() > 0)
+	{
+		RemoveEntities(EntitiesToRemove);
+		NumRemoved += EntitiesToRemove.Num();
+	}
+
+	return NumRemoved;
+}
+
 FMantleIterator UMantleDB::UpdateEntity(
 	FGuid& EntityId, TArray<FInstancedStruct>& ComponentsToAdd, TArray<UScriptStruct*>& ComponentsToRemove)
 {
@@ -785,6 +1140,9 @@ FMantleIterator UMantleDB::UpdateEntity(FGuid& EntityId, TArray<UScriptStruct*>&
 FMantleIterator UMantleDB::UpdateEntities(
 	TArray<FGuid>& EntityIds, TArray<FInstancedStruct>& ComponentsToAdd, TArray<UScriptStruct*>& ComponentsToRemove)
 {
+	MANTLE_CHECK_STRUCTURAL_CHANGE();
+	MANTLE_CHECK_DIRECT_ACCESS();
+	
 	if (EntityIds.Num() == 0)
 	{
 		return FMantleIterator();
@@ -876,6 +1234,37 @@ FMantleIterator UMantleDB::UpdateEntities(
 	NewEntry->TakeEntities(ValidEntities, *OldEntry, ComponentsToAdd, ResultIterator.LocalCache.MatchingEntries[0]);
 	EntryWasModified(OldArchetype);
 	EntryWasModified(NewArchetype);
+
+	if (ToRemoveNames.Contains(FMC_AvatarActor::StaticStruct()->GetName()))
+	{
+		for (FGuid EntityId : ValidEntities)
+		{
+			RemoveAvatarIndex(EntityId);
+		}
+	}
+	AddAvatarIndex(ComponentsToAdd, ValidEntities);
+
+	if (!ComponentObservers.IsEmpty())
+	{
+		for (const FString& TypeName : NewEntry->ComponentTypes)
+		{
+			if (!OldEntry->ComponentTypes.Contains(TypeName))
+			{
+				RecordComponentEvent(EMantleComponentEvent::Add, TypeName, ValidEntities);
+			}
+			else if (ToAddNames.Contains(TypeName))
+			{
+				RecordComponentEvent(EMantleComponentEvent::Set, TypeName, ValidEntities);
+			}
+		}
+		for (const FString& TypeName : OldEntry->ComponentTypes)
+		{
+			if (!NewEntry->ComponentTypes.Contains(TypeName))
+			{
+				RecordComponentEvent(EMantleComponentEvent::Remove, TypeName, ValidEntities);
+			}
+		}
+	}
 	
 	// Make sure that the ResultIterator has a valid matching query in the cache.
 	if (!RefreshCachedQuery(NewArchetype))
@@ -902,15 +1291,366 @@ FMantleIterator UMantleDB::UpdateEntities(TArray<FGuid>& EntityIds, TArray<UScri
 
 FMantleIterator UMantleDB::RunQuery(FMantleComponentQuery& Query)
 {
+	MANTLE_CHECK_DIRECT_ACCESS();
+	
 	if (Query.CachedArchetype.IsEmpty())
 	{
 		Query.CachedArchetype = TBitArray<>(false, MasterRecord.ComponentInfoMap.Num());
 		FillArchetype(Query.CachedArchetype, &Query.RequiredComponents);
 	}
 
+	// Fast path: most of the time the cached query is still valid and we only need to copy it.
+	{
+		FReadScopeLock ReadLock(MasterRecord.QueryCacheLock);
+		FMantleCachedQuery* CachedQuery = MasterRecord.CachedQueries.Find(Query.CachedArchetype);
+		if (CachedQuery && CachedQuery->Version.IsValid())
+		{
+			return FMantleIterator(*CachedQuery, &MasterRecord);
+		}
+	}
+
+	FWriteScopeLock WriteLock(MasterRecord.QueryCacheLock);
 	return RunQueryInternal(Query.CachedArchetype);
 }
 
+bool UMantleDB::QueryIsUnchanged(FMantleComponentQuery& Query, const FMantleDBVersion& Version)
+{
+	if (Query.CachedArchetype.IsEmpty())
+	{
+		return false;
+	}
+
+	FReadScopeLock ReadLock(MasterRecord.QueryCacheLock);
+	FMantleCachedQuery* CachedQuery = MasterRecord.CachedQueries.Find(Query.CachedArchetype);
+	
+	return CachedQuery && CachedQuery->Version.IsValid() && CachedQuery->Version == Version;
+}
+
+FGuid UMantleDB::FindEntityByActor(const AActor* Actor) const
+{
+	if (!Actor)
+	{
+		return FGuid();
+	}
+
+	const FGuid* EntityId = EntitiesByAvatarActor.Find(TObjectKey<AActor>(Actor));
+	return EntityId ? *EntityId : FGuid();
+}
+
+void UMantleDB::FindEntitiesByActors(TConstArrayView<const AActor*> Actors, TArrayView<FGuid> OutEntityIds) const
+{
+	if (Actors.Num() != OutEntityIds.Num())
+	{
+		UE_LOG(LogMantle, Error, TEXT("FindEntitiesByActors: Actors and OutEntityIds must be the same size."));
+		return;
+	}
+	
+	for (int32 ActorIndex = 0; ActorIndex < Actors.Num(); ++ActorIndex)
+	{
+		OutEntityIds[ActorIndex] = FindEntityByActor(Actors[ActorIndex]);
+	}
+}
+
+void UMantleDB::UpdateAvatarIndex(FGuid EntityId, AActor* AvatarActor)
+{
+	RemoveAvatarIndex(EntityId);
+	
+	if (!AvatarActor || !MasterRecord.EntitiesById.Contains(EntityId))
+	{
+		return;
+	}
+
+	const TObjectKey<AActor> ActorKey(AvatarActor);
+	if (const FGuid* PreviousEntityId = EntitiesByAvatarActor.Find(ActorKey))
+	{
+		// An actor can only represent one entity. The most recent link wins.
+		AvatarActorsByEntity.Remove(*PreviousEntityId);
+	}
+	
+	EntitiesByAvatarActor.Add(ActorKey, EntityId);
+	AvatarActorsByEntity.Add(EntityId, ActorKey);
+}
+
+void UMantleDB::RemoveAvatarIndex(FGuid EntityId)
+{
+	TObjectKey<AActor> ActorKey;
+	if (!AvatarActorsByEntity.RemoveAndCopyValue(EntityId, ActorKey))
+	{
+		return;
+	}
+
+	const FGuid* IndexedEntityId = EntitiesByAvatarActor.Find(ActorKey);
+	if (IndexedEntityId && *IndexedEntityId == EntityId)
+	{
+		EntitiesByAvatarActor.Remove(ActorKey);
+	}
+}
+
+void UMantleDB::AddAvatarIndex(const TArray<FInstancedStruct>& AddedComponents, TArrayView<const FGuid> EntityIds)
+{
+	for (const FInstancedStruct& ComponentInstance : AddedComponents)
+	{
+		if (ComponentInstance.GetScriptStruct() != FMC_AvatarActor::StaticStruct())
+		{
+			continue;
+		}
+
+		AActor* AvatarActor = ComponentInstance.Get<FMC_AvatarActor>().GetAvatarActor();
+		for (const FGuid& EntityId : EntityIds)
+		{
+			UpdateAvatarIndex(EntityId, AvatarActor);
+		}
+		return;
+	}
+}
+
+void UMantleDB::SwapEventChannels()
+{
+	FScopeLock Lock(&EventChannelLock);
+	for (TPair<FString, TUniquePtr<FMantleEventChannelBase>>& Channel : EventChannels)
+	{
+		Channel.Value->SwapBuffers();
+	}
+}
+
+void UMantleDB::RemoveFromSideTables(TConstArrayView<FGuid> EntityIds)
+{
+	FScopeLock Lock(&SideTableLock);
+	for (TPair<FString, TUniquePtr<FMantleSideTableBase>>& Pair : SideTables)
+	{
+		Pair.Value->RemoveEntities(EntityIds);
+	}
+}
+
+bool UMantleDB::CanAccessDirectly() const
+{
+	// Other threads only use the DB from inside operations (or through snapshots and the command queue).
+	return !IsInGameThread() || GIsRunningAsyncLoop || !IsAsyncLoopRunning();
+}
+
+void UMantleDB::ExecuteOrQueue(FMantleCommand&& Command)
+{
+	if (CanAccessDirectly())
+	{
+		Command(*this);
+		return;
+	}
+
+	CommandQueue->Enqueue(MoveTemp(Command));
+}
+
+void UMantleDB::BeginAsyncLoop()
+{
+	++NumAsyncLoopsRunning;
+}
+
+void UMantleDB::EnterAsyncLoop()
+{
+	GIsRunningAsyncLoop = true;
+}
+
+void UMantleDB::EndAsyncLoop()
+{
+	GIsRunningAsyncLoop = false;
+	--NumAsyncLoopsRunning;
+}
+
+void UMantleDB::CheckDirectAccess() const
+{
+	if (!CanAccessDirectly())
+	{
+		UE_LOG(LogMantle, Error,
+			TEXT("The MantleDB was used directly on the game thread while an async engine loop was running. Use ExecuteOrQueue() or the DB's command queue instead."));
+	}
+}
+
+void UMantleDB::DispatchComponentObservers()
+{
+	TArray<FMantleComponentObservers*, TInlineAllocator<16>> ToDispatch;
+	{
+		FScopeLock Lock(&ComponentObserverLock);
+		for (TPair<FString, TUniquePtr<FMantleComponentObservers>>& Pair : ComponentObservers)
+		{
+			FMantleComponentObservers& Observers = *Pair.Value;
+			bool bHasEvents = false;
+			
+			for (int32 EventIndex = 0; EventIndex < FMantleComponentObservers::kNumEvents; ++EventIndex)
+			{
+				Swap(Observers.PendingEntities[EventIndex], Observers.DispatchedEntities[EventIndex]);
+				Observers.PendingEntities[EventIndex].Reset();
+				bHasEvents |= !Observers.DispatchedEntities[EventIndex].IsEmpty();
+			}
+
+			if (bHasEvents)
+			{
+				ToDispatch.Add(&Observers);
+			}
+		}
+	}
+
+	// The lock is released first so that observers are free to modify the DB.
+	for (FMantleComponentObservers* Observers : ToDispatch)
+	{
+		for (int32 EventIndex = 0; EventIndex < FMantleComponentObservers::kNumEvents; ++EventIndex)
+		{
+			if (!Observers->DispatchedEntities[EventIndex].IsEmpty())
+			{
+				Observers->Observers[EventIndex].Broadcast(this, Observers->DispatchedEntities[EventIndex]);
+			}
+		}
+	}
+}
+
+void UMantleDB::EnableSnapshot(const FString& ComponentName)
+{
+	if (!MasterRecord.ComponentInfoMap.Contains(ComponentName))
+	{
+		UE_LOG(LogMantle, Error, TEXT("Cannot publish snapshots of unregistered component %s."), *ComponentName);
+		return;
+	}
+	
+	FWriteScopeLock Lock(SnapshotLock);
+	Snapshots.FindOrAdd(ComponentName);
+}
+
+TSharedPtr<const FMantleComponentSnapshot, ESPMode::ThreadSafe> UMantleDB::GetSnapshot(const FString& ComponentName) const
+{
+	FReadScopeLock Lock(SnapshotLock);
+	return Snapshots.FindRef(ComponentName);
+}
+
+void UMantleDB::PublishSnapshots()
+{
+	// Snapshots are only added and swapped on this thread, so they can be read here without the lock.
+	if (Snapshots.IsEmpty())
+	{
+		return;
+	}
+
+	TArray<TPair<FString, TSharedPtr<const FMantleComponentSnapshot, ESPMode::ThreadSafe>>, TInlineAllocator<8>> ToPublish;
+	
+	for (const TPair<FString, TSharedPtr<const FMantleComponentSnapshot, ESPMode::ThreadSafe>>& Pair : Snapshots)
+	{
+		const FMantleComponentInfo* ComponentInfo = MasterRecord.ComponentInfoMap.Find(Pair.Key);
+		if (!ComponentInfo)
+		{
+			continue;
+		}
+
+		// Chunks whose column hasn't been marked as changed since the last snapshot are shared with it instead of being
+		// copied again (see FMantleDBChunkHeader::GetColumnChanges()).
+		TMap<FGuid, TSharedRef<FMantleSnapshotChunk, ESPMode::ThreadSafe>> PreviousChunks;
+		if (Pair.Value.IsValid())
+		{
+			PreviousChunks.Reserve(Pair.Value->Chunks.Num());
+			for (const TSharedRef<FMantleSnapshotChunk, ESPMode::ThreadSafe>& Chunk : Pair.Value->Chunks)
+			{
+				PreviousChunks.Add(Chunk->ChunkId, Chunk);
+			}
+		}
+
+		TSharedRef<FMantleComponentSnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<FMantleComponentSnapshot, ESPMode::ThreadSafe>();
+		Snapshot->PublishNumber = Pair.Value.IsValid() ? Pair.Value->PublishNumber + 1 : 1;
+		
+		for (TBitArray<>& Archetype : ActiveArchetypes)
+		{
+			if (!MasterRecord.ArchetypeHasComponent(Archetype, ComponentInfo->ScriptStruct))
+			{
+				continue;
+			}
+			
+			TSharedPtr<FMantleDBEntry>* EntryPtr = EntriesByArchetype.Find(Archetype);
+			const FMantleComponentInfo* Column = EntryPtr && EntryPtr->IsValid() ? (*EntryPtr)->FindColumn(Pair.Key) : nullptr;
+			if (!Column)
+			{
+				continue;
+			}
+
+			const int32 ColumnIndex = static_cast<int32>(Column - (*EntryPtr)->Columns.GetData());
+
+			FMantleCachedEntry SnapshotEntry(Archetype);
+			TArray<FAnankeUntypedArrayView>& SnapshotColumn = SnapshotEntry.ChunkedComponents.Add(Pair.Key);
+			
+			for (const FGuid& ChunkId : (*EntryPtr)->AllChunkIds)
+			{
+				FMantleDBChunk* Chunk = (*EntryPtr)->Chunks.Find(ChunkId);
+				if (!Chunk || Chunk->IsEmpty())
+				{
+					continue;
+				}
+
+				// The flag is consumed even if there is no previous chunk, so the next snapshot can share this copy.
+				const bool bColumnChanged = Chunk->GetHeader()->ConsumeColumnChange(ColumnIndex);
+				const TSharedRef<FMantleSnapshotChunk, ESPMode::ThreadSafe>* PreviousChunk = PreviousChunks.Find(ChunkId);
+				if (PreviousChunk && !bColumnChanged)
+				{
+					Snapshot->Chunks.Add(*PreviousChunk);
+				}
+				else
+				{
+					Snapshot->Chunks.Add(MakeShared<FMantleSnapshotChunk, ESPMode::ThreadSafe>(
+						ChunkId, *Column, Chunk->GetEntityIds(), Chunk->GetColumn(*Column)));
+					Snapshot->CopiedChunks++;
+				}
+
+				FMantleSnapshotChunk& SnapshotChunk = *Snapshot->Chunks.Last();
+				SnapshotEntry.ChunkedEntityIds.Add(TArrayView<FGuid>(SnapshotChunk.EntityIds));
+				SnapshotEntry.ChunkIds.Add(ChunkId);
+				SnapshotColumn.Add(FAnankeUntypedArrayView(SnapshotChunk.Components, SnapshotChunk.EntityIds.Num()));
+				Snapshot->TotalEntities += SnapshotChunk.EntityIds.Num();
+			}
+
+			if (SnapshotEntry.NumChunks() > 0)
+			{
+				SnapshotEntry.bIsValid = true;
+				Snapshot->Query.MatchingEntries.Add(MoveTemp(SnapshotEntry));
+			}
+		}
+
+		Snapshot->Query.Version.Update();
+		ToPublish.Emplace(Pair.Key, MoveTemp(Snapshot));
+	}
+
+	// Readers only hold the lock long enough to copy a pointer. The previous snapshots are freed once the last reader
+	// lets go of them.
+	FWriteScopeLock Lock(SnapshotLock);
+	for (TPair<FString, TSharedPtr<const FMantleComponentSnapshot, ESPMode::ThreadSafe>>& Published : ToPublish)
+	{
+		Snapshots.Add(Published.Key, MoveTemp(Published.Value));
+	}
+}
+
+void UMantleDB::RecordComponentEvent(
+	EMantleComponentEvent Event, const FString& ComponentName, TConstArrayView<FGuid> EntityIds)
+{
+	// Observers are only added outside of operations, so this can be checked without the lock.
+	if (EntityIds.IsEmpty() || ComponentObservers.IsEmpty())
+	{
+		return;
+	}
+
+	FScopeLock Lock(&ComponentObserverLock);
+	TUniquePtr<FMantleComponentObservers>* Observers = ComponentObservers.Find(ComponentName);
+	if (Observers && (*Observers)->IsObserved(Event))
+	{
+		(*Observers)->PendingEntities[static_cast<int32>(Event)].Append(EntityIds.GetData(), EntityIds.Num());
+	}
+}
+
+void UMantleDB::RecordComponentEvents(
+	EMantleComponentEvent Event, TConstArrayView<FString> ComponentNames, TConstArrayView<FGuid> EntityIds)
+{
+	if (ComponentObservers.IsEmpty())
+	{
+		return;
+	}
+
+	for (const FString& ComponentName : ComponentNames)
+	{
+		RecordComponentEvent(Event, ComponentName, EntityIds);
+	}
+}
+
 void UMantleDB::FillArchetype(TBitArray<>& Archetype, TArray<FString>* ToAdd, TArray<FString>* ToRemove)
 {
 	if (ToAdd)
@@ -986,6 +1726,90 @@ TSharedPtr<FMantleDBEntry> UMantleDB::GetOrCreateEntry(TBitArray<>& Archetype)
 	return NewEntry;
 }
 
+void UMantleDB::ForEachComponentInternal(
+	UScriptStruct* ComponentType,
+	TConstArrayView<FGuid> EntityIds,
+	int32 NumOutputs,
+	bool bMarkChanged,
+	TFunctionRef<void(int32 EntityIndex, void* Component)> Func)
+{
+	if (!ComponentType)
+	{
+		return;
+	}
+	if (EntityIds.Num() != NumOutputs)
+	{
+		UE_LOG(LogMantle, Error, TEXT("ForEachComponent: EntityIds and OutComponents must be the same size."));
+		return;
+	}
+
+	TArray<FGatherRow, FMantleScratchAllocator> Rows;
+	Rows.Reserve(EntityIds.Num());
+
+	for (int32 EntityIndex = 0; EntityIndex < EntityIds.Num(); ++EntityIndex)
+	{
+		FMantleEntity* Entity = MasterRecord.EntitiesById.Find(EntityIds[EntityIndex]);
+		if (Entity && MasterRecord.ArchetypeHasComponent(Entity->Archetype, ComponentType))
+		{
+			Rows.Add({Entity, EntityIndex});
+		}
+	}
+
+	// Chunk ids are unique across entries, so this groups rows by chunk, and orders each chunk's rows by position.
+	Rows.Sort([](const FGatherRow& A, const FGatherRow& B)
+	{
+		if (A.Entity->ChunkId != B.Entity->ChunkId)
+		{
+			return A.Entity->ChunkId < B.Entity->ChunkId;
+		}
+		return A.Entity->Index < B.Entity->Index;
+	});
+
+	const FString TypeName = ComponentType->GetName();
+	
+	for (int32 RunStart = 0; RunStart < Rows.Num();)
+	{
+		const FMantleEntity* FirstEntity = Rows[RunStart].Entity;
+		
+		int32 RunEnd = RunStart + 1;
+		while (RunEnd < Rows.Num() && Rows[RunEnd].Entity->ChunkId == FirstEntity->ChunkId)
+		{
+			++RunEnd;
+		}
+
+		FMantleDBChunk* Chunk = GetChunk(FirstEntity->Archetype, FirstEntity->ChunkId);
+		const FMantleComponentInfo* Column = Chunk ? Chunk->Entry->FindColumn(TypeName) : nullptr;
+		uint8* ColumnData = Column ? Chunk->GetColumn(*Column) : nullptr;
+
+		if (!ColumnData)
+		{
+			UE_LOG(LogMantle, Error, TEXT("ForEachComponent: Unable to find the %s column for chunk %s."),
+			       *TypeName, *FirstEntity->ChunkId.ToString());
+			RunStart = RunEnd;
+			continue;
+		}
+
+		if (bMarkChanged)
+		{
+			Chunk->GetHeader()->MarkColumnChanged(static_cast<int32>(Column - Chunk->Entry->Columns.GetData()));
+		}
+
+		const int32 StructSize = Column->StructSize;
+		
+		for (int32 RowIndex = RunStart; RowIndex < RunEnd; ++RowIndex)
+		{
+			if (RowIndex + kGatherPrefetchDistance < RunEnd)
+			{
+				FPlatformMisc::Prefetch(ColumnData + Rows[RowIndex + kGatherPrefetchDistance].Entity->Index * StructSize);
+			}
+			
+			Func(Rows[RowIndex].EntityIndex, ColumnData + Rows[RowIndex].Entity->Index * StructSize);
+		}
+
+		RunStart = RunEnd;
+	}
+}
+
 FMantleIterator UMantleDB::RunQueryInternal(TBitArray<>& QueryArchetype)
 {
 	FMantleCachedQuery* CachedQuery = MasterRecord.CachedQueries.Find(QueryArchetype);
@@ -1027,6 +1851,8 @@ bool UMantleDB::RefreshCachedEntry(FMantleCachedEntry& CachedEntry)
 	// and recompute.
 	CachedEntry.ChunkedComponents.Empty();
 	CachedEntry.ChunkedEntityIds.Empty();
+	CachedEntry.ChunkIds.Empty();
+	CachedEntry.ChunkHeaders.Empty();
 			
 	TSharedPtr<FMantleDBEntry>* EntryPtr = EntriesByArchetype.Find(CachedEntry.Archetype);
 	if (!EntryPtr || !(EntryPtr)->IsValid())
@@ -1037,6 +1863,7 @@ bool UMantleDB::RefreshCachedEntry(FMantleCachedEntry& CachedEntry)
 	}
 
 	FMantleDBEntry* Entry = EntryPtr->Get();
+	CachedEntry.ColumnIndices = Entry->ColumnIndices;
 		
 	for (FGuid ChunkId : Entry->AllChunkIds)
 	{
@@ -1052,12 +1879,14 @@ bool UMantleDB::RefreshCachedEntry(FMantleCachedEntry& CachedEntry)
 			continue;
 		}
 
-		CachedEntry.ChunkedEntityIds.Add(TArrayView<FGuid>(Chunk->EntityIds));
+		CachedEntry.ChunkedEntityIds.Add(Chunk->GetEntityIds());
+		CachedEntry.ChunkIds.Add(ChunkId);
+		CachedEntry.ChunkHeaders.Add(Chunk->GetHeader());
 
 		// We cache all component data for a particular entry even if the current query doesn't need it.
 		for (FString& ComponentType : Entry->ComponentTypes)
 		{
-			FMantleComponentInfo* ComponentInfo = Chunk->ComponentTypeInfo.Find(ComponentType);
+			const FMantleComponentInfo* ComponentInfo = Entry->FindColumn(ComponentType);
 
 			if (!ComponentInfo)
 			{
@@ -1066,7 +1895,7 @@ bool UMantleDB::RefreshCachedEntry(FMantleCachedEntry& CachedEntry)
 			}
 				
 			CachedEntry.ChunkedComponents.FindOrAdd(ComponentType).Add(
-			FAnankeUntypedArrayView(ComponentInfo->ChunkLocation, Chunk->EntityIds.Num())
+			FAnankeUntypedArrayView(Chunk->GetColumn(*ComponentInfo), Chunk->GetNumEntities())
 			);
 		}
 	}
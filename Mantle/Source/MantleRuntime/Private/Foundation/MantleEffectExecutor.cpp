@@ -31,85 +31,546 @@
 
 #include "Foundation/MantleEffectExecutor.h"
 
+#include "Algo/BinarySearch.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
 #include "MantleComponents/EffectPayloads/EP_EffectMetadata.h"
+#include "Misc/App.h"
+
+namespace
+{
+	// Shards smaller than this aren't worth the cost of waking up a worker thread.
+	constexpr int32 kMinInvocationsPerShard = 64;
+
+	// Set while a shard's batches are executing on this thread (see UMantleEffectExecutor::PublishBatchOutput).
+	thread_local FMantleCommandBuffer* GShardOutput = nullptr;
+	
+	struct FDueEffect
+	{
+		// Stays valid for the rest of the frame, since the executor never makes structural changes directly.
+		const FMantleEntity* Entity = nullptr;
+	};
+
+	enum class EEffectCallback : uint8
+	{
+		Executed,
+		Canceled,
+		Finished
+	};
+
+	struct FPendingEffectCallback
+	{
+		FGuid EffectId;
+		EEffectCallback Callback = EEffectCallback::Executed;
+	};
+}
 
 UMantleEffectExecutor::UMantleEffectExecutor(const FObjectInitializer& Initializer): Super(Initializer)
 {
 	Query.AddRequiredComponent<FEP_EffectMetadata>();
+
+	// Finished effects are removed (and callbacks are called) through deferred commands, so the executor doesn't need to
+	// be a sync point. Subclasses declare access for their payloads/targets.
+	ComponentAccess.AddWrite<FEP_EffectMetadata>();
 }
 
 void UMantleEffectExecutor::PerformOperation(FMantleOperationContext& Ctx)
 {
+	const double CurrentTimeSec = FPlatformTime::Seconds();
+
+	if (ScheduledDB != Ctx.MantleDB)
+	{
+		ResetSchedule();
+		ScheduledDB = Ctx.MantleDB;
+	}
+
+	// Canceled effects are handled right away rather than when they are next due.
+	for (const FEP_EffectCancelRequest& CancelRequest :
+		Ctx.MantleDB->GetEventChannel<FEP_EffectCancelRequest>().Read(CancelRequestCursor))
+	{
+		if (ScheduledEffects.Contains(CancelRequest.EffectId))
+		{
+			ScheduleEffect(CancelRequest.EffectId, CurrentTimeSec);
+		}
+	}
+
+	// New effects can only show up when the query results change, so most frames we only need to look at the top of
+	// the schedule.
+	const bool bNeedsDiscovery = !Ctx.MantleDB->QueryIsUnchanged(Query, ScheduledQueryVersion);
+	const bool bHasDueEffects = !EffectSchedule.IsEmpty() && EffectSchedule.HeapTop().DueTimeSec <= CurrentTimeSec;
+	
+	if (!bNeedsDiscovery && !bHasDueEffects)
+	{
+		return;
+	}
+	
 	FMantleIterator QueryResult = Ctx.MantleDB->RunQuery(Query);
 
-	TArray<FGuid> EffectsToCleanUp;
+	if (bNeedsDiscovery)
+	{
+		ScheduleNewEffects(QueryResult);
+		ScheduledQueryVersion = QueryResult.GetVersion();
+	}
 
-	while (QueryResult.Next())
+	TArray<FDueEffect, FMantleScratchAllocator> DueEffects;
+	
+	while (!EffectSchedule.IsEmpty() && EffectSchedule.HeapTop().DueTimeSec <= CurrentTimeSec)
 	{
+		FMantleScheduledEffect DueEffect;
+		EffectSchedule.HeapPop(DueEffect);
+
+		const FMantleEntity* Effect = Ctx.MantleDB->FindEntity(DueEffect.EffectId);
+		if (!Effect)
+		{
+			// The effect was removed since it was scheduled.
+			ScheduledEffects.Remove(DueEffect.EffectId);
+			continue;
+		}
+
+		DueEffects.Add({Effect});
+	}
+
+	// Group the due effects by chunk, and keep the access within each chunk linear. An effect can be due more than
+	// once (if it was canceled, for example), so duplicates end up next to each other.
+	DueEffects.Sort([](const FDueEffect& A, const FDueEffect& B)
+	{
+		if (A.Entity->ChunkId != B.Entity->ChunkId)
+		{
+			return A.Entity->ChunkId < B.Entity->ChunkId;
+		}
+		return A.Entity->Index < B.Entity->Index;
+	});
+
+	MetadataChunks.Reset();
+	PendingInvocations.Reset();
+
+	// Collect all the effects that are ready to run this frame. Only the chunks that hold them are visited.
+	int32 EndDueEffect = 0;
+	while (EndDueEffect < DueEffects.Num())
+	{
+		const int32 FirstDueEffect = EndDueEffect;
+		const FMantleEntity& FirstEffect = *DueEffects[FirstDueEffect].Entity;
+		
+		while (EndDueEffect < DueEffects.Num() && DueEffects[EndDueEffect].Entity->ChunkId == FirstEffect.ChunkId)
+		{
+			EndDueEffect++;
+		}
+
+		if (!QueryResult.MoveToChunk(FirstEffect))
+		{
+			// These effects have left the query. If they come back, they are discovered again.
+			for (int32 DueEffectIndex = FirstDueEffect; DueEffectIndex < EndDueEffect; ++DueEffectIndex)
+			{
+				ScheduledEffects.Remove(DueEffects[DueEffectIndex].Entity->Id);
+			}
+			continue;
+		}
+		
 		TArrayView<FGuid> EffectIds = QueryResult.GetEntities();
 		TArrayView<FEP_EffectMetadata> Effects = QueryResult.GetArrayView<FEP_EffectMetadata>();
-		LoadEffectPayloads(QueryResult);
 
-		for (int32 EffectIndex = 0; EffectIndex < EffectIds.Num(); ++EffectIndex)
+		const int32 PayloadChunk = MetadataChunks.Num();
+		const int32 FirstInvocation = PendingInvocations.Num();
+
+		for (int32 DueEffectIndex = FirstDueEffect; DueEffectIndex < EndDueEffect; ++DueEffectIndex)
 		{
-			FGuid EffectId = EffectIds[EffectIndex];
-			FEP_EffectMetadata& EffectMetadata = Effects[EffectIndex];
+			const FMantleEntity* DueEntity = DueEffects[DueEffectIndex].Entity;
+			if (DueEffectIndex > FirstDueEffect && DueEntity == DueEffects[DueEffectIndex - 1].Entity)
+			{
+				continue;
+			}
 			
-			const double TimeSinceLastTrigger = FPlatformTime::Seconds() - EffectMetadata.LastTimeTriggered;
-			if (TimeSinceLastTrigger < EffectMetadata.TriggerRateSec)
+			const int32 EffectIndex = DueEntity->Index;
+			if (!Effects.IsValidIndex(EffectIndex))
 			{
+				ScheduledEffects.Remove(DueEntity->Id);
 				continue;
 			}
+			
+			FEP_EffectMetadata& EffectMetadata = Effects[EffectIndex];
 
 			if (EffectMetadata.EffectType == EMantleEffectType::Limited && EffectMetadata.RemainingTriggers <= 0)
 			{
+				ScheduledEffects.Remove(EffectIds[EffectIndex]);
 				continue;
 			}
 			
-			FMantleEffectExecutionResult ExecutionResult = Execute(Ctx, EffectIndex, EffectMetadata.CancelRequested);
+			// The trigger time may have been changed since this effect was scheduled.
+			const double DueTimeSec = EffectMetadata.LastTimeTriggered + EffectMetadata.TriggerRateSec;
+			if (DueTimeSec > CurrentTimeSec && !EffectMetadata.CancelRequested)
+			{
+				ScheduleEffect(EffectIds[EffectIndex], DueTimeSec);
+				continue;
+			}
+
+			FMantleEffectInvocation& Invocation = PendingInvocations.AddDefaulted_GetRef();
+			Invocation.PayloadChunk = PayloadChunk;
+			Invocation.EffectIndex = EffectIndex;
+			Invocation.EffectId = EffectIds[EffectIndex];
+			Invocation.bCancelRequested = EffectMetadata.CancelRequested;
+		}
+
+		const int32 NumNewInvocations = PendingInvocations.Num() - FirstInvocation;
+		if (NumNewInvocations == 0)
+		{
+			continue;
+		}
+
+		MetadataChunks.Add(Effects);
+		LoadEffectPayloads(QueryResult);
+		GetEffectTargets(PayloadChunk, TArrayView<FMantleEffectInvocation>(PendingInvocations).Mid(FirstInvocation, NumNewInvocations));
+	}
+
+	if (PendingInvocations.IsEmpty())
+	{
+		ClearEffectPayloads();
+		return;
+	}
+
+	// Group the invocations by where their targets live so that each batch walks a single chunk in order.
+	TArray<FGuid, FMantleScratchAllocator> TargetChunkIds;
+	SortInvocationsByTarget(Ctx, TargetChunkIds);
+
+	PendingResults.Reset();
+	PendingResults.SetNum(PendingInvocations.Num());
+
+	// One batch per target chunk. The last entry marks the end of the final batch.
+	TArray<int32, FMantleScratchAllocator> BatchStarts;
+	for (int32 InvocationIndex = 0; InvocationIndex < PendingInvocations.Num(); ++InvocationIndex)
+	{
+		if (InvocationIndex == 0 || TargetChunkIds[InvocationIndex] != TargetChunkIds[InvocationIndex - 1])
+		{
+			BatchStarts.Add(InvocationIndex);
+		}
+	}
+	BatchStarts.Add(PendingInvocations.Num());
+	
+	ExecuteBatches(Ctx, BatchStarts);
+
+	// Callbacks can run arbitrary game code, and removing entities is a structural change, so both are deferred. They
+	// have to outlive the tick's scratch memory.
+	TArray<FPendingEffectCallback> Callbacks;
+	TArray<FGuid> EffectsToCleanUp;
+
+	for (int32 InvocationIndex = 0; InvocationIndex < PendingInvocations.Num(); ++InvocationIndex)
+	{
+		const FMantleEffectInvocation& Invocation = PendingInvocations[InvocationIndex];
+		const FMantleEffectExecutionResult& ExecutionResult = PendingResults[InvocationIndex];
+		
+		FGuid EffectId = Invocation.EffectId;
+		FEP_EffectMetadata& EffectMetadata = MetadataChunks[Invocation.PayloadChunk][Invocation.EffectIndex];
+		const bool bHasCallbacks = EffectMetadata.bHasCallbacks;
 
-			switch (ExecutionResult.ExecutionStatus)
+		switch (ExecutionResult.ExecutionStatus)
+		{
+		case EMantleEffectExecutionStatus::Succeeded:
+			if (bHasCallbacks)
 			{
-			case EMantleEffectExecutionStatus::Succeeded:
-				EffectMetadata.OnExecuted.Broadcast(Ctx.MantleDB, EffectId);
-				break;
-			case EMantleEffectExecutionStatus::Failed:
-				EffectMetadata.NumFailures++;
-				if (EffectMetadata.NumFailures > EffectMetadata.MaxFailures)
+				Callbacks.Add({EffectId, EEffectCallback::Executed});
+			}
+			break;
+		case EMantleEffectExecutionStatus::Failed:
+			EffectMetadata.NumFailures++;
+			if (EffectMetadata.NumFailures > EffectMetadata.MaxFailures)
+			{
+				// Can maybe fix by using FWeakObjectPtr instead?
+				// Can also maybe fix by switching from DynamicMulticastDelegate to MulticastDelegate. Reminder: Dynamic just lets you serialize the delegate. this means that we wouldn't be allowed to serialize any effects.
+				if (bHasCallbacks)
 				{
-					// Can maybe fix by using FWeakObjectPtr instead?
-					// Can also maybe fix by switching from DynamicMulticastDelegate to MulticastDelegate. Reminder: Dynamic just lets you serialize the delegate. this means that we wouldn't be allowed to serialize any effects.
-					EffectMetadata.OnCanceled.Broadcast(Ctx.MantleDB, EffectId);
-					EffectsToCleanUp.Add(EffectId);
-					continue;
+					Callbacks.Add({EffectId, EEffectCallback::Canceled});
 				}
-				break;
-			case EMantleEffectExecutionStatus::Cancel:
-				EffectMetadata.OnCanceled.Broadcast(Ctx.MantleDB, EffectId);
 				EffectsToCleanUp.Add(EffectId);
 				continue;
-			default:
-				break;
 			}
-			
-			if (EffectMetadata.EffectType == EMantleEffectType::Limited)
+			break;
+		case EMantleEffectExecutionStatus::Cancel:
+			if (bHasCallbacks)
 			{
-				EffectMetadata.RemainingTriggers--;
+				Callbacks.Add({EffectId, EEffectCallback::Canceled});
+			}
+			EffectsToCleanUp.Add(EffectId);
+			continue;
+		default:
+			break;
+		}
+		
+		if (EffectMetadata.EffectType == EMantleEffectType::Limited)
+		{
+			EffectMetadata.RemainingTriggers--;
 
-				if (EffectMetadata.RemainingTriggers <= 0 || ExecutionResult.ExecutionStatus == EMantleEffectExecutionStatus::Succeeded)
+			if (EffectMetadata.RemainingTriggers <= 0 || ExecutionResult.ExecutionStatus == EMantleEffectExecutionStatus::Succeeded)
+			{
+				if (bHasCallbacks)
 				{
-					EffectMetadata.OnFinished.Broadcast(Ctx.MantleDB, EffectId);
-					EffectsToCleanUp.Add(EffectId);
-					continue;
+					Callbacks.Add({EffectId, EEffectCallback::Finished});
 				}
+				EffectsToCleanUp.Add(EffectId);
+				continue;
+			}
+		}
+		
+		EffectMetadata.LastTimeTriggered = CurrentTimeSec;
+		ScheduleEffect(EffectId, CurrentTimeSec + EffectMetadata.TriggerRateSec);
+	}
+
+	for (const FGuid& EffectId : EffectsToCleanUp)
+	{
+		ScheduledEffects.Remove(EffectId);
+	}
+
+	// The payload views point into DB chunks, so they must be released before any structural changes are made.
+	ClearEffectPayloads();
+	MetadataChunks.Reset();
+	PendingInvocations.Reset();
+	
+	if (Callbacks.IsEmpty() && EffectsToCleanUp.IsEmpty())
+	{
+		return;
+	}
+
+	Ctx.Defer([WeakThis = TWeakObjectPtr<UMantleEffectExecutor>(this), Callbacks = MoveTemp(Callbacks),
+		EffectsToCleanUp = MoveTemp(EffectsToCleanUp)](UMantleDB& MantleDB)
+	{
+		TMantleSideTable<FEP_EffectCallbacks>& CallbackTable = MantleDB.GetSideTable<FEP_EffectCallbacks>();
+		
+		for (const FPendingEffectCallback& PendingCallback : Callbacks)
+		{
+			const FEP_EffectCallbacks* EffectCallbacks = CallbackTable.Find(PendingCallback.EffectId);
+			if (!EffectCallbacks)
+			{
+				continue;
 			}
 			
-			EffectMetadata.LastTimeTriggered = FPlatformTime::Seconds();
+			switch (PendingCallback.Callback)
+			{
+			case EEffectCallback::Executed:
+				EffectCallbacks->OnExecuted.Broadcast(&MantleDB, PendingCallback.EffectId);
+				break;
+			case EEffectCallback::Canceled:
+				EffectCallbacks->OnCanceled.Broadcast(&MantleDB, PendingCallback.EffectId);
+				break;
+			case EEffectCallback::Finished:
+				EffectCallbacks->OnFinished.Broadcast(&MantleDB, PendingCallback.EffectId);
+				break;
+			}
+		}
+
+		if (EffectsToCleanUp.IsEmpty())
+		{
+			return;
+		}
+		
+		// Don't let our own removals trigger a full rescan next frame (unless something else changed as well).
+		const bool bWasUnchanged = WeakThis.IsValid() &&
+			MantleDB.QueryIsUnchanged(WeakThis->Query, WeakThis->ScheduledQueryVersion);
+		
+		MantleDB.RemoveEntities(EffectsToCleanUp);
+
+		if (bWasUnchanged)
+		{
+			WeakThis->ScheduledQueryVersion = MantleDB.RunQuery(WeakThis->Query).GetVersion();
 		}
+	});
+}
+
+void UMantleEffectExecutor::ExecuteBatches(FMantleOperationContext& Ctx, TConstArrayView<int32> BatchStarts)
+{
+	const int32 NumBatches = BatchStarts.Num() - 1;
+	const int32 NumInvocations = PendingInvocations.Num();
+
+	auto ExecuteBatchRange = [this, &Ctx, BatchStarts](int32 FirstBatch, int32 EndBatch)
+	{
+		for (int32 BatchIndex = FirstBatch; BatchIndex < EndBatch; ++BatchIndex)
+		{
+			const int32 BatchStart = BatchStarts[BatchIndex];
+			const int32 BatchSize = BatchStarts[BatchIndex + 1] - BatchStart;
+			
+			ExecuteBatch(
+				Ctx,
+				TConstArrayView<FMantleEffectInvocation>(PendingInvocations).Mid(BatchStart, BatchSize),
+				TArrayView<FMantleEffectExecutionResult>(PendingResults).Mid(BatchStart, BatchSize)
+			);
+		}
+	};
+
+	int32 NumShards = 1;
+	if (bCanExecuteBatchesInParallel && (MaxShardsOverride > 0 || FApp::ShouldUseThreadingForPerformance()))
+	{
+		NumShards = FMath::Min3(
+			NumBatches,
+			NumInvocations / kMinInvocationsPerShard,
+			MaxShardsOverride > 0 ? MaxShardsOverride : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1
+		);
+	}
+
+	if (NumShards <= 1)
+	{
+		ExecuteBatchRange(0, NumBatches);
+		return;
+	}
+
+	while (ShardFrameArenas.Num() < NumShards)
+	{
+		ShardFrameArenas.Add(MakeUnique<FMantleFrameArena>());
+		ShardOutputs.AddDefaulted();
+	}
+
+	// Each shard is a contiguous run of batches with roughly the same number of invocations. All of the effects on a
+	// target are in the same batch (in the order they were collected), and shards never write to the same component. The
+	// results are written to fixed slots in PendingResults, and each shard's output is published after the shards
+	// before it, so everything is processed in the same order as a serial run.
+	ParallelFor(NumShards, [this, &ExecuteBatchRange, BatchStarts, NumBatches, NumInvocations, NumShards](int32 ShardIndex)
+	{
+#if MANTLE_WITH_ACCESS_CHECKS
+		// Access checkers are per thread, so the worker needs its own.
+		FMantleAccessChecker AccessChecker(ComponentAccess, this);
+#endif
+		FMantleFrameArenaScope FrameArenaScope(ShardFrameArenas[ShardIndex].Get());
+		TGuardValue<FMantleCommandBuffer*> ShardOutputGuard(GShardOutput, &ShardOutputs[ShardIndex]);
+		
+		const int32 FirstBatch = ShardIndex == 0
+			? 0
+			: Algo::LowerBound(BatchStarts.Left(NumBatches), NumInvocations * ShardIndex / NumShards);
+		const int32 EndBatch = ShardIndex == NumShards - 1
+			? NumBatches
+			: Algo::LowerBound(BatchStarts.Left(NumBatches), NumInvocations * (ShardIndex + 1) / NumShards);
+		
+		ExecuteBatchRange(FirstBatch, EndBatch);
+	});
+
+	// The output may still reference the shard's scratch memory, so it is published before the arena is reset.
+	for (int32 ShardIndex = 0; ShardIndex < NumShards; ++ShardIndex)
+	{
+		ShardOutputs[ShardIndex].Playback(*Ctx.MantleDB);
+		ShardFrameArenas[ShardIndex]->Reset();
+	}
+}
+
+void UMantleEffectExecutor::PublishBatchOutput(FMantleOperationContext& Ctx, FMantleCommand&& Publish)
+{
+	if (GShardOutput)
+	{
+		GShardOutput->Add(MoveTemp(Publish));
+		return;
+	}
+
+	if (Ctx.MantleDB.IsValid())
+	{
+		Publish(*Ctx.MantleDB);
+	}
+}
+
+void UMantleEffectExecutor::ResetSchedule()
+{
+	EffectSchedule.Reset();
+	ScheduledEffects.Reset();
+	DiscoveredChunkVersions.Reset();
+	ScheduledQueryVersion = FMantleDBVersion();
+	CancelRequestCursor = FMantleEventCursor();
+}
+
+void UMantleEffectExecutor::ScheduleNewEffects(FMantleIterator& Iterator)
+{
+	// Only chunks whose entities have changed since the last discovery can hold effects we haven't seen yet. Chunks that
+	// are no longer part of the results are forgotten.
+	TMap<FGuid, uint32> PreviousChunkVersions = MoveTemp(DiscoveredChunkVersions);
+	DiscoveredChunkVersions.Reset();
+	
+	while (Iterator.Next())
+	{
+		const FGuid ChunkId = Iterator.GetChunkId();
+		const uint32 EntitiesVersion = Iterator.GetChunkEntitiesVersion();
+		DiscoveredChunkVersions.Add(ChunkId, EntitiesVersion);
+
+		const uint32* PreviousVersion = PreviousChunkVersions.Find(ChunkId);
+		if (PreviousVersion && *PreviousVersion == EntitiesVersion)
+		{
+			continue;
+		}
+		
+		TArrayView<FGuid> EffectIds = Iterator.GetEntities();
+		TArrayView<const FEP_EffectMetadata> Effects = Iterator.GetArrayView<const FEP_EffectMetadata>();
+
+		for (int32 EffectIndex = 0; EffectIndex < EffectIds.Num(); ++EffectIndex)
+		{
+			bool bIsAlreadyScheduled = false;
+			ScheduledEffects.Add(EffectIds[EffectIndex], &bIsAlreadyScheduled);
+			if (bIsAlreadyScheduled)
+			{
+				continue;
+			}
+
+			const FEP_EffectMetadata& EffectMetadata = Effects[EffectIndex];
+			ScheduleEffect(EffectIds[EffectIndex], EffectMetadata.LastTimeTriggered + EffectMetadata.TriggerRateSec);
+		}
+	}
+}
+
+void UMantleEffectExecutor::ScheduleEffect(const FGuid& EffectId, double DueTimeSec)
+{
+	FMantleScheduledEffect ScheduledEffect;
+	ScheduledEffect.DueTimeSec = DueTimeSec;
+	ScheduledEffect.EffectId = EffectId;
+	EffectSchedule.HeapPush(ScheduledEffect);
+}
+
+void UMantleEffectExecutor::SortInvocationsByTarget(
+	FMantleOperationContext& Ctx,
+	TArray<FGuid, FMantleScratchAllocator>& OutTargetChunkIds
+)
+{
+	struct FInvocationSortKey
+	{
+		FGuid TargetChunkId;
+		int32 TargetIndex = Ananke::Mantle::kInvalidIndex;
+		int32 InvocationIndex = Ananke::Mantle::kInvalidIndex;
+	};
+
+	TArray<FInvocationSortKey, FMantleScratchAllocator> SortKeys;
+	SortKeys.Reserve(PendingInvocations.Num());
+	
+	for (int32 InvocationIndex = 0; InvocationIndex < PendingInvocations.Num(); ++InvocationIndex)
+	{
+		FInvocationSortKey& SortKey = SortKeys.AddDefaulted_GetRef();
+		SortKey.InvocationIndex = InvocationIndex;
+
+		// Invocations with missing targets end up in their own batch (with an invalid chunk id).
+		if (const FMantleEntity* Target = Ctx.MantleDB->FindEntity(PendingInvocations[InvocationIndex].TargetEntity))
+		{
+			SortKey.TargetChunkId = Target->ChunkId;
+			SortKey.TargetIndex = Target->Index;
+		}
+	}
+
+	SortKeys.Sort([](const FInvocationSortKey& A, const FInvocationSortKey& B)
+	{
+		if (A.TargetChunkId != B.TargetChunkId)
+		{
+			return A.TargetChunkId < B.TargetChunkId;
+		}
+		if (A.TargetIndex != B.TargetIndex)
+		{
+			return A.TargetIndex < B.TargetIndex;
+		}
+
+		// Sort isn't stable, and effects on the same target don't commute (health is clamped, for example), so they
+		// keep the order they were collected in.
+		return A.InvocationIndex < B.InvocationIndex;
+	});
+
+	TArray<FMantleEffectInvocation, FMantleScratchAllocator> SortedInvocations;
+	SortedInvocations.Reserve(PendingInvocations.Num());
+	OutTargetChunkIds.Reset(PendingInvocations.Num());
+	
+	for (const FInvocationSortKey& SortKey : SortKeys)
+	{
+		SortedInvocations.Add(PendingInvocations[SortKey.InvocationIndex]);
+		OutTargetChunkIds.Add(SortKey.TargetChunkId);
 	}
 
-	if (EffectsToCleanUp.Num() > 0)
+	// Copy back rather than moving, so that PendingInvocations keeps its (persistent) allocation.
+	for (int32 InvocationIndex = 0; InvocationIndex < SortedInvocations.Num(); ++InvocationIndex)
 	{
-		Ctx.MantleDB->RemoveEntities(EffectsToCleanUp);
+		PendingInvocations[InvocationIndex] = SortedInvocations[InvocationIndex];
 	}
 }
@@ -36,6 +36,31 @@
 #include "MantleRuntimeLoggingDefs.h"
 #include "Foundation/MantleTypes.h"
 
+FMantleAsyncLoopGate::FMantleAsyncLoopGate()
+{
+	bCanEverTick = true;
+	bStartWithTickEnabled = false;
+}
+
+void FMantleAsyncLoopGate::ExecuteTick(
+	float DeltaTime,
+	ELevelTick TickType,
+	ENamedThreads::Type CurrentThread,
+	const FGraphEventRef& MyCompletionGraphEvent
+)
+{
+	// Must match the ticks that FMantleEngineLoop skips, since the loop is what ends the async access.
+	if (TickType == ELevelTick::LEVELTICK_ViewportsOnly || TickType == ELevelTick::LEVELTICK_PauseTick)
+	{
+		return;
+	}
+
+	if (MantleDB.IsValid())
+	{
+		MantleDB->BeginAsyncLoop();
+	}
+}
+
 FMantleEngineLoop::FMantleEngineLoop()
 {
 	bCanEverTick = true;
@@ -54,20 +79,243 @@ void FMantleEngineLoop::ExecuteTick(
 		return;
 	}
 
-	for (FMantleOperationGroup& OperationGroup : Options.OperationGroups)
+	const bool bEndsAsyncLoop = IsAsync() && AsyncLoopGate.MantleDB.IsValid();
+	if (bEndsAsyncLoop)
+	{
+		AsyncLoopGate.MantleDB->EnterAsyncLoop();
+	}
+
+	OperationContext.FrameArena = &FrameArena;
+	OperationContext.Commands = &Commands;
+	FMantleFrameArenaScope FrameArenaScope(&FrameArena);
+
+	if (OperationContext.MantleDB.IsValid() && !IsAsync())
+	{
+		// Changes queued by other threads since the last tick. Async loops leave these for the next game thread loop,
+		// since queued commands can make structural changes.
+		OperationContext.MantleDB->ExecuteQueuedCommands();
+	}
+
+	if (Options.bRunMultithreaded)
+	{
+		RunOperationsConcurrently(CurrentThread);
+	}
+	else
+	{
+		for (FMantleOperationGroup& OperationGroup : Options.OperationGroups)
+		{
+			for (TWeakObjectPtr<UMantleOperation> Operation : OperationGroup.Operations)
+			{
+				if (!Operation.IsValid())
+				{
+					ANANKE_LOG(LogMantle, Error, TEXT("Operation is invalid."));
+					continue;
+				}
+				Operation->Run(OperationContext);
+
+				// Without concurrency, every operation sees the changes made by the ones before it.
+				PlaybackCommands(Commands);
+			}
+		}
+	}
+
+	if (bIsFrameEnd && OperationContext.MantleDB.IsValid())
 	{
-		// TODO(): Support multithreading by running running operations in OperationGroups concurrently.
-		// if (bRunMultithreaded) { }
+		OperationContext.MantleDB->DispatchComponentObservers();
 
+		// Published after the observers, so that snapshots include whatever they changed.
+		OperationContext.MantleDB->PublishSnapshots();
+		
+		// Events written this frame become readable next frame.
+		OperationContext.MantleDB->SwapEventChannels();
+	}
+
+	// Nothing allocated from the arenas may outlive the tick.
+	FrameArena.Reset();
+	for (FMantleScheduledOperation& Scheduled : Schedule)
+	{
+		if (Scheduled.FrameArena)
+		{
+			Scheduled.FrameArena->Reset();
+		}
+	}
+
+	if (bEndsAsyncLoop)
+	{
+		AsyncLoopGate.MantleDB->EndAsyncLoop();
+	}
+}
+
+void FMantleEngineLoop::BuildSchedule()
+{
+	Schedule.Empty();
+
+	// Index of the first operation after the most recent sync point. Operations before it are guaranteed to be finished.
+	int32 WindowStart = 0;
+	
+	for (FMantleOperationGroup& OperationGroup : Options.OperationGroups)
+	{
 		for (TWeakObjectPtr<UMantleOperation> Operation : OperationGroup.Operations)
 		{
 			if (!Operation.IsValid())
 			{
 				ANANKE_LOG(LogMantle, Error, TEXT("Operation is invalid."));
+				continue;
+			}
+
+			const FMantleComponentAccess& Access = Operation->GetComponentAccess();
+			
+			FMantleScheduledOperation& Scheduled = Schedule.AddDefaulted_GetRef();
+			Scheduled.Operation = Operation;
+			Scheduled.bIsSyncPoint = Access.IsSyncPoint();
+
+			if (Scheduled.bIsSyncPoint)
+			{
+				WindowStart = Schedule.Num();
+				continue;
+			}
+
+			Scheduled.FrameArena = MakeUnique<FMantleFrameArena>();
+
+			for (int32 PreviousIndex = WindowStart; PreviousIndex < Schedule.Num() - 1; ++PreviousIndex)
+			{
+				if (Access.ConflictsWith(Schedule[PreviousIndex].Operation->GetComponentAccess()))
+				{
+					Scheduled.Dependencies.Add(PreviousIndex);
+				}
+			}
+		}
+	}
+
+	bRunOnAnyThread = false;
+	EndTickGroup = TickGroup;
+	
+	if (Options.bRunAsync)
+	{
+		FString Reason;
+		if (!CanRunAsync(Reason))
+		{
+			ANANKE_LOG(LogMantle, Warning, TEXT("Engine loop for TickGroup %s can't run async: %s"),
+				*UEnum::GetValueAsName(TickGroup).ToString(), *Reason);
+			return;
+		}
+
+		bRunOnAnyThread = true;
+		EndTickGroup = FMath::Max<ETickingGroup>(TickGroup, Options.AsyncEndTickGroup);
+	}
+}
+
+void FMantleEngineLoop::PlaybackCommands(FMantleCommandBuffer& Buffer)
+{
+	if (Buffer.IsEmpty() || !OperationContext.MantleDB.IsValid())
+	{
+		return;
+	}
+
+	if (IsAsync())
+	{
+		Buffer.MoveTo(OperationContext.MantleDB->GetCommandQueue());
+		return;
+	}
+
+	Buffer.Playback(*OperationContext.MantleDB);
+}
+
+bool FMantleEngineLoop::CanRunAsync(FString& OutReason) const
+{
+	if (bIsFrameEnd)
+	{
+		OutReason = TEXT("The frame end loop does the DB's end of frame bookkeeping on the game thread.");
+		return false;
+	}
+	
+	for (const FMantleScheduledOperation& Scheduled : Schedule)
+	{
+		if (Scheduled.bIsSyncPoint)
+		{
+			OutReason = FString::Printf(
+				TEXT("Operation %s makes structural changes, requires the game thread, or doesn't declare its access. Defer those changes instead (see FMantleOperationContext::Defer)."),
+				*GetNameSafe(Scheduled.Operation.Get()));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void FMantleEngineLoop::RunOperationsConcurrently(ENamedThreads::Type CurrentThread)
+{
+	TArray<FGraphEventRef, FMantleScratchAllocator> OperationEvents;
+	OperationEvents.SetNum(Schedule.Num());
+	
+	FGraphEventArray PendingEvents;
+
+	// Deferred commands are played back whenever nothing else is running, in schedule order.
+	int32 FirstUnplayedIndex = 0;
+	auto PlaybackFinishedOperations = [this, &FirstUnplayedIndex](int32 EndIndex)
+	{
+		for (; FirstUnplayedIndex < EndIndex; ++FirstUnplayedIndex)
+		{
+			PlaybackCommands(Schedule[FirstUnplayedIndex].Commands);
+		}
+	};
+
+	for (int32 ScheduleIndex = 0; ScheduleIndex < Schedule.Num(); ++ScheduleIndex)
+	{
+		FMantleScheduledOperation& Scheduled = Schedule[ScheduleIndex];
+		if (!Scheduled.Operation.IsValid())
+		{
+			ANANKE_LOG(LogMantle, Error, TEXT("Operation is invalid."));
+			continue;
+		}
+
+		if (Scheduled.bIsSyncPoint)
+		{
+			if (PendingEvents.Num() > 0)
+			{
+				FTaskGraphInterface::Get().WaitUntilTasksComplete(PendingEvents, CurrentThread);
+				PendingEvents.Reset();
 			}
-			Operation->Run(OperationContext);
+			PlaybackFinishedOperations(ScheduleIndex);
+			
+			Scheduled.Operation->Run(OperationContext);
+			PlaybackCommands(Commands);
+			FirstUnplayedIndex = ScheduleIndex + 1;
+			continue;
 		}
+
+		FGraphEventArray Prerequisites;
+		for (int32 DependencyIndex : Scheduled.Dependencies)
+		{
+			if (OperationEvents[DependencyIndex].IsValid())
+			{
+				Prerequisites.Add(OperationEvents[DependencyIndex]);
+			}
+		}
+
+		UMantleOperation* Operation = Scheduled.Operation.Get();
+		FMantleFrameArena* TaskFrameArena = Scheduled.FrameArena.Get();
+		FMantleCommandBuffer* TaskCommands = &Scheduled.Commands;
+		OperationEvents[ScheduleIndex] = FFunctionGraphTask::CreateAndDispatchWhenReady(
+			[this, Operation, TaskFrameArena, TaskCommands]()
+			{
+				FMantleOperationContext TaskContext = OperationContext;
+				TaskContext.FrameArena = TaskFrameArena;
+				TaskContext.Commands = TaskCommands;
+				Operation->Run(TaskContext);
+			},
+			TStatId(),
+			&Prerequisites,
+			ENamedThreads::AnyThread
+		);
+		PendingEvents.Add(OperationEvents[ScheduleIndex]);
+	}
+
+	if (PendingEvents.Num() > 0)
+	{
+		FTaskGraphInterface::Get().WaitUntilTasksComplete(PendingEvents, CurrentThread);
 	}
+	PlaybackFinishedOperations(Schedule.Num());
 }
 
 UMantleEngine::UMantleEngine(const FObjectInitializer& ObjectInitializer)
@@ -78,6 +326,7 @@ UMantleEngine::UMantleEngine(const FObjectInitializer& ObjectInitializer)
 	EndPhysicsLoop.TickGroup = ETickingGroup::TG_EndPhysics;
 	PostPhysicsLoop.TickGroup = ETickingGroup::TG_PostPhysics;
 	FrameEndLoop.TickGroup = ETickingGroup::TG_LastDemotable;
+	FrameEndLoop.bIsFrameEnd = true;
 
 	MantleDB = CreateDefaultSubobject<UMantleDB>(TEXT("MantleDB"));
 }
@@ -192,6 +441,7 @@ void UMantleEngine::Start(UWorld& World)
 	ActivateEngineLoop(EndPhysicsLoop, World);
 	ActivateEngineLoop(PostPhysicsLoop, World);
 	ActivateEngineLoop(FrameEndLoop, World);
+	AddAsyncLoopPrerequisites();
 
 	EngineState = EMantleEngineState::Started;
 	ANANKE_LOG_OBJECT(this, LogMantle, Log, TEXT("MantleEngine started."));
@@ -200,6 +450,7 @@ void UMantleEngine::Start(UWorld& World)
 void UMantleEngine::Stop()
 {
 	ANANKE_LOG_OBJECT(this, LogMantle, Log, TEXT("Stopping MantleEngine."));
+	RemoveAsyncLoopPrerequisites();
 	DeactivateEngineLoop(PrePhysicsLoop);
 	DeactivateEngineLoop(StartPhysicsLoop);
 	DeactivateEngineLoop(DuringPhysicsLoop);
@@ -221,14 +472,77 @@ void UMantleEngine::ActivateEngineLoop(FMantleEngineLoop& TickFunction, UWorld&
 {
 	TickFunction.OperationContext.MantleDB = MantleDB.Get();
 	TickFunction.OperationContext.World = &World;
+	TickFunction.BuildSchedule();
 	TickFunction.RegisterTickFunction(World.PersistentLevel);
 	TickFunction.SetTickFunctionEnable(true);
+
+	if (TickFunction.IsAsync())
+	{
+		FMantleAsyncLoopGate& AsyncLoopGate = TickFunction.AsyncLoopGate;
+		AsyncLoopGate.MantleDB = MantleDB.Get();
+		AsyncLoopGate.TickGroup = TickFunction.TickGroup;
+		AsyncLoopGate.RegisterTickFunction(World.PersistentLevel);
+		AsyncLoopGate.SetTickFunctionEnable(true);
+		TickFunction.AddPrerequisite(this, AsyncLoopGate);
+	}
 }
 
 void UMantleEngine::DeactivateEngineLoop(FMantleEngineLoop& TickFunction)
 {
+	if (TickFunction.AsyncLoopGate.IsTickFunctionRegistered())
+	{
+		TickFunction.RemovePrerequisite(this, TickFunction.AsyncLoopGate);
+		TickFunction.AsyncLoopGate.SetTickFunctionEnable(false);
+		TickFunction.AsyncLoopGate.MantleDB = nullptr;
+		TickFunction.AsyncLoopGate.UnRegisterTickFunction();
+	}
+	
 	TickFunction.SetTickFunctionEnable(false);
 	TickFunction.OperationContext.MantleDB = nullptr;
 	TickFunction.OperationContext.World = nullptr;
 	TickFunction.UnRegisterTickFunction();
-}
\ No newline at end of file
+}
+
+void UMantleEngine::AddAsyncLoopPrerequisites()
+{
+	TArray<FMantleEngineLoop*> EngineLoops = GetEngineLoops();
+	
+	for (int32 LoopIndex = 0; LoopIndex < EngineLoops.Num(); ++LoopIndex)
+	{
+		if (!EngineLoops[LoopIndex]->IsAsync())
+		{
+			continue;
+		}
+
+		// The loops share the DB, so a loop can't start until every async loop before it has finished. The tick task
+		// manager pushes a later loop back if it would otherwise start before the async loop's end tick group.
+		for (int32 LaterIndex = LoopIndex + 1; LaterIndex < EngineLoops.Num(); ++LaterIndex)
+		{
+			EngineLoops[LaterIndex]->AddPrerequisite(this, *EngineLoops[LoopIndex]);
+		}
+	}
+}
+
+void UMantleEngine::RemoveAsyncLoopPrerequisites()
+{
+	TArray<FMantleEngineLoop*> EngineLoops = GetEngineLoops();
+	
+	for (int32 LoopIndex = 0; LoopIndex < EngineLoops.Num(); ++LoopIndex)
+	{
+		if (!EngineLoops[LoopIndex]->IsAsync())
+		{
+			continue;
+		}
+		
+		for (int32 LaterIndex = LoopIndex + 1; LaterIndex < EngineLoops.Num(); ++LaterIndex)
+		{
+			EngineLoops[LaterIndex]->RemovePrerequisite(this, *EngineLoops[LoopIndex]);
+		}
+	}
+}
+
+TArray<FMantleEngineLoop*> UMantleEngine::GetEngineLoops()
+{
+	// In tick group order.
+	return {&PrePhysicsLoop, &StartPhysicsLoop, &DuringPhysicsLoop, &EndPhysicsLoop, &PostPhysicsLoop, &FrameEndLoop};
+}
@@ -0,0 +1,126 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Foundation/MantleFrameArena.h"
+
+namespace
+{
+	thread_local FMantleFrameArena* GActiveFrameArena = nullptr;
+}
+
+FMantleFrameArena::~FMantleFrameArena()
+{
+	for (FBlock& Block : Blocks)
+	{
+		FMemory::Free(Block.Data);
+	}
+}
+
+void* FMantleFrameArena::Allocate(SIZE_T Size, SIZE_T Alignment)
+{
+	if (CurrentBlock != INDEX_NONE)
+	{
+		const FBlock& Block = Blocks[CurrentBlock];
+		const SIZE_T AlignedOffset = Align(CurrentOffset, Alignment);
+		
+		if (AlignedOffset + Size <= Block.Size)
+		{
+			CurrentOffset = AlignedOffset + Size;
+			return Block.Data + AlignedOffset;
+		}
+	}
+
+	// New blocks start at kBlockAlignment, so the first allocation in a block is aligned as long as it doesn't ask for more.
+	check(Alignment <= kBlockAlignment);
+	
+	const SIZE_T LastBlockSize = Blocks.Num() > 0 ? Blocks.Last().Size : kDefaultBlockSize / 2;
+	AddBlock(FMath::Max(Size, LastBlockSize * 2));
+
+	CurrentOffset = Size;
+	return Blocks[CurrentBlock].Data;
+}
+
+void FMantleFrameArena::Reset()
+{
+	if (Blocks.Num() > 1)
+	{
+		// This tick didn't fit in one block. Replace all of them with one block that would have fit the whole tick.
+		SIZE_T TotalSize = 0;
+		for (FBlock& Block : Blocks)
+		{
+			TotalSize += Block.Size;
+			FMemory::Free(Block.Data);
+		}
+		Blocks.Reset();
+		
+		AddBlock(TotalSize);
+	}
+
+	CurrentBlock = Blocks.Num() > 0 ? 0 : INDEX_NONE;
+	CurrentOffset = 0;
+	BytesUsedInPreviousBlocks = 0;
+}
+
+SIZE_T FMantleFrameArena::GetBytesUsed() const
+{
+	return BytesUsedInPreviousBlocks + CurrentOffset;
+}
+
+FMantleFrameArena* FMantleFrameArena::GetActive()
+{
+	return GActiveFrameArena;
+}
+
+void FMantleFrameArena::AddBlock(SIZE_T MinSize)
+{
+	if (CurrentBlock != INDEX_NONE)
+	{
+		BytesUsedInPreviousBlocks += CurrentOffset;
+	}
+	
+	FBlock& NewBlock = Blocks.AddDefaulted_GetRef();
+	NewBlock.Size = Align(MinSize, kDefaultBlockSize);
+	NewBlock.Data = static_cast<uint8*>(FMemory::Malloc(NewBlock.Size, kBlockAlignment));
+
+	CurrentBlock = Blocks.Num() - 1;
+	CurrentOffset = 0;
+}
+
+FMantleFrameArenaScope::FMantleFrameArenaScope(FMantleFrameArena* Arena)
+{
+	PreviousArena = GActiveFrameArena;
+	GActiveFrameArena = Arena;
+}
+
+FMantleFrameArenaScope::~FMantleFrameArenaScope()
+{
+	GActiveFrameArena = PreviousArena;
+}
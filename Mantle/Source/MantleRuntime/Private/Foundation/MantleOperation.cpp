@@ -33,6 +33,28 @@
 
 #include "MantleRuntimeLoggingDefs.h"
 
+void FMantleOperationContext::Defer(FMantleCommand&& Command)
+{
+	if (Commands)
+	{
+		Commands->Add(MoveTemp(Command));
+		return;
+	}
+
+	if (!MantleDB.IsValid())
+	{
+		return;
+	}
+
+#if MANTLE_WITH_ACCESS_CHECKS
+	// The command would normally run after the operation has finished, so it isn't bound by the operation's access.
+	FMantleComponentAccess UncheckedAccess;
+	FMantleAccessChecker AccessChecker(UncheckedAccess, nullptr);
+#endif
+
+	Command(*MantleDB);
+}
+
 UMantleOperation::~UMantleOperation()
 {
 	UE_LOG(LogMantle, Log, TEXT("Operation %s is being deleted."), *GetClass()->GetName());		
@@ -49,6 +71,13 @@ void UMantleOperation::Run(FMantleOperationContext& Ctx)
 		return;
 	}
 
+#if MANTLE_WITH_ACCESS_CHECKS
+	FMantleAccessChecker AccessChecker(ComponentAccess, this);
+#endif
+
+	// Lets FMantleScratchAllocator arrays created by this operation allocate from the tick's arena.
+	FMantleFrameArenaScope FrameArenaScope(Ctx.FrameArena);
+	
 	PerformOperation(Ctx);
 }
 
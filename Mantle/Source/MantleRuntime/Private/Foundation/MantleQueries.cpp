@@ -30,8 +30,19 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Foundation/MantleQueries.h"
+#include "Foundation/MantleComponentSnapshot.h"
 
 #include "MantleRuntimeLoggingDefs.h"
+#include "Misc/ScopeRWLock.h"
+
+FMantleIterator::FMantleIterator(TSharedPtr<const FMantleComponentSnapshot, ESPMode::ThreadSafe> NewSnapshot)
+{
+	if (NewSnapshot.IsValid())
+	{
+		LocalCache = NewSnapshot->Query;
+		Snapshot = MoveTemp(NewSnapshot);
+	}
+}
 
 TArrayView<FGuid> FMantleIterator::GetEntities()
 {
@@ -61,6 +72,76 @@ TArrayView<FGuid> FMantleIterator::GetEntities()
 	return LocalCache.MatchingEntries[EntryIndex].ChunkedEntityIds[ChunkIndex];
 }
 
+FGuid FMantleIterator::GetChunkId()
+{
+	if (!IsValid())
+	{
+		UE_LOG(LogMantle, Error, TEXT("Attempted to call GetChunkId() on invalid Iterator."));
+		return FGuid();
+	}
+
+	if (EntryIndex < 0 || EntryIndex >= LocalCache.MatchingEntries.Num())
+	{
+		UE_LOG(LogMantle, Error, TEXT("Attempted to call GetChunkId() on invalid Iterator."));
+		return FGuid();
+	}
+
+	const TArray<FGuid>& ChunkIds = LocalCache.MatchingEntries[EntryIndex].ChunkIds;
+	if (ChunkIndex < 0 || ChunkIndex >= ChunkIds.Num())
+	{
+		return FGuid();
+	}
+
+	return ChunkIds[ChunkIndex];
+}
+
+uint32 FMantleIterator::GetChunkEntitiesVersion()
+{
+	if (!IsValid() || !LocalCache.MatchingEntries.IsValidIndex(EntryIndex))
+	{
+		return 0;
+	}
+
+	const TArray<FMantleDBChunkHeader*>& ChunkHeaders = LocalCache.MatchingEntries[EntryIndex].ChunkHeaders;
+	if (!ChunkHeaders.IsValidIndex(ChunkIndex) || !ChunkHeaders[ChunkIndex])
+	{
+		return 0;
+	}
+
+	return ChunkHeaders[ChunkIndex]->EntitiesVersion;
+}
+
+bool FMantleIterator::MoveToChunk(const FMantleEntity& Entity)
+{
+	if (!IsValid())
+	{
+		UE_LOG(LogMantle, Error, TEXT("Attempted to call MoveToChunk() on invalid Iterator."));
+		return false;
+	}
+
+	// Each entry holds a single archetype, so only the entity's own entry needs to be searched.
+	for (int32 MatchingEntryIndex = 0; MatchingEntryIndex < LocalCache.MatchingEntries.Num(); ++MatchingEntryIndex)
+	{
+		const FMantleCachedEntry& Entry = LocalCache.MatchingEntries[MatchingEntryIndex];
+		if (Entry.Archetype != Entity.Archetype)
+		{
+			continue;
+		}
+
+		const int32 MatchingChunkIndex = Entry.ChunkIds.IndexOfByKey(Entity.ChunkId);
+		if (MatchingChunkIndex == INDEX_NONE)
+		{
+			return false;
+		}
+
+		EntryIndex = MatchingEntryIndex;
+		ChunkIndex = MatchingChunkIndex;
+		return true;
+	}
+
+	return false;
+}
+
 bool FMantleIterator::Next()
 {
 	if (!IsValid())
@@ -107,6 +188,12 @@ void FMantleIterator::Reset()
 
 bool FMantleIterator::IsValid()
 {
+	// Snapshots never change once published.
+	if (Snapshot.IsValid())
+	{
+		return true;
+	}
+	
 	// Our local cache may have gone out of date. Check the DB to see.
 	
 	if (!MasterRecord)
@@ -114,6 +201,7 @@ bool FMantleIterator::IsValid()
 		return false;
 	}
 
+	FReadScopeLock ReadLock(MasterRecord->QueryCacheLock);
 	FMantleCachedQuery* DBCachedQuery = MasterRecord->CachedQueries.Find(LocalCache.QueryArchetype);
 
 	if (!DBCachedQuery)
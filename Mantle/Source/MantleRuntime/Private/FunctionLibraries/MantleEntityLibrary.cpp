@@ -50,6 +50,20 @@ bool UMantleEntityLibrary::SetEntityAvatar(
 		UE_LOG(LogMantle, Error, TEXT("Unable to set entity avatar: EntityId is not valid."));
 		return false;
 	}
+	if (!MantleDB->CanAccessDirectly())
+	{
+		MantleDB->GetCommandQueue().Enqueue(
+			[EntityId, WeakAvatarActor = TWeakObjectPtr<AActor>(&NewAvatarActor), bForce, bRemoveOldComponent](
+				UMantleDB& QueuedDB)
+			{
+				if (AActor* AvatarActor = WeakAvatarActor.Get())
+				{
+					SetEntityAvatar(&QueuedDB, EntityId, *AvatarActor, bForce, bRemoveOldComponent);
+				}
+			}
+		);
+		return true;
+	}
 
 	auto* Avatar = MantleDB->GetComponent<FMC_AvatarActor>(EntityId);
 	UMantleAvatarComponent* OldActorComponent = nullptr;
@@ -70,6 +84,7 @@ bool UMantleEntityLibrary::SetEntityAvatar(
 		}
 
 		Avatar->SetAvatarActor(&NewAvatarActor);
+		MantleDB->UpdateAvatarIndex(EntityId, &NewAvatarActor);
 	}
 	else
 	{
@@ -78,7 +93,8 @@ bool UMantleEntityLibrary::SetEntityAvatar(
 		MantleDB->UpdateEntity(EntityId, ToAdd);
 	}
 
-	UMantleAvatarComponent* NewActorComponent = Avatar->GetActorComponent();
+	// Avatar is null if FMC_AvatarActor was just added, so look the component up on the new actor directly.
+	UMantleAvatarComponent* NewActorComponent = GetAvatarFromActor(&NewAvatarActor);
 
 	if (NewActorComponent)
 	{
@@ -118,6 +134,14 @@ void UMantleEntityLibrary::ClearEntityAvatar(TObjectPtr<UMantleDB> MantleDB, FGu
 		UE_LOG(LogMantle, Error, TEXT("Unable to clear entity avatar: EntityId is not valid."));
 		return;
 	}
+	if (!MantleDB->CanAccessDirectly())
+	{
+		MantleDB->GetCommandQueue().Enqueue([EntityId, bRemoveOldComponent](UMantleDB& QueuedDB) mutable
+		{
+			ClearEntityAvatar(&QueuedDB, EntityId, bRemoveOldComponent);
+		});
+		return;
+	}
 
 	auto* Avatar = MantleDB->GetComponent<FMC_AvatarActor>(EntityId);
 	if (!Avatar)
@@ -37,47 +37,58 @@
 UEE_SimpleDamageEffect::UEE_SimpleDamageEffect(const FObjectInitializer& Initializer): Super(Initializer)
 {
 	Query.AddRequiredComponent<FEP_SimpleDamageEffect>();
+
+	ComponentAccess.AddRead<FEP_SimpleDamageEffect>();
+	ComponentAccess.AddWrite<FMC_Health>();
+
+	// Each batch only writes to the health of its own targets.
+	bCanExecuteBatchesInParallel = true;
 }
 
 void UEE_SimpleDamageEffect::LoadEffectPayloads(FMantleIterator& Iterator)
 {
-	EffectData = Iterator.GetArrayView<FEP_SimpleDamageEffect>();
+	EffectData.Add(Iterator.GetArrayView<const FEP_SimpleDamageEffect>());
 }
 
-FMantleEffectExecutionResult UEE_SimpleDamageEffect::Execute(FMantleOperationContext& Ctx, int32 EffectIndex, bool CancelRequested)
+void UEE_SimpleDamageEffect::ClearEffectPayloads()
 {
-	FMantleEffectExecutionResult Result;
+	EffectData.Reset();
+}
 
-	if (CancelRequested)
-	{
-		Result.ExecutionStatus = EMantleEffectExecutionStatus::Cancel;
-		return Result;
-	}
+void UEE_SimpleDamageEffect::GetEffectTargets(int32 PayloadChunk, TArrayView<FMantleEffectInvocation> Invocations)
+{
+	TArrayView<const FEP_SimpleDamageEffect> Payloads = EffectData[PayloadChunk];
 	
-	if (EffectIndex < 0 || EffectIndex >= EffectData.Num())
+	for (FMantleEffectInvocation& Invocation : Invocations)
 	{
-		ANANKE_LOG_PERIODIC(Error, TEXT("Invalid EffectIndex"), 1.0);
-		Result.ExecutionStatus = EMantleEffectExecutionStatus::Cancel;
-		return Result;
+		Invocation.TargetEntity = Payloads[Invocation.EffectIndex].TargetEntity;
 	}
+}
 
-	FEP_SimpleDamageEffect& DamageInfo = EffectData[EffectIndex];
-
-	if (!Ctx.MantleDB->HasComponent<FMC_Health>(DamageInfo.TargetEntity))
-	{
-		Result.ExecutionStatus = EMantleEffectExecutionStatus::Cancel;
-		return Result;
-	}
-	
-	FMC_Health* TargetHealth = Ctx.MantleDB->GetComponent<FMC_Health>(DamageInfo.TargetEntity);
-	if (!TargetHealth)
-	{
-		ANANKE_LOG_PERIODIC(Error, TEXT("TargetHeath is missing."), 1.0);
-		Result.ExecutionStatus = EMantleEffectExecutionStatus::Cancel;
-		return Result;
-	}
+void UEE_SimpleDamageEffect::ExecuteBatch(
+	FMantleOperationContext& Ctx,
+	TConstArrayView<FMantleEffectInvocation> Invocations,
+	TArrayView<FMantleEffectExecutionResult> OutResults)
+{
+	ExecuteComponentBatch<FMC_Health, FMC_HealthChangeEvent>(
+		Ctx,
+		Invocations,
+		OutResults,
+		[this](
+			const FMantleEffectInvocation& Invocation,
+			FMC_Health& TargetHealth,
+			TOptional<FMC_HealthChangeEvent>& OutHealthChange
+		)
+		{
+			const FEP_SimpleDamageEffect& DamageInfo = EffectData[Invocation.PayloadChunk][Invocation.EffectIndex];
 
-	TargetHealth->ApplyDamage(DamageInfo.DamageAmount);
-	Result.ExecutionStatus = EMantleEffectExecutionStatus::Succeeded;
-	return Result;
+			FMC_HealthChangeEvent HealthChange;
+			if (TargetHealth.ApplyDamage(DamageInfo.DamageAmount, &HealthChange))
+			{
+				HealthChange.Entity = Invocation.TargetEntity;
+				OutHealthChange = HealthChange;
+			}
+			return EMantleEffectExecutionStatus::Succeeded;
+		}
+	);
 }
@@ -37,54 +37,63 @@
 UEE_SimpleHealEffect::UEE_SimpleHealEffect(const FObjectInitializer& Initializer): Super(Initializer)
 {
 	Query.AddRequiredComponent<FEP_SimpleHealEffect>();
+
+	ComponentAccess.AddRead<FEP_SimpleHealEffect>();
+	ComponentAccess.AddWrite<FMC_Health>();
+
+	// Each batch only writes to the health of its own targets.
+	bCanExecuteBatchesInParallel = true;
 }
 
 void UEE_SimpleHealEffect::LoadEffectPayloads(FMantleIterator& Iterator)
 {
-	EffectData = Iterator.GetArrayView<FEP_SimpleHealEffect>();
+	EffectData.Add(Iterator.GetArrayView<const FEP_SimpleHealEffect>());
 }
 
-FMantleEffectExecutionResult UEE_SimpleHealEffect::Execute(FMantleOperationContext& Ctx, int32 EffectIndex, bool CancelRequested)
+void UEE_SimpleHealEffect::ClearEffectPayloads()
 {
-	FMantleEffectExecutionResult Result;
+	EffectData.Reset();
+}
 
-	if (CancelRequested)
-	{
-		Result.ExecutionStatus = EMantleEffectExecutionStatus::Cancel;
-		return Result;
-	}
+void UEE_SimpleHealEffect::GetEffectTargets(int32 PayloadChunk, TArrayView<FMantleEffectInvocation> Invocations)
+{
+	TArrayView<const FEP_SimpleHealEffect> Payloads = EffectData[PayloadChunk];
 	
-	if (EffectIndex < 0 || EffectIndex >= EffectData.Num())
+	for (FMantleEffectInvocation& Invocation : Invocations)
 	{
-		ANANKE_LOG_PERIODIC(Error, TEXT("Invalid EffectIndex"), 1.0);
-		Result.ExecutionStatus = EMantleEffectExecutionStatus::Cancel;
-		return Result;
+		Invocation.TargetEntity = Payloads[Invocation.EffectIndex].TargetEntity;
 	}
+}
 
-	FEP_SimpleHealEffect& HealInfo = EffectData[EffectIndex];
+void UEE_SimpleHealEffect::ExecuteBatch(
+	FMantleOperationContext& Ctx,
+	TConstArrayView<FMantleEffectInvocation> Invocations,
+	TArrayView<FMantleEffectExecutionResult> OutResults)
+{
+	ExecuteComponentBatch<FMC_Health, FMC_HealthChangeEvent>(
+		Ctx,
+		Invocations,
+		OutResults,
+		[this](
+			const FMantleEffectInvocation& Invocation,
+			FMC_Health& TargetHealth,
+			TOptional<FMC_HealthChangeEvent>& OutHealthChange
+		)
+		{
+			const FEP_SimpleHealEffect& HealInfo = EffectData[Invocation.PayloadChunk][Invocation.EffectIndex];
 
-	if (!Ctx.MantleDB->HasComponent<FMC_Health>(HealInfo.TargetEntity))
-	{
-		Result.ExecutionStatus = EMantleEffectExecutionStatus::Cancel;
-		return Result;
-	}
-	
-	FMC_Health* TargetHealth = Ctx.MantleDB->GetComponent<FMC_Health>(HealInfo.TargetEntity);
-	if (!TargetHealth)
-	{
-		ANANKE_LOG_PERIODIC(Error, "TargetHealth is missing", 1.0);
-		Result.ExecutionStatus = EMantleEffectExecutionStatus::Cancel;
-		return Result;
-	}
-	
-	if (TargetHealth->GetHealth() >= TargetHealth->GetMaxHealth().Value())
-	{
-		
-		Result.ExecutionStatus = EMantleEffectExecutionStatus::Failed;
-		return Result;
-	}
+			if (TargetHealth.GetHealth() >= TargetHealth.GetMaxHealth().Value())
+			{
+				return EMantleEffectExecutionStatus::Failed;
+			}
 
-	TargetHealth->ApplyHealing(HealInfo.HealAmount);
-	Result.ExecutionStatus = EMantleEffectExecutionStatus::Succeeded;
-	return Result;
-}
\ No newline at end of file
+			FMC_HealthChangeEvent HealthChange;
+			if (TargetHealth.ApplyHealing(HealInfo.HealAmount, &HealthChange))
+			{
+				HealthChange.Entity = Invocation.TargetEntity;
+				OutHealthChange = HealthChange;
+			}
+			return EMantleEffectExecutionStatus::Succeeded;
+		}
+	);
+}
@@ -0,0 +1,138 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "Operations/MO_HealthAccumulation.h"
+
+#include "MantleComponents/MC_Health.h"
+
+UMO_HealthAccumulation::UMO_HealthAccumulation(const FObjectInitializer& Initializer): Super(Initializer)
+{
+	ComponentAccess.AddWrite<FMC_Health>();
+}
+
+void UMO_HealthAccumulation::PerformOperation(FMantleOperationContext& Ctx)
+{
+	TConstArrayView<FMC_HealthModification> Modifications =
+		Ctx.MantleDB->GetEventChannel<FMC_HealthModification>().Read(ModificationCursor);
+
+	if (Modifications.IsEmpty())
+	{
+		return;
+	}
+
+	// Sort so that each target's modifications are contiguous, with its Highest modifications grouped by StackingGroup.
+	TArray<FMC_HealthModification, FMantleScratchAllocator> SortedModifications;
+	SortedModifications.Append(Modifications.GetData(), Modifications.Num());
+	SortedModifications.Sort([](const FMC_HealthModification& A, const FMC_HealthModification& B)
+	{
+		if (A.TargetEntity != B.TargetEntity)
+		{
+			return A.TargetEntity < B.TargetEntity;
+		}
+		if (A.Stacking != B.Stacking)
+		{
+			return A.Stacking < B.Stacking;
+		}
+		return A.StackingGroup.FastLess(B.StackingGroup);
+	});
+
+	TArray<FGuid, FMantleScratchAllocator> Targets;
+	TArray<float, FMantleScratchAllocator> NetAmounts;
+	
+	int32 ModificationIndex = 0;
+	while (ModificationIndex < SortedModifications.Num())
+	{
+		const FGuid TargetEntity = SortedModifications[ModificationIndex].TargetEntity;
+		float NetAmount = 0.0f;
+
+		while (ModificationIndex < SortedModifications.Num() && SortedModifications[ModificationIndex].TargetEntity == TargetEntity)
+		{
+			const FMC_HealthModification& GroupStart = SortedModifications[ModificationIndex++];
+			
+			if (GroupStart.Stacking == EMC_HealthStacking::Additive)
+			{
+				NetAmount += GroupStart.Amount;
+				continue;
+			}
+
+			float StrongestAmount = GroupStart.Amount;
+			while (
+				ModificationIndex < SortedModifications.Num() &&
+				SortedModifications[ModificationIndex].TargetEntity == TargetEntity &&
+				SortedModifications[ModificationIndex].StackingGroup == GroupStart.StackingGroup
+			)
+			{
+				const float Amount = SortedModifications[ModificationIndex++].Amount;
+				if (FMath::Abs(Amount) > FMath::Abs(StrongestAmount))
+				{
+					StrongestAmount = Amount;
+				}
+			}
+			NetAmount += StrongestAmount;
+		}
+
+		Targets.Add(TargetEntity);
+		NetAmounts.Add(NetAmount);
+	}
+
+	TArray<FMC_Health*, FMantleScratchAllocator> TargetHealths;
+	TargetHealths.SetNumUninitialized(Targets.Num());
+	Ctx.MantleDB->GetComponents<FMC_Health>(Targets, TargetHealths);
+
+	TArray<FMC_HealthChangeEvent, FMantleScratchAllocator> HealthChanges;
+	TArray<FGuid, FMantleScratchAllocator> ModifiedTargets;
+
+	for (int32 TargetIndex = 0; TargetIndex < Targets.Num(); ++TargetIndex)
+	{
+		// Targets that no longer exist (or never had health) are skipped.
+		FMC_Health* TargetHealth = TargetHealths[TargetIndex];
+		const float NetAmount = NetAmounts[TargetIndex];
+		if (!TargetHealth || NetAmount == 0.0f)
+		{
+			continue;
+		}
+		
+		FMC_HealthChangeEvent HealthChange;
+		const bool bChanged = NetAmount > 0.0f
+			? TargetHealth->ApplyHealing(NetAmount, &HealthChange)
+			: TargetHealth->ApplyDamage(NetAmount, &HealthChange);
+		
+		if (bChanged)
+		{
+			HealthChange.Entity = Targets[TargetIndex];
+			HealthChanges.Add(HealthChange);
+			ModifiedTargets.Add(Targets[TargetIndex]);
+		}
+	}
+
+	Ctx.MantleDB->GetEventChannel<FMC_HealthChangeEvent>().Write(HealthChanges);
+	Ctx.MantleDB->NotifyComponentsSet<FMC_Health>(ModifiedTargets);
+}
@@ -32,6 +32,7 @@
 #include "Operations/MO_ImpactDamage.h"
 
 #include "MantleComponents/MC_Collision.h"
+#include "MantleComponents/MC_Health.h"
 #include "..\..\Public\MantleComponents\MC_Owner.h"
 #include "MantleComponents/MC_SimpleImpactDamage.h"
 #include "MantleComponents/EffectPayloads/EP_EffectMetadata.h"
@@ -39,76 +40,76 @@
 
 UMO_ImpactDamage::UMO_ImpactDamage(const FObjectInitializer& Initializer): Super(Initializer)
 {
-	SimpleImpactQuery.AddRequiredComponent<FMC_Collision>();
-	SimpleImpactQuery.AddRequiredComponent<FMC_SimpleImpactDamage>();
-	SimpleImpactQuery.AddRequiredComponent<FMC_Owner>();
+	SimpleImpactQuery.DeclareAccess(ComponentAccess);
 }
 
 void UMO_ImpactDamage::PerformOperation(FMantleOperationContext& Ctx)
 {
-	FMantleIterator ImpactQueryResult = Ctx.MantleDB->RunQuery(SimpleImpactQuery);
-	TArray<FEP_SimpleDamageEffect> EffectsToApply;
+	TArray<FMC_HealthModification, FMantleScratchAllocator> Hits;
 	
-	while (ImpactQueryResult.Next())
+	SimpleImpactQuery.ForEach(*Ctx.MantleDB, [&Hits](
+		FMC_Collision& CollisionInfo, const FMC_SimpleImpactDamage& ImpactDamage, const FMC_Owner& OwnerInfo)
 	{
-		TArrayView<FGuid> SourceEntities = ImpactQueryResult.GetEntities();
-		TArrayView<FMC_Collision> CollisionInfo = ImpactQueryResult.GetArrayView<FMC_Collision>();
-		TArrayView<FMC_SimpleImpactDamage> DamageInfo = ImpactQueryResult.GetArrayView<FMC_SimpleImpactDamage>();
-		TArrayView<FMC_Owner> OwnerInfo = ImpactQueryResult.GetArrayView<FMC_Owner>();
-
-		for (int32 EntityIndex = 0; EntityIndex < SourceEntities.Num(); ++EntityIndex)
+		const FGuid OwnerEntity = OwnerInfo.EntityId;
+		
+		for (FGuid TargetEntity : CollisionInfo.Entities)
 		{
-			FGuid OwnerEntity = OwnerInfo[EntityIndex].EntityId;
-			FMC_SimpleImpactDamage ImpactDamage = DamageInfo[EntityIndex];
+			bool bOwnerIsValid = OwnerEntity.IsValid();
+			bool bOwnerEqualsTarget = (OwnerEntity == TargetEntity);
+			bool bShouldIgnoreOwner = ImpactDamage.IgnoreOwner;
 			
-			for (FGuid TargetEntity : CollisionInfo[EntityIndex].Entities)
+			if (bOwnerIsValid && bOwnerEqualsTarget && bShouldIgnoreOwner)
 			{
-				bool bOwnerIsValid = OwnerEntity.IsValid();
-				bool bOwnerEqualsTarget = (OwnerEntity == TargetEntity);
-				bool bShouldIgnoreOwner = ImpactDamage.IgnoreOwner;
-				
-				if (bOwnerIsValid && bOwnerEqualsTarget && bShouldIgnoreOwner)
-				{
-					continue;
-				}
-				
-				FEP_SimpleDamageEffect NewEffect;
-				NewEffect.TargetEntity = TargetEntity;
-				NewEffect.DamageAmount = ImpactDamage.DamageAmount;
-				EffectsToApply.Add(NewEffect);
+				continue;
 			}
-
-			// TODO(): Move this cleanup step to a separate operation so that other operations can consume the data.
-			CollisionInfo[EntityIndex].Entities.Empty();
+			
+			FMC_HealthModification& Hit = Hits.Emplace_GetRef(TargetEntity, -FMath::Abs(ImpactDamage.DamageAmount));
+			Hit.Stacking = ImpactDamage.Stacking;
+			Hit.StackingGroup = ImpactDamage.StackingGroup;
 		}
-	}
 
-	EmitDamageEffects(Ctx, EffectsToApply);
+		// TODO(): Move this cleanup step to a separate operation so that other operations can consume the data.
+		CollisionInfo.Entities.Reset();
+	});
+
+	if (bEmitDamageEffects)
+	{
+		// Adding the effect entities is a structural change, so it waits until the engine loop plays back its commands.
+		// The hits have to outlive the tick's scratch memory for that.
+		Ctx.Defer([DeferredHits = TArray<FMC_HealthModification>(Hits)](UMantleDB& MantleDB)
+		{
+			EmitDamageEffects(MantleDB, DeferredHits);
+		});
+		return;
+	}
+	
+	Ctx.MantleDB->GetEventChannel<FMC_HealthModification>().Write(Hits);
 }
 
-void UMO_ImpactDamage::EmitDamageEffects(FMantleOperationContext& Ctx, TArray<FEP_SimpleDamageEffect>& Effects)
+void UMO_ImpactDamage::EmitDamageEffects(UMantleDB& MantleDB, TConstArrayView<FMC_HealthModification> Hits)
 {
 	TArray<FInstancedStruct> EffectTemplate;
 	EffectTemplate.Add(FInstancedStruct::Make(FEP_EffectMetadata::MakeOneTimeEffect()));
 	EffectTemplate.Add(FInstancedStruct::Make(FEP_SimpleDamageEffect()));
 	
-	FMantleIterator ResultIterator = Ctx.MantleDB->AddEntities(EffectTemplate, Effects.Num());
-	auto DataIterator = Effects.CreateIterator();
+	FMantleIterator ResultIterator = MantleDB.AddEntities(EffectTemplate, Hits.Num());
+	int32 DataIndex = 0;
 
-	while (ResultIterator.Next() && DataIterator)
+	while (ResultIterator.Next() && DataIndex < Hits.Num())
 	{
 		TArrayView<FGuid> Entities = ResultIterator.GetEntities();
 		TArrayView<FEP_SimpleDamageEffect> NewDamageEffects = ResultIterator.GetArrayView<FEP_SimpleDamageEffect>();
 
-		for (int32 EventIndex = 0; EventIndex < Entities.Num() && DataIterator; ++EventIndex, ++DataIterator)
+		for (int32 EventIndex = 0; EventIndex < Entities.Num() && DataIndex < Hits.Num(); ++EventIndex, ++DataIndex)
 		{
-			NewDamageEffects[EventIndex] = *DataIterator;
+			NewDamageEffects[EventIndex].TargetEntity = Hits[DataIndex].TargetEntity;
+			NewDamageEffects[EventIndex].DamageAmount = -Hits[DataIndex].Amount;
 		}
 	}
 
-	if (DataIterator)
+	if (DataIndex < Hits.Num())
 	{
-		// sanity check. There should never be any data left in this iterator.
-		UE_LOG(LogMantle, Error, TEXT("UMO_ImpactDamage: DataIterator was not completely consumed."));
+		// sanity check. There should never be any data left over.
+		UE_LOG(LogMantle, Error, TEXT("UMO_ImpactDamage: Effects were not completely consumed."));
 	}
 }
\ No newline at end of file
@@ -35,32 +35,31 @@
 
 UMO_TemporaryEntityCleanup::UMO_TemporaryEntityCleanup(const FObjectInitializer& Initializer): Super(Initializer)
 {
-	Query.AddRequiredComponent<FMC_TemporaryEntity>();
+	Query.DeclareAccess(ComponentAccess);
 }
 
 void UMO_TemporaryEntityCleanup::PerformOperation(FMantleOperationContext& Ctx)
 {
-	TArray<FGuid> EntitiesToDelete;
-	FMantleIterator Result = Ctx.MantleDB->RunQuery(Query);
-
-	while (Result.Next())
+	// Removing entities is a structural change, so it is deferred until the engine loop plays back its commands.
+	Ctx.Defer([WeakThis = TWeakObjectPtr<UMO_TemporaryEntityCleanup>(this)](UMantleDB& MantleDB)
 	{
-		TArrayView<FGuid> EntityIds = Result.GetEntities();
-		TArrayView<FMC_TemporaryEntity> DeletionInfo = Result.GetArrayView<FMC_TemporaryEntity>();
-
-		for (int32 EntityIndex = 0; EntityIndex < EntityIds.Num(); ++EntityIndex)
+		if (!WeakThis.IsValid())
 		{
-			if (DeletionInfo[EntityIndex].bReadyForDeletion)
-			{
-				EntitiesToDelete.Add(EntityIds[EntityIndex]);
-			}
+			return;
 		}
-	}
 
-	if (EntitiesToDelete.IsEmpty())
-	{
-		return;
-	}
-
-	Ctx.MantleDB->RemoveEntities(EntitiesToDelete);
+		// Temporary entities are usually all ready by the end of the frame, so most chunks are dropped in one step.
+		MantleDB.RemoveEntitiesWhere(
+			WeakThis->Query.GetComponentQuery(),
+			[](FMantleIterator& Iterator, TBitArray<>& OutShouldRemove)
+			{
+				TArrayView<const FMC_TemporaryEntity> DeletionInfo = Iterator.GetArrayView<const FMC_TemporaryEntity>();
+				
+				for (int32 EntityIndex = 0; EntityIndex < DeletionInfo.Num(); ++EntityIndex)
+				{
+					OutShouldRemove[EntityIndex] = DeletionInfo[EntityIndex].bReadyForDeletion;
+				}
+			}
+		);
+	});
 }
\ No newline at end of file
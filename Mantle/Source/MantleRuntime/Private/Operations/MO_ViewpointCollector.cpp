@@ -34,32 +34,119 @@
 #include "MantleComponents/MC_Viewpoint.h"
 #include "MantleRuntimeLoggingDefs.h"
 
-UMO_ViewpointCollector::UMO_ViewpointCollector(const FObjectInitializer& Initializer)
+UMO_ViewpointCollector::UMO_ViewpointCollector(const FObjectInitializer& Initializer): Super(Initializer)
 {
-	Query.AddRequiredComponent<FMC_Viewpoint>();
+	// Player controllers are only read on the game thread, through a deferred command (see PollViewpoints), so the
+	// operation itself can run anywhere. The poll query only reads, and viewpoints are written through GetComponents().
+	Query.DeclareAccess(ComponentAccess);
+	ComponentAccess.AddWrite<FMC_Viewpoint>();
+}
+
+void UMO_ViewpointCollector::PublishViewpoint(FGuid EntityId, const FVector& Location, const FRotator& Rotation)
+{
+	FMantleViewpointUpdate Update;
+	Update.EntityId = EntityId;
+	Update.Location = Location;
+	Update.Rotation = Rotation;
+	PublishedUpdates.Enqueue(MoveTemp(Update));
 }
 
 void UMO_ViewpointCollector::PerformOperation(FMantleOperationContext& Ctx)
 {
-	FMantleIterator QueryIterator = Ctx.MantleDB->RunQuery(Query);
+	const double CurrentTimeSec = FPlatformTime::Seconds();
+
+	StagedUpdates.Reset();
+	
+	FMantleViewpointUpdate Update;
+	while (PublishedUpdates.Dequeue(Update))
+	{
+		StagedUpdates.Add(MoveTemp(Update));
+	}
+
+	ApplyViewpointUpdates(*Ctx.MantleDB, StagedUpdates, EMantleViewpointUpdateMode::Push, CurrentTimeSec);
+
+	Ctx.Defer([WeakThis = TWeakObjectPtr<UMO_ViewpointCollector>(this)](UMantleDB& MantleDB)
+	{
+		if (WeakThis.IsValid())
+		{
+			WeakThis->PollViewpoints(MantleDB, FPlatformTime::Seconds());
+		}
+	});
+}
+
+void UMO_ViewpointCollector::PollViewpoints(UMantleDB& MantleDB, double CurrentTimeSec)
+{
+	PolledUpdates.Reset();
+
+	// Only viewpoints that moved (or whose timestamp is due for a refresh) are written, so chunks full of idle
+	// viewpoints aren't marked changed every run.
+	Query.ForEach(MantleDB, [this, CurrentTimeSec](const FGuid& EntityId, const FMC_Viewpoint& Viewpoint)
+	{
+		if (Viewpoint.UpdateMode != EMantleViewpointUpdateMode::Poll)
+		{
+			return;
+		}
+		
+		AController* SourceController = Viewpoint.GetViewpointSourceController();
+		
+		if (!SourceController)
+		{
+			ANANKE_LOG_PERIODIC(Error, TEXT("Invalid SourceController."), 1.0);
+			return;
+		}
+
+		FMantleViewpointUpdate Update;
+		Update.EntityId = EntityId;
+		SourceController->GetPlayerViewPoint(Update.Location, Update.Rotation);
+
+		if (
+			Update.Location == Viewpoint.Location && Update.Rotation == Viewpoint.Rotation &&
+			CurrentTimeSec - Viewpoint.LastTimeProcessedSec < TimestampRefreshIntervalSec
+		)
+		{
+			return;
+		}
+		PolledUpdates.Add(MoveTemp(Update));
+	});
+
+	ApplyViewpointUpdates(MantleDB, PolledUpdates, EMantleViewpointUpdateMode::Poll, CurrentTimeSec);
+}
+
+void UMO_ViewpointCollector::ApplyViewpointUpdates(
+	UMantleDB& MantleDB,
+	TConstArrayView<FMantleViewpointUpdate> Updates,
+	EMantleViewpointUpdateMode UpdateMode,
+	double CurrentTimeSec
+)
+{
+	if (Updates.IsEmpty())
+	{
+		return;
+	}
 
-	while (QueryIterator.Next())
+	TArray<FGuid, FMantleScratchAllocator> EntityIds;
+	EntityIds.SetNumUninitialized(Updates.Num());
+	for (int32 UpdateIndex = 0; UpdateIndex < Updates.Num(); ++UpdateIndex)
 	{
-		TArrayView<FMC_Viewpoint> Viewpoints = QueryIterator.GetArrayView<FMC_Viewpoint>();
+		EntityIds[UpdateIndex] = Updates[UpdateIndex].EntityId;
+	}
+
+	TArray<FMC_Viewpoint*, FMantleScratchAllocator> Viewpoints;
+	Viewpoints.SetNumUninitialized(Updates.Num());
+	MantleDB.GetComponents<FMC_Viewpoint>(EntityIds, Viewpoints);
 
-		for (FMC_Viewpoint& Viewpoint : Viewpoints)
+	// Updates are applied in order, so the most recent value for each entity wins.
+	for (int32 UpdateIndex = 0; UpdateIndex < Updates.Num(); ++UpdateIndex)
+	{
+		const FMantleViewpointUpdate& Update = Updates[UpdateIndex];
+		FMC_Viewpoint* Viewpoint = Viewpoints[UpdateIndex];
+		
+		if (!Viewpoint || Viewpoint->UpdateMode != UpdateMode)
 		{
-			AController* SourceController = Viewpoint.GetViewpointSourceController();
-			
-			if (!SourceController)
-			{
-				ANANKE_LOG_PERIODIC(Error, TEXT("Invalid SourceController."), 1.0);
-				continue;
-			}
-
-			// Copy data from the source into the Viewpoint component.
-			SourceController->GetPlayerViewPoint(Viewpoint.Location, Viewpoint.Rotation);
-			Viewpoint.LastTimeProcessedSec = FPlatformTime::Seconds();
+			continue;
 		}
+
+		Viewpoint->SetView(Update.Location, Update.Rotation);
+		Viewpoint->LastTimeProcessedSec = CurrentTimeSec;
 	}
 }
@@ -31,7 +31,6 @@
 
 #include "Operations\MO_ViewpointTrace.h"
 
-#include "ActorComponents/MantleAvatarComponent.h"
 #include "MantleComponents/MC_Avatar.h"
 #include "MantleComponents/MC_PerceptionEvent.h"
 #include "MantleComponents/MC_TemporaryEntity.h"
@@ -45,33 +44,84 @@ void UMO_ViewpointTrace::Initialize()
 	TraceQuery.AddRequiredComponent<FMC_AvatarActor>();
 	TraceQuery.AddRequiredComponent<FMC_Viewpoint>();
 	AddRequiredTraceComponent(TraceQuery);
+
+	// Traces against the world and writes perception events. Anything that has to happen on the game thread (async
+	// traces, debug drawing) or is a structural change (event entities) is deferred, so this isn't a sync point.
+	ComponentAccess.AddRead<FMC_AvatarActor>();
+	ComponentAccess.AddRead<FMC_Viewpoint>();
 }
 
 void UMO_ViewpointTrace::PerformOperation(FMantleOperationContext& Ctx)
+{
+	if (!TraceEntities(Ctx, false))
+	{
+		return;
+	}
+	
+	// The world's async trace API can only be used on the game thread.
+	Ctx.Defer([WeakThis = TWeakObjectPtr<UMO_ViewpointTrace>(this), World = Ctx.World](UMantleDB& MantleDB)
+	{
+		if (!WeakThis.IsValid() || !World.IsValid())
+		{
+			return;
+		}
+
+		FMantleOperationContext GameThreadCtx;
+		GameThreadCtx.MantleDB = &MantleDB;
+		GameThreadCtx.World = World;
+		WeakThis->TraceEntities(GameThreadCtx, true);
+	});
+}
+
+bool UMO_ViewpointTrace::TraceEntities(FMantleOperationContext& Ctx, bool bAsyncTraces)
 {
 	// Note: We don't know how many events will be emitted per entity, and therefore cannot reserve memory for this
 	//       array on each chunk iteration. As a potential optimization, we could create a 'max events' limit and then
 	//       always reserve that number of slots in this array per entity.
-	TArray<FMC_PerceptionEvent> PlayerEventsToEmit;
-	TArray<FMC_PerceptionEvent> AIEventsToEmit;
+	FVPTEventBuffer PlayerEventsToEmit;
+	FVPTEventBuffer AIEventsToEmit;
 
 	FMantleIterator QueryIterator = Ctx.MantleDB->RunQuery(TraceQuery);
+	const double CurrentTimeSec = FPlatformTime::Seconds();
+	bool bSkippedEntities = false;
 
 	while (QueryIterator.Next())
 	{
 		TArrayView<FGuid> Entities = QueryIterator.GetEntities();
-		TArrayView<FMC_AvatarActor> Avatars = QueryIterator.GetArrayView<FMC_AvatarActor>();
-		TArrayView<FMC_Viewpoint> Viewpoints = QueryIterator.GetArrayView<FMC_Viewpoint>();
+		TArrayView<const FMC_AvatarActor> Avatars = QueryIterator.GetArrayView<const FMC_AvatarActor>();
+		TArrayView<const FMC_Viewpoint> Viewpoints = QueryIterator.GetArrayView<const FMC_Viewpoint>();
 		LoadTraceData(QueryIterator);
 
 		for (int32 EntityIndex = 0; EntityIndex < Entities.Num(); ++EntityIndex)
 		{
 			FGuid& SourceEntity = Entities[EntityIndex];
-			FMC_AvatarActor& Avatar = Avatars[EntityIndex];
-			FMC_Viewpoint& Viewpoint = Viewpoints[EntityIndex];
+			const FMC_AvatarActor& Avatar = Avatars[EntityIndex];
+			const FMC_Viewpoint& Viewpoint = Viewpoints[EntityIndex];
 			FMC_ViewpointTrace& TraceOptions = GetTraceOptions(EntityIndex);
 
-			if (FPlatformTime::Seconds() - TraceOptions.LastScanTimeSec < TraceOptions.ScanRateSec)
+			if (TraceOptions.bAsyncTrace != bAsyncTraces)
+			{
+				bSkippedEntities = true;
+				continue;
+			}
+
+			FVPTEventBuffer* EventsToEmit;
+			if (Viewpoint.IsPlayerViewpoint())
+			{
+				EventsToEmit = &PlayerEventsToEmit;
+			}
+			else
+			{
+				EventsToEmit = &AIEventsToEmit;
+			}
+
+			// Async traces submitted on a previous run are collected before a new scan can be started.
+			if (TraceOptions.PendingTraceHandle.IsValid() && !CollectAsyncLineTrace(Ctx, SourceEntity, TraceOptions, EventsToEmit))
+			{
+				continue;
+			}
+			
+			if (CurrentTimeSec - TraceOptions.LastScanTimeSec < TraceOptions.ScanRateSec)
 			{
 				continue;
 			}
@@ -80,25 +130,37 @@ void UMO_ViewpointTrace::PerformOperation(FMantleOperationContext& Ctx)
 				ANANKE_LOG_PERIODIC(Error, TEXT("Invalid viewpoint."), 1.0);
 				continue;
 			}
-			if (FPlatformTime::Seconds() - Viewpoint.LastTimeProcessedSec > TraceOptions.MaxViewpointDataAgeSec)
+			if (
+				Viewpoint.UpdateMode == EMantleViewpointUpdateMode::Poll &&
+				CurrentTimeSec - Viewpoint.LastTimeProcessedSec > TraceOptions.MaxViewpointDataAgeSec
+			)
 			{
 				ANANKE_LOG_PERIODIC(Error, TEXT("Stale viewpoint data."), 1.0);
 				continue;
 			}
 
-			FVPTDebugSphereData DebugSphereData;
-			DebugSphereData.LifeTime = static_cast<float>(TraceOptions.ScanRateSec * 2);
-
-			TArray<FMC_PerceptionEvent>* EventsToEmit;
-			if (Viewpoint.IsPlayerViewpoint())
+			if (IsCoherentWithLastTrace(Ctx, Viewpoint, TraceOptions, CurrentTimeSec))
 			{
-				EventsToEmit = &PlayerEventsToEmit;
+				// We would see the same thing as last time, so reuse the last result.
+				TraceOptions.LastScanTimeSec = CurrentTimeSec;
+				
+				if (TraceOptions.BlockingHitRule == EBlockingHitEmission::All && TraceOptions.LastBlockingHit.HasTarget())
+				{
+					EventsToEmit->Add(TraceOptions.LastBlockingHit);
+				}
+				continue;
 			}
-			else
+
+			if (TraceOptions.bAsyncTrace)
 			{
-				EventsToEmit = &AIEventsToEmit;
+				SubmitAsyncLineTrace(Ctx, Avatar, Viewpoint, TraceOptions);
+				TraceOptions.LastScanTimeSec = CurrentTimeSec;
+				continue;
 			}
 
+			FVPTDebugSphereData DebugSphereData;
+			DebugSphereData.LifeTime = static_cast<float>(TraceOptions.ScanRateSec * 2);
+
 			PerformLineTrace(Ctx, SourceEntity, Avatar, Viewpoint, TraceOptions, DebugSphereData, EventsToEmit);
 
 			if (TraceOptions.bDrawDebugGeometry)
@@ -108,6 +170,20 @@ void UMO_ViewpointTrace::PerformOperation(FMantleOperationContext& Ctx)
 		}
 	}
 
+	for (FMC_PerceptionEvent& PlayerEvent : PlayerEventsToEmit)
+	{
+		PlayerEvent.bIsPlayerPerception = true;
+	}
+	
+	TMantleEventChannel<FMC_PerceptionEvent>& PerceptionChannel = Ctx.MantleDB->GetEventChannel<FMC_PerceptionEvent>();
+	PerceptionChannel.Write(PlayerEventsToEmit);
+	PerceptionChannel.Write(AIEventsToEmit);
+
+	if (!bEmitEventEntities)
+	{
+		return bSkippedEntities;
+	}
+	
 	if (PlayerEventsToEmit.Num() > 0)
 	{
 		auto FilterComponent = FInstancedStruct::Make(FMC_PlayerPerceptionEvent());
@@ -118,34 +194,110 @@ void UMO_ViewpointTrace::PerformOperation(FMantleOperationContext& Ctx)
 		auto FilterComponent = FInstancedStruct::Make(FMC_AIPerceptionEvent());
 		EmitPerceptionEvents(Ctx, AIEventsToEmit, FilterComponent);
 	}
+
+	return bSkippedEntities;
 }
 
 void UMO_ViewpointTrace::PerformLineTrace(
 	FMantleOperationContext& Ctx,
 	FGuid& SourceEntity,
-	FMC_AvatarActor& Avatar,
-	FMC_Viewpoint& Viewpoint,
+	const FMC_AvatarActor& Avatar,
+	const FMC_Viewpoint& Viewpoint,
 	FMC_ViewpointTrace& TraceOptions,
 	FVPTDebugSphereData& DebugSphereData,
-	TArray<FMC_PerceptionEvent>* OutEvents
+	FVPTEventBuffer* OutEvents
 )
 {
-	FVector TraceStartPoint = Viewpoint.Location;
-	FRotator TraceStartRotator = Viewpoint.Rotation;
-	FVector TraceDirection = TraceStartRotator.Vector();
-	FVector TraceEndPoint = TraceStartPoint + (TraceDirection * TraceOptions.ScanRange);
+	FVector TraceStartPoint;
+	FVector TraceEndPoint;
+	GetTraceSegment(Viewpoint, TraceOptions, TraceStartPoint, TraceEndPoint);
+	
+	TraceOptions.LastTraceLocation = Viewpoint.Location;
+	TraceOptions.LastTraceRotation = Viewpoint.Rotation;
+	TraceOptions.LastTraceTimeSec = FPlatformTime::Seconds();
+	TraceOptions.LastTraceViewpointVersion = Viewpoint.ChangeVersion;
+	
+	TArray<FHitResult> TraceResults;
+	Ctx.World->LineTraceMultiByChannel(
+		TraceResults, TraceStartPoint, TraceEndPoint, TraceOptions.TraceChannel, MakeTraceQueryParams(Avatar));
+	TraceOptions.LastScanTimeSec = FPlatformTime::Seconds();
 
-	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(UAnankeFirstPersonCameraTraceComponent_CollectPerceptionData), false);
+	ProcessTraceResults(Ctx, SourceEntity, TraceOptions, TraceResults, TraceEndPoint, DebugSphereData, OutEvents);
+}
 
-	if (AActor* AvatarActor = Avatar.GetAvatarActor())
+void UMO_ViewpointTrace::SubmitAsyncLineTrace(
+	FMantleOperationContext& Ctx,
+	const FMC_AvatarActor& Avatar,
+	const FMC_Viewpoint& Viewpoint,
+	FMC_ViewpointTrace& TraceOptions
+)
+{
+	FVector TraceStartPoint;
+	FVector TraceEndPoint;
+	GetTraceSegment(Viewpoint, TraceOptions, TraceStartPoint, TraceEndPoint);
+
+	TraceOptions.LastTraceLocation = Viewpoint.Location;
+	TraceOptions.LastTraceRotation = Viewpoint.Rotation;
+	TraceOptions.LastTraceTimeSec = FPlatformTime::Seconds();
+	TraceOptions.LastTraceViewpointVersion = Viewpoint.ChangeVersion;
+
+	TraceOptions.PendingTraceHandle = Ctx.World->AsyncLineTraceByChannel(
+		EAsyncTraceType::Multi,
+		TraceStartPoint,
+		TraceEndPoint,
+		TraceOptions.TraceChannel,
+		MakeTraceQueryParams(Avatar)
+	);
+	TraceOptions.PendingTraceEnd = TraceEndPoint;
+}
+
+bool UMO_ViewpointTrace::CollectAsyncLineTrace(
+	FMantleOperationContext& Ctx,
+	FGuid& SourceEntity,
+	FMC_ViewpointTrace& TraceOptions,
+	FVPTEventBuffer* OutEvents
+)
+{
+	FTraceDatum TraceData;
+	if (!Ctx.World->QueryTraceData(TraceOptions.PendingTraceHandle, TraceData))
 	{
-		QueryParams.AddIgnoredActor(AvatarActor);
+		if (Ctx.World->IsTraceHandleValid(TraceOptions.PendingTraceHandle, false))
+		{
+			// Still in flight.
+			return false;
+		}
+
+		// The results expired before we could collect them (e.g. the operation didn't run for a frame).
+		TraceOptions.PendingTraceHandle = FTraceHandle();
+		return true;
 	}
+
+	TraceOptions.PendingTraceHandle = FTraceHandle();
+
+	FVPTDebugSphereData DebugSphereData;
+	DebugSphereData.LifeTime = static_cast<float>(TraceOptions.ScanRateSec * 2);
 	
-	TArray<FHitResult> TraceResults;
-	Ctx.World->LineTraceMultiByChannel(TraceResults, TraceStartPoint, TraceEndPoint, TraceOptions.TraceChannel, QueryParams);
-	TraceOptions.LastScanTimeSec = FPlatformTime::Seconds();
+	ProcessTraceResults(
+		Ctx, SourceEntity, TraceOptions, TraceData.OutHits, TraceOptions.PendingTraceEnd, DebugSphereData, OutEvents);
+
+	if (TraceOptions.bDrawDebugGeometry)
+	{
+		DrawDebugGeometry(Ctx, DebugSphereData);
+	}
+
+	return true;
+}
 
+void UMO_ViewpointTrace::ProcessTraceResults(
+	FMantleOperationContext& Ctx,
+	FGuid& SourceEntity,
+	FMC_ViewpointTrace& TraceOptions,
+	const TArray<FHitResult>& TraceResults,
+	const FVector& TraceEndPoint,
+	FVPTDebugSphereData& DebugSphereData,
+	FVPTEventBuffer* OutEvents
+)
+{
 	if (TraceResults.Num() > 0)
 	{
 		DebugSphereData.Center = TraceResults[TraceResults.Num() - 1].Location;
@@ -159,22 +311,24 @@ void UMO_ViewpointTrace::PerformLineTrace(
 
 	bool bFoundValidBlockingHit = false;
 
-	for (FHitResult TraceResult : TraceResults)
+	// Resolve every hit actor to its entity up front using the DB's avatar index.
+	TArray<const AActor*, TInlineAllocator<16>> HitActors;
+	TArray<FGuid, TInlineAllocator<16>> HitEntities;
+	HitActors.Reserve(TraceResults.Num());
+	for (const FHitResult& TraceResult : TraceResults)
 	{
-		AActor* ResultActor = TraceResult.GetActor();
-
-		if (!ResultActor)
-		{
-			continue;
-		}
+		HitActors.Add(TraceResult.GetActor());
+	}
+	HitEntities.SetNum(HitActors.Num());
+	Ctx.MantleDB->FindEntitiesByActors(HitActors, HitEntities);
 
-		auto* AvatarComponent = Cast<UMantleAvatarComponent>(
-			ResultActor->GetComponentByClass(UMantleAvatarComponent::StaticClass()));
+	for (int32 HitIndex = 0; HitIndex < TraceResults.Num(); ++HitIndex)
+	{
+		const FHitResult& TraceResult = TraceResults[HitIndex];
+		FGuid TargetEntity = HitEntities[HitIndex];
 		
-		if (AvatarComponent && Ctx.MantleDB->HasEntity(AvatarComponent->GetEntityId()))
+		if (TargetEntity.IsValid())
 		{
-			FGuid TargetEntity = AvatarComponent->GetEntityId();
-
 			if (!EntityIsValidTarget(Ctx,TargetEntity))
 			{
 				continue;
@@ -215,7 +369,7 @@ void UMO_ViewpointTrace::PerformLineTrace(
 
 void UMO_ViewpointTrace::EmitPerceptionEvents(
 	FMantleOperationContext& Ctx,
-	TArray<FMC_PerceptionEvent>& EventsToEmit,
+	TConstArrayView<FMC_PerceptionEvent> EventsToEmit,
 	FInstancedStruct& SourceFilter
 )
 {
@@ -226,45 +380,108 @@ void UMO_ViewpointTrace::EmitPerceptionEvents(
 	AddTraceEventTags(EventComponents);
 	EventComponents.Add(SourceFilter);
 
-	FMantleIterator ResultIterator = Ctx.MantleDB->AddEntities(EventComponents, EventsToEmit.Num());
-	auto DataIterator = EventsToEmit.CreateIterator();
-	
-	while (ResultIterator.Next() && DataIterator)
+	// Adding entities is a structural change, so it waits until the engine loop plays back its commands.
+	Ctx.Defer([EventComponents = MoveTemp(EventComponents), EventsToEmit = TArray<FMC_PerceptionEvent>(EventsToEmit)](
+		UMantleDB& MantleDB)
 	{
-		TArrayView<FGuid> Entities = ResultIterator.GetEntities();
-		TArrayView<FMC_PerceptionEvent> PerceptionEvents = ResultIterator.GetArrayView<FMC_PerceptionEvent>();
+		FMantleIterator ResultIterator = MantleDB.AddEntities(EventComponents, EventsToEmit.Num());
+		int32 DataIndex = 0;
+		
+		while (ResultIterator.Next() && DataIndex < EventsToEmit.Num())
+		{
+			TArrayView<FGuid> Entities = ResultIterator.GetEntities();
+			TArrayView<FMC_PerceptionEvent> PerceptionEvents = ResultIterator.GetArrayView<FMC_PerceptionEvent>();
+
+			for (int32 EventIndex = 0; EventIndex < Entities.Num() && DataIndex < EventsToEmit.Num(); ++EventIndex, ++DataIndex)
+			{
+				PerceptionEvents[EventIndex] = EventsToEmit[DataIndex];
+			}
+		}
 
-		for (int32 EventIndex = 0; EventIndex < Entities.Num() && DataIterator; ++EventIndex, ++DataIterator)
+		if (DataIndex < EventsToEmit.Num())
 		{
-			PerceptionEvents[EventIndex] = *DataIterator;
+			// sanity check. There should never be any data left over.
+			UE_LOG(LogMantle, Error, TEXT("UMO_ViewpointTrace: EventsToEmit was not completely consumed."));
 		}
+	});
+}
+
+void UMO_ViewpointTrace::DrawDebugGeometry(FMantleOperationContext& Ctx, FVPTDebugSphereData& DebugSphereData)
+{
+	// Debug drawing is only allowed on the game thread.
+	Ctx.Defer([World = Ctx.World, DebugSphereData](UMantleDB& MantleDB)
+	{
+		DrawDebugSphere(
+			World.Get(),
+			DebugSphereData.Center,
+			DebugSphereData.Radius,
+			DebugSphereData.Segments,
+			DebugSphereData.Color,
+			DebugSphereData.bPersistentLines,
+			DebugSphereData.LifeTime,
+			DebugSphereData.DepthPriority,
+			DebugSphereData.Thickness
+		);
+	});
+}
+
+bool UMO_ViewpointTrace::IsCoherentWithLastTrace(
+	FMantleOperationContext& Ctx,
+	const FMC_Viewpoint& Viewpoint,
+	FMC_ViewpointTrace& TraceOptions,
+	double CurrentTimeSec
+)
+{
+	if (!TraceOptions.bSkipCoherentTraces || TraceOptions.OverlapRule != EOverlapEmission::None)
+	{
+		return false;
+	}
+	if (CurrentTimeSec - TraceOptions.LastTraceTimeSec >= TraceOptions.CoherenceMaxIntervalSec)
+	{
+		return false;
+	}
+	if (TraceOptions.LastBlockingHit.HasTarget() && !Ctx.MantleDB->HasEntity(TraceOptions.LastBlockingHit.TargetEntity))
+	{
+		return false;
+	}
+	if (Viewpoint.ChangeVersion == TraceOptions.LastTraceViewpointVersion)
+	{
+		return true;
 	}
 
-	if (DataIterator)
+	const float LocationThresholdSquared = FMath::Square(TraceOptions.CoherenceLocationThreshold);
+	if (FVector::DistSquared(Viewpoint.Location, TraceOptions.LastTraceLocation) > LocationThresholdSquared)
 	{
-		// sanity check. There should never be any data left in this iterator.
-		UE_LOG(LogMantle, Error, TEXT("UMO_ViewpointTrace: DataIterator was not completely consumed."));
+		return false;
 	}
+
+	return Viewpoint.Rotation.Equals(TraceOptions.LastTraceRotation, TraceOptions.CoherenceRotationThresholdDeg);
 }
 
-void UMO_ViewpointTrace::DrawDebugGeometry(FMantleOperationContext& Ctx, FVPTDebugSphereData& DebugSphereData)
+void UMO_ViewpointTrace::GetTraceSegment(
+	const FMC_Viewpoint& Viewpoint, FMC_ViewpointTrace& TraceOptions, FVector& OutStart, FVector& OutEnd)
 {
-	DrawDebugSphere(
-		Ctx.World.Get(),
-		DebugSphereData.Center,
-		DebugSphereData.Radius,
-		DebugSphereData.Segments,
-		DebugSphereData.Color,
-		DebugSphereData.bPersistentLines,
-		DebugSphereData.LifeTime,
-		DebugSphereData.DepthPriority,
-		DebugSphereData.Thickness
-	);
+	FVector TraceDirection = Viewpoint.Rotation.Vector();
+	OutStart = Viewpoint.Location;
+	OutEnd = OutStart + (TraceDirection * TraceOptions.ScanRange);
+}
+
+FCollisionQueryParams UMO_ViewpointTrace::MakeTraceQueryParams(const FMC_AvatarActor& Avatar)
+{
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(UAnankeFirstPersonCameraTraceComponent_CollectPerceptionData), false);
+
+	if (AActor* AvatarActor = Avatar.GetAvatarActor())
+	{
+		QueryParams.AddIgnoredActor(AvatarActor);
+	}
+
+	return QueryParams;
 }
 
 void UMO_ViewpointTrace::AddRequiredTraceComponent(FMantleComponentQuery& Query)
 {
 	Query.AddRequiredComponent<FMC_ViewpointTrace>();
+	ComponentAccess.AddWrite<FMC_ViewpointTrace>();
 }
 
 void UMO_ViewpointTrace::LoadTraceData(FMantleIterator& Iterator)
@@ -30,19 +30,35 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "MantleRuntimeLoggingDefs.h"
+#include "Algo/Reverse.h"
+#include "Async/ParallelFor.h"
 #include "Containers/AnankeUntypedArrayView.h"
 #include "Containers/Array.h"
 #include "Containers/ArrayView.h"
 #include "Containers/UnrealString.h"
+#include "Foundation/MantleAsyncOperation.h"
+#include "Foundation/MantleComponentSnapshot.h"
 #include "Foundation/MantleDB.h"
+#include "Foundation/MantleEngine.h"
+#include "Foundation/MantleFrameArena.h"
 #include "Foundation/MantleQueries.h"
 #include "Logging/LogVerbosity.h"
+#include "MantleComponents/EffectPayloads/EP_EffectMetadata.h"
+#include "MantleComponents/EffectPayloads/EP_SimpleDamageEffect.h"
+#include "MantleComponents/EffectPayloads/EP_SimpleHealEffect.h"
+#include "MantleComponents/MC_Health.h"
 #include "Macros/AnankeCoreLoggingMacros.h"
 #include "Misc/AutomationTest.h"
+#include "Operations/EffectExecutions/EE_SimpleDamageEffect.h"
+#include "Operations/EffectExecutions/EE_SimpleHealEffect.h"
+#include "Operations/MO_HealthAccumulation.h"
 #include "Testing/Fakes/AnankeTestActor.h"
 #include "Testing/Fakes/FakeMantleComponents.h"
+#include "Testing/Fakes/FakeMantleOperations.h"
 #include "Testing/Macros/AnankeTestMacros.h"
 
+#include <atomic>
+
 #if WITH_EDITOR
 
 class TestSuite
@@ -328,10 +344,37 @@ public:
 		ANANKE_TEST_NOT_NULL(TestFramework, TestArchetypeChunk);
 		ANANKE_TEST_NOT_NULL(TestFramework, TestArchetypeChunk->ComponentBlob);
 
-		// Expected = (total bytes - alignment bytes) / (transform component bytes + targeting component bytes)
-		//          = (128*1024 - 16 - 8) / (96 + 24) = 1092
-		ANANKE_TEST_EQUAL(TestFramework, TestArchetypeChunk->TotalCapacity, 1092);
-		ANANKE_TEST_EQUAL(TestFramework, TestArchetypeChunk->EntityIds.Num(), 2);
+		// Expected = (total bytes - header bytes) / (id bytes + transform component bytes + targeting component bytes), as
+		// long as the columns still fit once each one is aligned to a cache line: (128*1024 - 64) / (16 + 96 + 24) = 963,
+		// which doesn't fit, so 962.
+		// Header: [0, 64), ids: [64, 15456), transform column: [15488, 107840), targeting column: [107840, 130928)
+		ANANKE_TEST_EQUAL(TestFramework, TestArchetypeChunk->TotalCapacity, 962);
+		{
+			// Columns are sorted by alignment, and each one starts on a cache line.
+			const FMantleComponentInfo* TransformInfo = TestArchetypeEntry->Get()->FindColumn(TransformComponentName);
+			const FMantleComponentInfo* TargetingInfo = TestArchetypeEntry->Get()->FindColumn(TargetingComponentName);
+			ANANKE_TEST_NOT_NULL(TestFramework, TransformInfo);
+			ANANKE_TEST_NOT_NULL(TestFramework, TargetingInfo);
+			if (TransformInfo && TargetingInfo)
+			{
+				ANANKE_TEST_EQUAL(TestFramework, TransformInfo->ChunkOffset, 15488);
+				ANANKE_TEST_EQUAL(TestFramework, TargetingInfo->ChunkOffset, 107840);
+				ANANKE_TEST_TRUE(TestFramework, IsAligned(TestArchetypeChunk->GetColumn(*TargetingInfo), Ananke::Mantle::kChunkColumnAlignment));
+			}
+		}
+		{
+			// The header describes the whole chunk.
+			FMantleDBChunkHeader* Header = TestArchetypeChunk->GetHeader();
+			ANANKE_TEST_EQUAL(TestFramework, Header->NumEntities, 2);
+			ANANKE_TEST_EQUAL(TestFramework, Header->TotalCapacity, 962);
+			ANANKE_TEST_EQUAL(TestFramework, Header->EntryIndex, TestArchetypeEntry->Get()->EntryIndex);
+			ANANKE_TEST_EQUAL(TestFramework, Header->NumColumns, 2);
+			ANANKE_TEST_EQUAL(TestFramework, Header->EntityIdsOffset, 64);
+			ANANKE_TEST_EQUAL(TestFramework, Header->GetColumnOffsets()[0], 15488);
+			ANANKE_TEST_EQUAL(TestFramework, Header->GetColumnOffsets()[1], 107840);
+			ANANKE_TEST_TRUE(TestFramework, TestArchetypeChunk->GetEntityIds()[1] == Result.GetEntities()[0]);
+		}
+		ANANKE_TEST_EQUAL(TestFramework, TestArchetypeChunk->GetNumEntities(), 2);
 		{
 			auto* ExtractedTransformComponent = (FFakeTransformComponent*)TestArchetypeChunk->GetComponentInternal(TransformComponentName, 0);
 			ANANKE_TEST_NOT_NULL(TestFramework, ExtractedTransformComponent);
@@ -368,11 +411,11 @@ public:
 
 		ComponentsToAdd.Add(FInstancedStruct::Make(FFakeItemComponent(TEXT("ItemName"), 2.5f, 5.99f)));
 
-		// Total archetype size should be = 960 + 96 + 24 = 1080
-		// Total alignment bytes should be = 16 + 16 + 8 = 40
-		// So capacity = (128*1024 - 40) / (1080) = 121
+		// Total archetype size should be = 960 + 96 + 24 = 1080, plus 16 bytes for each entity id.
+		// The chunk header takes up the first 64 bytes.
+		// So capacity = (128*1024 - 64) / (1080 + 16) = 119
 		//
-		// For 200 entities added, we would expect 121 to be in chunk 1 and 79 to be in chunk 2.
+		// For 200 entities added, we would expect 119 to be in chunk 1 and 81 to be in chunk 2.
 
 		TestFramework->TestEqual(TEXT("EntriesByArchetype.Num()"), MantleDB->EntriesByArchetype.Num(), 1);
 		FMantleIterator Result = MantleDB->AddEntities(ComponentsToAdd, 200);
@@ -387,14 +430,14 @@ public:
 
 		ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedComponents.Num(), 3);
 		ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedEntityIds.Num(), 2);
-		ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedEntityIds[0].Num(), 121);
-		ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedEntityIds[1].Num(), 79);
+		ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedEntityIds[0].Num(), 119);
+		ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedEntityIds[1].Num(), 81);
 
 		// Check entities at the boundaries and a couple in the middle.
 		TArray<TArray<int32>> EntitiesToCheck;
 		EntitiesToCheck.AddDefaulted(CachedEntry.ChunkedEntityIds.Num());
-		EntitiesToCheck[0].Append({0, 40, 80, 120});
-		EntitiesToCheck[1].Append({0, 26, 52, 78});
+		EntitiesToCheck[0].Append({0, 40, 80, 118});
+		EntitiesToCheck[1].Append({0, 27, 54, 80});
 
 		int32 ExpectedNumChunks = EntitiesToCheck.Num();
 
@@ -546,7 +589,7 @@ public:
 		{
 			return;
 		}
-		ANANKE_TEST_EQUAL(TestFramework, Entry->Chunks.Find(Entry->AllChunkIds[0])->EntityIds.Num(), 1100);
+		ANANKE_TEST_EQUAL(TestFramework, Entry->Chunks.Find(Entry->AllChunkIds[0])->GetNumEntities(), 1100);
 	}
 	
 	void Test_SingleArchetypeQuery()
@@ -611,7 +654,7 @@ public:
 			ChunksChecked++;
 		}
 		
-		ANANKE_TEST_EQUAL(TestFramework, ChunksChecked, 7);
+		ANANKE_TEST_EQUAL(TestFramework, ChunksChecked, 8);
 
 		TestWorld.Get()->EditorDestroyActor(TargetActor_Archetype2, false);
 		TestWorld.Get()->EditorDestroyActor(TargetActor_Archetype4, false);
@@ -654,19 +697,21 @@ public:
 		TArray<TArray<int32>> ExpectedCounts;
 		ExpectedCounts.AddDefaulted(2);
 		ExpectedCounts[0].Append({
-			8, // chunk 0: Archetype3
-			8, // chunk 1: Archetype3
-			8, // chunk 2: Archetype3
-			6  // chunk 3: Archetype3
+			6, // chunk 0: Archetype3
+			6, // chunk 1: Archetype3
+			6, // chunk 2: Archetype3
+			6, // chunk 3: Archetype3
+			6  // chunk 4: Archetype3
 		});
 		ExpectedCounts[1].Append({
-			6, // chunk 4: Archetype4
-			6, // chunk 5: Archetype4
-			6, // chunk 6: Archetype4
-			6, // chunk 7: Archetype4
-			6, // chunk 8: Archetype4
-			6, // chunk 9: Archetype4
-			4  // chunk 10: Archetype4
+			5, // chunk 5: Archetype4
+			5, // chunk 6: Archetype4
+			5, // chunk 7: Archetype4
+			5, // chunk 8: Archetype4
+			5, // chunk 9: Archetype4
+			5, // chunk 10: Archetype4
+			5, // chunk 11: Archetype4
+			5  // chunk 12: Archetype4
 		});
 
 		if(!ANANKE_TEST_EQUAL(TestFramework, Result.LocalCache.MatchingEntries.Num(), ExpectedCounts.Num()))
@@ -703,7 +748,7 @@ public:
 				FFakeItemComponent ItemComponent = ItemComponents[EntityIndex];
 				FFakeTransformComponent TransformComponent = TransformComponents[EntityIndex];
 				
-				if (ChunksChecked < 4) // The first 4 chunks should be Archetype3
+				if (ChunksChecked < 5) // The first 5 chunks should be Archetype3
 				{
 					TestFramework->TestEqual(
 						FString::Printf(TEXT("TransformComponent[%d][%d].Transform.Location"), ChunksChecked, EntityIndex),
@@ -732,7 +777,61 @@ public:
 			ChunksChecked++;
 		}
 
-		ANANKE_TEST_EQUAL(TestFramework, ChunksChecked, 11);
+		ANANKE_TEST_EQUAL(TestFramework, ChunksChecked, 13);
+
+		TestWorld.Get()->EditorDestroyActor(TargetActor_Archetype2, false);
+		TestWorld.Get()->EditorDestroyActor(TargetActor_Archetype4, false);
+	}
+
+	void Test_TypedQuery()
+	{
+		AAnankeTestActor* TargetActor_Archetype2 = TestWorld->SpawnActor<AAnankeTestActor>();
+		AAnankeTestActor* TargetActor_Archetype4 = TestWorld->SpawnActor<AAnankeTestActor>();
+		InitDBWithEntities(TargetActor_Archetype2, TargetActor_Archetype4);
+
+		TMantleQuery<const FFakeTransformComponent&, FFakeItemComponent&> Query;
+
+		int32 NumChunks = 0;
+		int32 NumEntities = 0;
+		Query.ForEachChunk(*MantleDB, [&](int32 ChunkSize, const FGuid* EntityIds, const FFakeTransformComponent* Transforms, FFakeItemComponent* Items)
+		{
+			NumChunks++;
+			NumEntities += ChunkSize;
+		});
+
+		ANANKE_TEST_EQUAL(TestFramework, NumChunks, 13);
+		ANANKE_TEST_EQUAL(TestFramework, NumEntities, 70); // 30 Archetype3 + 40 Archetype4
+
+		// Write through the query, then read back with the untyped iterator.
+		Query.ForEach(*MantleDB, [](const FGuid& EntityId, const FFakeTransformComponent& Transform, FFakeItemComponent& Item)
+		{
+			Item.Cost = Transform.Transform.GetLocation().X * 10.0f;
+		});
+		
+		FMantleComponentQuery UntypedQuery;
+		UntypedQuery.AddRequiredComponent<FFakeItemComponent>();
+		UntypedQuery.AddRequiredComponent<FFakeTransformComponent>();
+		FMantleIterator Result = MantleDB->RunQuery(UntypedQuery);
+
+		while (Result.Next())
+		{
+			TArrayView<FFakeTransformComponent> TransformComponents = Result.GetArrayView<FFakeTransformComponent>();
+			TArrayView<FFakeItemComponent> ItemComponents = Result.GetArrayView<FFakeItemComponent>();
+
+			for (int EntityIndex = 0; EntityIndex < ItemComponents.Num(); ++EntityIndex)
+			{
+				TestFramework->TestEqual(
+					TEXT("ItemComponent.Cost"),
+					ItemComponents[EntityIndex].Cost,
+					static_cast<float>(TransformComponents[EntityIndex].Transform.GetLocation().X * 10.0f)
+				);
+			}
+		}
+
+		FMantleComponentAccess Access;
+		Query.DeclareAccess(Access);
+		TestFramework->TestTrue(TEXT("Access.CanAccess(Transform)"), Access.CanAccess(FFakeTransformComponent::StaticStruct()->GetName()));
+		TestFramework->TestTrue(TEXT("Access.CanAccess(Item)"), Access.CanAccess(FFakeItemComponent::StaticStruct()->GetName()));
 
 		TestWorld.Get()->EditorDestroyActor(TargetActor_Archetype2, false);
 		TestWorld.Get()->EditorDestroyActor(TargetActor_Archetype4, false);
@@ -839,6 +938,88 @@ public:
 		TestWorld.Get()->EditorDestroyActor(TargetActor_3, false);
 	}
 
+	void Test_GetComponents()
+	{
+		AAnankeTestActor* TargetActor_Archetype2 = TestWorld->SpawnActor<AAnankeTestActor>();
+		AAnankeTestActor* TargetActor_Archetype4 = TestWorld->SpawnActor<AAnankeTestActor>();
+		InitDBWithEntities(TargetActor_Archetype2, TargetActor_Archetype4);
+
+		FMantleComponentQuery Query;
+		Query.AddRequiredComponent<FFakeTransformComponent>();
+
+		TArray<FGuid> EntityIds;
+		TArray<FVector> ExpectedLocations;
+		FMantleIterator Result = MantleDB->RunQuery(Query);
+		
+		while (Result.Next())
+		{
+			TArrayView<FGuid> Entities = Result.GetEntities();
+			TArrayView<FFakeTransformComponent> Transforms = Result.GetArrayView<FFakeTransformComponent>();
+			for (int32 EntityIndex = 0; EntityIndex < Entities.Num(); ++EntityIndex)
+			{
+				EntityIds.Add(Entities[EntityIndex]);
+				ExpectedLocations.Add(Transforms[EntityIndex].Transform.GetLocation());
+			}
+		}
+
+		if (!ANANKE_TEST_EQUAL(TestFramework, EntityIds.Num(), 100))
+		{
+			return;
+		}
+
+		// Look the entities up in reverse storage order, with an unknown entity mixed in.
+		const int32 UnknownEntityIndex = 5;
+		Algo::Reverse(EntityIds);
+		Algo::Reverse(ExpectedLocations);
+		EntityIds.Insert(FGuid::NewGuid(), UnknownEntityIndex);
+		ExpectedLocations.Insert(FVector::ZeroVector, UnknownEntityIndex);
+
+		TArray<FFakeTransformComponent*> Transforms;
+		Transforms.SetNum(EntityIds.Num());
+		MantleDB->GetComponents<FFakeTransformComponent>(EntityIds, Transforms);
+
+		ANANKE_TEST_TRUE(TestFramework, Transforms[UnknownEntityIndex] == nullptr);
+		for (int32 EntityIndex = 0; EntityIndex < EntityIds.Num(); ++EntityIndex)
+		{
+			if (EntityIndex == UnknownEntityIndex)
+			{
+				continue;
+			}
+			if (!TestFramework->TestNotNull(FString::Printf(TEXT("Transforms[%d]"), EntityIndex), Transforms[EntityIndex]))
+			{
+				continue;
+			}
+			TestFramework->TestEqual(
+				FString::Printf(TEXT("Transforms[%d].Transform.Location"), EntityIndex),
+				Transforms[EntityIndex]->Transform.GetLocation(),
+				ExpectedLocations[EntityIndex]
+			);
+		}
+
+		// Only archetypes 3 and 4 have an item component.
+		TArray<FFakeItemComponent*> Items;
+		Items.SetNum(EntityIds.Num());
+		MantleDB->GetComponents<FFakeItemComponent>(EntityIds, Items);
+
+		int32 ItemsFound = 0;
+		for (FFakeItemComponent* Item : Items)
+		{
+			ItemsFound += Item ? 1 : 0;
+		}
+		ANANKE_TEST_EQUAL(TestFramework, ItemsFound, 70);
+
+		int32 EntitiesVisited = 0;
+		MantleDB->ForEachComponent<FFakeTransformComponent>(EntityIds, [&](int32 EntityIndex, FFakeTransformComponent& Transform)
+		{
+			ANANKE_TEST_TRUE(TestFramework, &Transform == Transforms[EntityIndex]);
+			EntitiesVisited++;
+		});
+		ANANKE_TEST_EQUAL(TestFramework, EntitiesVisited, 100);
+
+		TestWorld.Get()->EditorDestroyActor(TargetActor_Archetype2, false);
+		TestWorld.Get()->EditorDestroyActor(TargetActor_Archetype4, false);
+	}
+
 	void Test_RemoveEntities()
 	{
 		AAnankeTestActor* TargetActor_Archetype2 = TestWorld->SpawnActor<AAnankeTestActor>();
@@ -853,19 +1034,21 @@ public:
 		TArray<TArray<int32>> ExpectedCountsBeforeRemoval;
 		ExpectedCountsBeforeRemoval.AddDefaulted(2);
 		ExpectedCountsBeforeRemoval[0].Append({
-			8, // chunk 0: Archetype3
-			8, // chunk 1: Archetype3
-			8, // chunk 2: Archetype3
-			6  // chunk 3: Archetype3
+			6, // chunk 0: Archetype3
+			6, // chunk 1: Archetype3
+			6, // chunk 2: Archetype3
+			6, // chunk 3: Archetype3
+			6  // chunk 4: Archetype3
 		});
 		ExpectedCountsBeforeRemoval[1].Append({
-			6, // chunk 0: Archetype4
-			6, // chunk 1: Archetype4
-			6, // chunk 2: Archetype4
-			6, // chunk 3: Archetype4
-			6, // chunk 4: Archetype4
-			6, // chunk 5: Archetype4
-			4  // chunk 6: Archetype4
+			5, // chunk 0: Archetype4
+			5, // chunk 1: Archetype4
+			5, // chunk 2: Archetype4
+			5, // chunk 3: Archetype4
+			5, // chunk 4: Archetype4
+			5, // chunk 5: Archetype4
+			5, // chunk 6: Archetype4
+			5  // chunk 7: Archetype4
 		});
 
 		if(!ANANKE_TEST_EQUAL(TestFramework, ResultBefore.LocalCache.MatchingEntries.Num(), ExpectedCountsBeforeRemoval.Num()))
@@ -913,19 +1096,21 @@ public:
 		TArray<TArray<int32>> ExpectedCountsAfterRemoval;
 		ExpectedCountsAfterRemoval.AddDefaulted(2);
 		ExpectedCountsAfterRemoval[0].Append({
-			4, // chunk 0: Archetype3
-			4, // chunk 1: Archetype3
-			4, // chunk 2: Archetype3
-			3  // chunk 3: Archetype3
+			3, // chunk 0: Archetype3
+			3, // chunk 1: Archetype3
+			3, // chunk 2: Archetype3
+			3, // chunk 3: Archetype3
+			3  // chunk 4: Archetype3
 		});
 		ExpectedCountsAfterRemoval[1].Append({
-			6, // chunk 0: Archetype4
-			6, // chunk 1: Archetype4
-			// 6, // chunk 2: Archetype4 (deleted)
-			6, // chunk 3: Archetype4
-			6, // chunk 4: Archetype4
-			6, // chunk 5: Archetype4
-			4  // chunk 6: Archetype4
+			5, // chunk 0: Archetype4
+			5, // chunk 1: Archetype4
+			// 5, // chunk 2: Archetype4 (deleted)
+			5, // chunk 3: Archetype4
+			5, // chunk 4: Archetype4
+			5, // chunk 5: Archetype4
+			5, // chunk 6: Archetype4
+			5  // chunk 7: Archetype4
 		});
 
 		if(!ANANKE_TEST_EQUAL(TestFramework, ResultAfter.LocalCache.MatchingEntries.Num(), ExpectedCountsAfterRemoval.Num()))
@@ -962,7 +1147,7 @@ public:
 				FFakeItemComponent ItemComponent = ItemComponents[EntityIndex];
 				FFakeTransformComponent TransformComponent = TransformComponents[EntityIndex];
 				
-				if (ChunksChecked < 4) // The first 4 chunks should be Archetype3
+				if (ChunksChecked < 5) // The first 5 chunks should be Archetype3
 					{
 					TestFramework->TestEqual(
 						FString::Printf(TEXT("TransformComponent[%d][%d].Transform.Location"), ChunksChecked, EntityIndex),
@@ -991,12 +1176,131 @@ public:
 			ChunksChecked++;
 		}
 
-		ANANKE_TEST_EQUAL(TestFramework, ChunksChecked, 10);
+		ANANKE_TEST_EQUAL(TestFramework, ChunksChecked, 12);
 
 		TestWorld.Get()->EditorDestroyActor(TargetActor_Archetype2, false);
 		TestWorld.Get()->EditorDestroyActor(TargetActor_Archetype4, false);
 	}
 
+	void Test_RemoveEntitiesWhere()
+	{
+		InitDB(1*1024); // 1kb per chunk.
+
+		const int32 NumberToAdd = 30;
+		TArray<FInstancedStruct> ToAdd;
+		auto Transform = FTransform(FVector(10.0f, 20.0f, 30.0f));
+		ToAdd.Add(FInstancedStruct::Make(FFakeTransformComponent(Transform)));
+		MantleDB->AddEntities(ToAdd, NumberToAdd);
+
+		FMantleComponentQuery Query;
+		Query.AddRequiredComponent<FFakeTransformComponent>();
+
+		// Remove every entity in the first chunk, and every other entity in the rest.
+		int32 ChunkCount = 0;
+		int32 ExpectedRemoved = 0;
+		const int32 NumRemoved = MantleDB->RemoveEntitiesWhere(
+			Query,
+			[&ChunkCount, &ExpectedRemoved](FMantleIterator& Iterator, TBitArray<>& OutShouldRemove)
+			{
+				for (int32 EntityIndex = 0; EntityIndex < OutShouldRemove.Num(); ++EntityIndex)
+				{
+					OutShouldRemove[EntityIndex] = (ChunkCount == 0 || EntityIndex % 2 == 0);
+				}
+				ExpectedRemoved += OutShouldRemove.CountSetBits();
+				++ChunkCount;
+			}
+		);
+
+		ANANKE_TEST_TRUE(TestFramework, ChunkCount > 1);
+		ANANKE_TEST_EQUAL(TestFramework, NumRemoved, ExpectedRemoved);
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->MasterRecord.EntitiesById.Num(), NumberToAdd - ExpectedRemoved);
+
+		int32 NumRemaining = 0;
+		FMantleIterator Result = MantleDB->RunQuery(Query);
+		while (Result.Next())
+		{
+			NumRemaining += Result.GetEntities().Num();
+		}
+		ANANKE_TEST_EQUAL(TestFramework, NumRemaining, NumberToAdd - ExpectedRemoved);
+
+		// The blob from the cleared chunk is kept for reuse.
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->MasterRecord.FreeBlobs.Num(), 1);
+	}
+
+	void Test_RemovedComponentsAreDestroyed()
+	{
+		TArray<UScriptStruct*> ComponentTypes;
+		ComponentTypes.Add(FFakeLifetimeComponent::StaticStruct());
+		ComponentTypes.Add(FFakeItemComponent::StaticStruct());
+		MantleDB->Initialize(ComponentTypes);
+
+		TArray<FInstancedStruct> ComponentsToAdd;
+		ComponentsToAdd.Add(FInstancedStruct::Make(FFakeLifetimeComponent()));
+		ComponentsToAdd.Add(FInstancedStruct::Make(FFakeItemComponent(TEXT("ItemName"), 1.0, 1.0)));
+		const int32 NumAliveBefore = FFakeLifetimeComponent::NumAlive;
+
+		FGuid EntityA = MantleDB->AddEntity(ComponentsToAdd);
+		FGuid EntityB = MantleDB->AddEntity(ComponentsToAdd);
+		FGuid EntityC = MantleDB->AddEntity(ComponentsToAdd);
+		ANANKE_TEST_EQUAL(TestFramework, FFakeLifetimeComponent::NumAlive, NumAliveBefore + 3);
+
+		// Removing an entity destroys its components.
+		MantleDB->RemoveEntity(EntityA);
+		ANANKE_TEST_EQUAL(TestFramework, FFakeLifetimeComponent::NumAlive, NumAliveBefore + 2);
+
+		// Moving an entity to a new archetype relocates the components it keeps...
+		TArray<UScriptStruct*> ItemToRemove;
+		ItemToRemove.Add(FFakeItemComponent::StaticStruct());
+		MantleDB->UpdateEntity(EntityB, ItemToRemove);
+		ANANKE_TEST_EQUAL(TestFramework, FFakeLifetimeComponent::NumAlive, NumAliveBefore + 2);
+
+		// ...and destroys the ones it loses.
+		TArray<UScriptStruct*> LifetimeToRemove;
+		LifetimeToRemove.Add(FFakeLifetimeComponent::StaticStruct());
+		MantleDB->UpdateEntity(EntityC, LifetimeToRemove);
+		ANANKE_TEST_EQUAL(TestFramework, FFakeLifetimeComponent::NumAlive, NumAliveBefore + 1);
+	}
+
+	void Test_GetOptionalArrayView()
+	{
+		TArray<UScriptStruct*> ComponentTypes;
+		ComponentTypes.Add(FFakeItemComponent::StaticStruct());
+		ComponentTypes.Add(FMC_Health::StaticStruct());
+		MantleDB->Initialize(ComponentTypes);
+
+		TArray<FInstancedStruct> HealthAndItem;
+		HealthAndItem.Add(FInstancedStruct::Make(FMC_Health(10.0f, 10.0f)));
+		HealthAndItem.Add(FInstancedStruct::Make(FFakeItemComponent(TEXT("ItemName"), 1.0f, 1.0f)));
+		MantleDB->AddEntity(HealthAndItem);
+
+		TArray<FInstancedStruct> HealthOnly;
+		HealthOnly.Add(FInstancedStruct::Make(FMC_Health(10.0f, 10.0f)));
+		MantleDB->AddEntity(HealthOnly);
+
+		// A component the query doesn't require can be read alongside it, but only where it exists.
+		FMantleComponentQuery HealthQuery;
+		HealthQuery.AddRequiredComponent<FMC_Health>();
+		FMantleIterator Iterator = MantleDB->RunQuery(HealthQuery);
+
+		int32 NumEntitiesWithItem = 0;
+		int32 NumEntitiesWithoutItem = 0;
+		while (Iterator.Next())
+		{
+			TArrayView<const FFakeItemComponent> Items = Iterator.GetOptionalArrayView<const FFakeItemComponent>();
+			if (Items.IsEmpty())
+			{
+				NumEntitiesWithoutItem += Iterator.GetEntities().Num();
+			}
+			else
+			{
+				ANANKE_TEST_EQUAL(TestFramework, Items.Num(), Iterator.GetEntities().Num());
+				NumEntitiesWithItem += Items.Num();
+			}
+		}
+		ANANKE_TEST_EQUAL(TestFramework, NumEntitiesWithItem, 1);
+		ANANKE_TEST_EQUAL(TestFramework, NumEntitiesWithoutItem, 1);
+	}
+
 	void Test_DBModificationInvalidatesIterator()
 	{
 		InitDB();
@@ -1023,6 +1327,909 @@ public:
 		ANANKE_TEST_FALSE(TestFramework, IteratorResult.IsValid());
 	}
 
+	void Test_QueryVersionAndChunkIds()
+	{
+		InitDB();
+
+		TArray<FInstancedStruct> ComponentsToAdd;
+		auto Transform = FTransform(FVector(10.0f, 20.0f, 30.0f));
+		ComponentsToAdd.Add(FInstancedStruct::Make(FFakeTransformComponent(Transform)));
+		FGuid EntityId = MantleDB->AddEntity(ComponentsToAdd);
+
+		FMantleComponentQuery Query;
+		Query.AddRequiredComponent<FFakeTransformComponent>();
+		
+		FMantleIterator QueryResult = MantleDB->RunQuery(Query);
+		FMantleDBVersion RecordedVersion = QueryResult.GetVersion();
+		ANANKE_TEST_TRUE(TestFramework, MantleDB->QueryIsUnchanged(Query, RecordedVersion));
+
+		if (!ANANKE_TEST_TRUE(TestFramework, QueryResult.Next()))
+		{
+			return;
+		}
+
+		const FMantleEntity* Entity = MantleDB->FindEntity(EntityId);
+		if (!ANANKE_TEST_TRUE(TestFramework, Entity != nullptr))
+		{
+			return;
+		}
+		ANANKE_TEST_TRUE(TestFramework, QueryResult.GetChunkId() == Entity->ChunkId);
+		
+		// Running the query again without modifying the DB should not change the version.
+		MantleDB->RunQuery(Query);
+		ANANKE_TEST_TRUE(TestFramework, MantleDB->QueryIsUnchanged(Query, RecordedVersion));
+
+		MantleDB->AddEntity(ComponentsToAdd);
+		ANANKE_TEST_FALSE(TestFramework, MantleDB->QueryIsUnchanged(Query, RecordedVersion));
+
+		// The new results have a different version.
+		ANANKE_TEST_FALSE(TestFramework, MantleDB->RunQuery(Query).GetVersion() == RecordedVersion);
+	}
+
+	void Test_EventChannel()
+	{
+		InitDB();
+
+		TMantleEventChannel<FFakeItemComponent>& Channel = MantleDB->GetEventChannel<FFakeItemComponent>();
+		ANANKE_TEST_TRUE(TestFramework, &Channel == &MantleDB->GetEventChannel<FFakeItemComponent>());
+
+		Channel.Write(FFakeItemComponent(TEXT("Sword"), 5.0, 10.0));
+		Channel.Write(FFakeItemComponent(TEXT("Shield"), 8.0, 15.0));
+
+		// Events can't be read until the channel is swapped.
+		FMantleEventCursor Cursor;
+		ANANKE_TEST_EQUAL(TestFramework, Channel.Read(Cursor).Num(), 0);
+
+		MantleDB->SwapEventChannels();
+		TConstArrayView<FFakeItemComponent> Events = Channel.Read(Cursor);
+		if (!ANANKE_TEST_EQUAL(TestFramework, Events.Num(), 2))
+		{
+			return;
+		}
+		TestFramework->TestEqual(TEXT("Events[0].Name"), Events[0].Name, TEXT("Sword"));
+		TestFramework->TestEqual(TEXT("Events[1].Name"), Events[1].Name, TEXT("Shield"));
+
+		// The cursor has already seen these events.
+		ANANKE_TEST_EQUAL(TestFramework, Channel.Read(Cursor).Num(), 0);
+		ANANKE_TEST_EQUAL(TestFramework, Channel.ReadAll().Num(), 2);
+
+		// Events that aren't read within a frame are dropped.
+		Channel.Write(FFakeItemComponent(TEXT("Potion"), 1.0, 2.0));
+		MantleDB->SwapEventChannels();
+		MantleDB->SwapEventChannels();
+		ANANKE_TEST_EQUAL(TestFramework, Channel.Read(Cursor).Num(), 0);
+	}
+
+	void Test_ComponentObservers()
+	{
+		AAnankeTestActor* TargetActor = TestWorld->SpawnActor<AAnankeTestActor>();
+		InitDB();
+
+		struct FObserverCalls
+		{
+			int32 NumCalls = 0;
+			int32 NumEntities = 0;
+		};
+		auto MakeObserver = [](FObserverCalls& Calls)
+		{
+			return FMantleComponentObserver::FDelegate::CreateLambda(
+				[&Calls](TWeakObjectPtr<UMantleDB> DB, TConstArrayView<FGuid> EntityIds)
+				{
+					Calls.NumCalls++;
+					Calls.NumEntities += EntityIds.Num();
+				});
+		};
+
+		FObserverCalls ItemAdded, ItemSet, ItemRemoved, TransformRemoved, TargetingAdded;
+		MantleDB->AddComponentObserver<FFakeItemComponent>(EMantleComponentEvent::Add, MakeObserver(ItemAdded));
+		MantleDB->AddComponentObserver<FFakeItemComponent>(EMantleComponentEvent::Set, MakeObserver(ItemSet));
+		MantleDB->AddComponentObserver<FFakeItemComponent>(EMantleComponentEvent::Remove, MakeObserver(ItemRemoved));
+		MantleDB->AddComponentObserver<FFakeTransformComponent>(EMantleComponentEvent::Remove, MakeObserver(TransformRemoved));
+		MantleDB->AddComponentObserver<FFakeTargetingComponent>(EMantleComponentEvent::Add, MakeObserver(TargetingAdded));
+
+		TArray<FGuid> EntityIds;
+		{
+			TArray<FInstancedStruct> Components;
+			Components.Add(FInstancedStruct::Make(FFakeTransformComponent(FTransform(FVector(1.0f, 1.0f, 1.0f)))));
+			Components.Add(FInstancedStruct::Make(FFakeItemComponent(TEXT("ItemName"), 10.0f, 1.0f)));
+			FMantleIterator Result = MantleDB->AddEntities(Components, 10);
+			while (Result.Next())
+			{
+				EntityIds.Append(Result.GetEntities());
+			}
+		}
+		if (!ANANKE_TEST_EQUAL(TestFramework, EntityIds.Num(), 10))
+		{
+			return;
+		}
+
+		// Transform+Item -> Item+Targeting. Item is overwritten, so it counts as a Set rather than an Add.
+		TArray<FGuid> EntitiesToUpdate = {EntityIds[0], EntityIds[1], EntityIds[2], EntityIds[3]};
+		TArray<FInstancedStruct> ToAdd;
+		ToAdd.Add(FInstancedStruct::Make(FFakeTargetingComponent(TargetActor, TEXT("TheTarget"))));
+		ToAdd.Add(FInstancedStruct::Make(FFakeItemComponent(TEXT("UpdatedItemName"), 20.0f, 2.0f)));
+		TArray<UScriptStruct*> ToRemove;
+		ToRemove.Add(FFakeTransformComponent::StaticStruct());
+		MantleDB->UpdateEntities(EntitiesToUpdate, ToAdd, ToRemove);
+
+		// Two updated entities (Item+Targeting) and one that wasn't updated (Transform+Item).
+		MantleDB->RemoveEntities({EntityIds[0], EntityIds[1], EntityIds[9]});
+
+		// Nothing is delivered until the observers are dispatched.
+		ANANKE_TEST_EQUAL(TestFramework, ItemAdded.NumCalls, 0);
+		
+		MantleDB->DispatchComponentObservers();
+
+		ANANKE_TEST_EQUAL(TestFramework, ItemAdded.NumCalls, 1);
+		ANANKE_TEST_EQUAL(TestFramework, ItemAdded.NumEntities, 10);
+		ANANKE_TEST_EQUAL(TestFramework, ItemSet.NumCalls, 1);
+		ANANKE_TEST_EQUAL(TestFramework, ItemSet.NumEntities, 4);
+		ANANKE_TEST_EQUAL(TestFramework, ItemRemoved.NumCalls, 1);
+		ANANKE_TEST_EQUAL(TestFramework, ItemRemoved.NumEntities, 3);
+		ANANKE_TEST_EQUAL(TestFramework, TransformRemoved.NumCalls, 1);
+		ANANKE_TEST_EQUAL(TestFramework, TransformRemoved.NumEntities, 5); // 4 updated + 1 removed
+		ANANKE_TEST_EQUAL(TestFramework, TargetingAdded.NumCalls, 1);
+		ANANKE_TEST_EQUAL(TestFramework, TargetingAdded.NumEntities, 4);
+
+		// Events are only delivered once.
+		MantleDB->DispatchComponentObservers();
+		ANANKE_TEST_EQUAL(TestFramework, ItemAdded.NumCalls, 1);
+		ANANKE_TEST_EQUAL(TestFramework, ItemSet.NumCalls, 1);
+
+		// In-place writes are only seen if they are reported.
+		MantleDB->NotifyComponentsSet<FFakeItemComponent>({EntityIds[5]});
+		MantleDB->DispatchComponentObservers();
+		ANANKE_TEST_EQUAL(TestFramework, ItemSet.NumCalls, 2);
+		ANANKE_TEST_EQUAL(TestFramework, ItemSet.NumEntities, 5);
+
+		TestWorld.Get()->EditorDestroyActor(TargetActor, false);
+	}
+
+	void Test_SideTable()
+	{
+		TArray<UScriptStruct*> ComponentTypes;
+		ComponentTypes.Add(FEP_EffectMetadata::StaticStruct());
+		MantleDB->Initialize(ComponentTypes);
+
+		TArray<FInstancedStruct> Components;
+		Components.Add(FInstancedStruct::Make(FEP_EffectMetadata::MakeOneTimeEffect()));
+		FGuid EffectWithCallbacks = MantleDB->AddEntity(Components);
+		FGuid EffectWithoutCallbacks = MantleDB->AddEntity(Components);
+
+		ANANKE_TEST_NOT_NULL(TestFramework, FEP_EffectCallbacks::Bind(*MantleDB, EffectWithCallbacks));
+		ANANKE_TEST_TRUE(TestFramework, FEP_EffectCallbacks::Bind(*MantleDB, FGuid::NewGuid()) == nullptr);
+
+		// Only the effect that was bound has the bit set and an entry in the table.
+		ANANKE_TEST_TRUE(TestFramework, MantleDB->GetComponent<FEP_EffectMetadata>(EffectWithCallbacks)->bHasCallbacks);
+		ANANKE_TEST_FALSE(TestFramework, MantleDB->GetComponent<FEP_EffectMetadata>(EffectWithoutCallbacks)->bHasCallbacks);
+
+		TMantleSideTable<FEP_EffectCallbacks>& CallbackTable = MantleDB->GetSideTable<FEP_EffectCallbacks>();
+		ANANKE_TEST_TRUE(TestFramework, &CallbackTable == &MantleDB->GetSideTable<FEP_EffectCallbacks>());
+		ANANKE_TEST_EQUAL(TestFramework, CallbackTable.Num(), 1);
+		ANANKE_TEST_NOT_NULL(TestFramework, CallbackTable.Find(EffectWithCallbacks));
+		ANANKE_TEST_TRUE(TestFramework, CallbackTable.Find(EffectWithoutCallbacks) == nullptr);
+
+		// Entries are dropped along with their entity.
+		MantleDB->RemoveEntities({EffectWithoutCallbacks, EffectWithCallbacks});
+		ANANKE_TEST_EQUAL(TestFramework, CallbackTable.Num(), 0);
+	}
+
+	void Test_CommandQueue()
+	{
+		InitDB();
+
+		TArray<FInstancedStruct> Components;
+		Components.Add(FInstancedStruct::Make(FFakeItemComponent(TEXT("ItemName"), 1.0f, 1.0f)));
+
+		// Commands can be queued from any number of threads at once.
+		ParallelFor(100, [this, &Components](int32 Index)
+		{
+			MantleDB->QueueAddEntity(Components);
+		});
+
+		FMantleComponentQuery Query;
+		Query.AddRequiredComponent<FFakeItemComponent>();
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->RunQuery(Query).LocalCache.MatchingEntries.Num(), 0);
+
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->ExecuteQueuedCommands(), 100);
+		
+		TArray<FGuid> EntityIds;
+		FMantleIterator Result = MantleDB->RunQuery(Query);
+		while (Result.Next())
+		{
+			EntityIds.Append(Result.GetEntities());
+		}
+		if (!ANANKE_TEST_EQUAL(TestFramework, EntityIds.Num(), 100))
+		{
+			return;
+		}
+
+		// Commands run in the order they were queued, so the update to the removed entity is skipped.
+		MantleDB->QueueComponentUpdate<FFakeItemComponent>(EntityIds[0], [](FFakeItemComponent& Item)
+		{
+			Item.Name = TEXT("UpdatedName");
+		});
+		MantleDB->QueueRemoveEntity(EntityIds[1]);
+		MantleDB->QueueComponentUpdate<FFakeItemComponent>(EntityIds[1], [](FFakeItemComponent& Item)
+		{
+			Item.Name = TEXT("UpdatedName");
+		});
+		MantleDB->QueueEvent(FFakeItemComponent(TEXT("Event"), 1.0f, 1.0f));
+		
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->ExecuteQueuedCommands(), 4);
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->ExecuteQueuedCommands(), 0);
+
+		TestFramework->TestEqual(TEXT("Item.Name"), MantleDB->GetComponent<FFakeItemComponent>(EntityIds[0])->Name, TEXT("UpdatedName"));
+		ANANKE_TEST_TRUE(TestFramework, MantleDB->FindEntity(EntityIds[1]) == nullptr);
+
+		MantleDB->SwapEventChannels();
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetEventChannel<FFakeItemComponent>().ReadAll().Num(), 1);
+	}
+
+	void Test_ExecuteOrQueue()
+	{
+		InitDB();
+
+		int32 NumRuns = 0;
+		auto Command = [&NumRuns](UMantleDB& QueuedDB)
+		{
+			NumRuns++;
+		};
+
+		MantleDB->ExecuteOrQueue(Command);
+		ANANKE_TEST_EQUAL(TestFramework, NumRuns, 1);
+
+		// While an async loop is running, the game thread has to queue its changes.
+		MantleDB->BeginAsyncLoop();
+		ANANKE_TEST_TRUE(TestFramework, MantleDB->IsAsyncLoopRunning());
+		ANANKE_TEST_FALSE(TestFramework, MantleDB->CanAccessDirectly());
+		
+		MantleDB->ExecuteOrQueue(Command);
+		ANANKE_TEST_EQUAL(TestFramework, NumRuns, 1);
+
+		// The thread that runs the loop can still use the DB directly.
+		MantleDB->EnterAsyncLoop();
+		ANANKE_TEST_TRUE(TestFramework, MantleDB->CanAccessDirectly());
+		MantleDB->EndAsyncLoop();
+
+		ANANKE_TEST_FALSE(TestFramework, MantleDB->IsAsyncLoopRunning());
+		ANANKE_TEST_TRUE(TestFramework, MantleDB->CanAccessDirectly());
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->ExecuteQueuedCommands(), 1);
+		ANANKE_TEST_EQUAL(TestFramework, NumRuns, 2);
+	}
+
+	void Test_ComponentAccessConflicts()
+	{
+		FMantleComponentAccess ReadsTransform;
+		ReadsTransform.AddRead<FFakeTransformComponent>();
+		
+		FMantleComponentAccess AlsoReadsTransform;
+		AlsoReadsTransform.AddRead<FFakeTransformComponent>();
+		
+		FMantleComponentAccess WritesTransform;
+		WritesTransform.AddWrite<FFakeTransformComponent>();
+		
+		FMantleComponentAccess WritesItem;
+		WritesItem.AddWrite<FFakeItemComponent>();
+		
+		FMantleComponentAccess Structural;
+		Structural.AddRead<FFakeItemComponent>();
+		Structural.AddStructuralChanges();
+		
+		FMantleComponentAccess Undeclared;
+
+		ANANKE_TEST_FALSE(TestFramework, ReadsTransform.ConflictsWith(AlsoReadsTransform));
+		ANANKE_TEST_FALSE(TestFramework, WritesTransform.ConflictsWith(WritesItem));
+		ANANKE_TEST_TRUE(TestFramework, ReadsTransform.ConflictsWith(WritesTransform));
+		ANANKE_TEST_TRUE(TestFramework, WritesTransform.ConflictsWith(ReadsTransform));
+		ANANKE_TEST_TRUE(TestFramework, WritesTransform.ConflictsWith(WritesTransform));
+		ANANKE_TEST_TRUE(TestFramework, ReadsTransform.ConflictsWith(Structural));
+		ANANKE_TEST_TRUE(TestFramework, Undeclared.ConflictsWith(ReadsTransform));
+		ANANKE_TEST_TRUE(TestFramework, ReadsTransform.ConflictsWith(Undeclared));
+
+#if MANTLE_WITH_ACCESS_CHECKS
+		// Mutable access needs a declared write; a read declaration only covers const access.
+		InitDB();
+		FTransform Transform = FTransform::Identity;
+		TArray<FInstancedStruct> Components;
+		Components.Add(FInstancedStruct::Make(FFakeTransformComponent(Transform)));
+		const FGuid EntityId = MantleDB->AddEntity(Components);
+
+		FMantleAccessChecker::ResetReportedViolations();
+		const int32 NumViolationsBefore = FMantleAccessChecker::GetNumViolations();
+		{
+			FMantleAccessChecker Checker(WritesTransform, nullptr);
+			ANANKE_TEST_NOT_NULL(TestFramework, MantleDB->GetComponent<FFakeTransformComponent>(EntityId));
+			ANANKE_TEST_NOT_NULL(TestFramework, MantleDB->GetComponent<const FFakeTransformComponent>(EntityId));
+		}
+		{
+			FMantleAccessChecker Checker(ReadsTransform, nullptr);
+			ANANKE_TEST_NOT_NULL(TestFramework, MantleDB->GetComponent<const FFakeTransformComponent>(EntityId));
+		}
+		ANANKE_TEST_EQUAL(TestFramework, FMantleAccessChecker::GetNumViolations(), NumViolationsBefore);
+
+		TestFramework->AddExpectedError(
+			TEXT("wrote to component FakeTransformComponent, which it only declared as read"),
+			EAutomationExpectedErrorFlags::Contains, 1);
+		{
+			FMantleAccessChecker Checker(ReadsTransform, nullptr);
+			ANANKE_TEST_NOT_NULL(TestFramework, MantleDB->GetComponent<FFakeTransformComponent>(EntityId));
+		}
+		ANANKE_TEST_EQUAL(TestFramework, FMantleAccessChecker::GetNumViolations(), NumViolationsBefore + 1);
+#endif
+	}
+
+	void Test_ConcurrentOperations()
+	{
+		InitDB();
+
+		auto MakeOperation = [](int32 OperationId)
+		{
+			UFakeConcurrentOperation* Operation = NewObject<UFakeConcurrentOperation>();
+			Operation->OperationId = OperationId;
+			return TStrongObjectPtr<UFakeConcurrentOperation>(Operation);
+		};
+		
+		TStrongObjectPtr<UFakeConcurrentOperation> FirstReader = MakeOperation(1);
+		FirstReader->GetMutableComponentAccess().AddRead<FFakeTransformComponent>();
+		TStrongObjectPtr<UFakeConcurrentOperation> SecondReader = MakeOperation(2);
+		SecondReader->GetMutableComponentAccess().AddRead<FFakeTransformComponent>();
+		TStrongObjectPtr<UFakeConcurrentOperation> Writer = MakeOperation(3);
+		Writer->GetMutableComponentAccess().AddWrite<FFakeTransformComponent>();
+
+		FMantleEngineLoop EngineLoop;
+		EngineLoop.Options.bRunMultithreaded = true;
+		EngineLoop.Options.OperationGroups.AddDefaulted_GetRef().Operations = {
+			FirstReader.Get(), SecondReader.Get(), Writer.Get()};
+		EngineLoop.OperationContext.MantleDB = MantleDB.Get();
+		EngineLoop.OperationContext.World = TestWorld.Get();
+		EngineLoop.BuildSchedule();
+
+		// The readers don't depend on anything, and the writer has to wait for both of them.
+		if (!ANANKE_TEST_EQUAL(TestFramework, EngineLoop.Schedule.Num(), 3))
+		{
+			return;
+		}
+		ANANKE_TEST_FALSE(TestFramework, EngineLoop.Schedule[0].bIsSyncPoint);
+		ANANKE_TEST_EQUAL(TestFramework, EngineLoop.Schedule[0].Dependencies.Num(), 0);
+		ANANKE_TEST_EQUAL(TestFramework, EngineLoop.Schedule[1].Dependencies.Num(), 0);
+		ANANKE_TEST_TRUE(TestFramework, EngineLoop.Schedule[2].Dependencies == TArray<int32>({0, 1}));
+
+		UFakeConcurrentOperation::ResetCounters();
+		EngineLoop.ExecuteTick(0.0f, LEVELTICK_All, ENamedThreads::GameThread, FGraphEventRef());
+
+		// The readers actually overlapped, and deferred commands still ran in schedule order.
+		ANANKE_TEST_EQUAL(TestFramework, UFakeConcurrentOperation::MaxRunning.load(), 2);
+		ANANKE_TEST_TRUE(TestFramework, UFakeConcurrentOperation::PlaybackOrder == TArray<int32>({1, 2, 3}));
+
+		// Conflicting operations never overlap.
+		EngineLoop.Options.OperationGroups[0].Operations = {FirstReader.Get(), Writer.Get()};
+		EngineLoop.BuildSchedule();
+		
+		UFakeConcurrentOperation::ResetCounters();
+		EngineLoop.ExecuteTick(0.0f, LEVELTICK_All, ENamedThreads::GameThread, FGraphEventRef());
+		
+		ANANKE_TEST_EQUAL(TestFramework, UFakeConcurrentOperation::MaxRunning.load(), 1);
+		ANANKE_TEST_TRUE(TestFramework, UFakeConcurrentOperation::PlaybackOrder == TArray<int32>({1, 3}));
+	}
+
+	void Test_PublishedSnapshots()
+	{
+		InitDB();
+		MantleDB->EnableSnapshot<FFakeItemComponent>();
+		ANANKE_TEST_TRUE(TestFramework, MantleDB->GetSnapshot<FFakeItemComponent>() == nullptr);
+
+		// Two archetypes, so the item column is spread across two chunks.
+		TArray<FInstancedStruct> ItemOnly;
+		ItemOnly.Add(FInstancedStruct::Make(FFakeItemComponent(TEXT("ItemName"), 1.0f, 1.0f)));
+		FGuid ItemEntity = MantleDB->AddEntity(ItemOnly);
+		
+		TArray<FInstancedStruct> ItemAndTransform = ItemOnly;
+		ItemAndTransform.Add(FInstancedStruct::Make(FFakeTransformComponent()));
+		MantleDB->AddEntities(ItemAndTransform, 10);
+
+		MantleDB->PublishSnapshots();
+		TSharedPtr<const FMantleComponentSnapshot, ESPMode::ThreadSafe> FirstSnapshot = MantleDB->GetSnapshot<FFakeItemComponent>();
+		if (!ANANKE_TEST_TRUE(TestFramework, FirstSnapshot.IsValid()))
+		{
+			return;
+		}
+		ANANKE_TEST_EQUAL(TestFramework, FirstSnapshot->GetPublishNumber(), static_cast<uint64>(1));
+		ANANKE_TEST_EQUAL(TestFramework, FirstSnapshot->NumEntities(), 11);
+		ANANKE_TEST_EQUAL(TestFramework, FirstSnapshot->NumCopiedChunks(), 2);
+
+		// Only the chunk that was written to is copied again. The other one is shared with the first snapshot.
+		MantleDB->GetComponent<FFakeItemComponent>(ItemEntity)->Name = TEXT("UpdatedName");
+		MantleDB->PublishSnapshots();
+		TSharedPtr<const FMantleComponentSnapshot, ESPMode::ThreadSafe> SecondSnapshot = MantleDB->GetSnapshot<FFakeItemComponent>();
+		ANANKE_TEST_EQUAL(TestFramework, SecondSnapshot->GetPublishNumber(), static_cast<uint64>(2));
+		ANANKE_TEST_EQUAL(TestFramework, SecondSnapshot->NumCopiedChunks(), 1);
+
+		TMap<FGuid, const FFakeItemComponent*> FirstColumns;
+		FMantleIterator FirstIterator(FirstSnapshot);
+		while (FirstIterator.Next())
+		{
+			FirstColumns.Add(FirstIterator.GetChunkId(), FirstIterator.GetArrayView<FFakeItemComponent>().GetData());
+		}
+
+		int32 NumShared = 0;
+		FMantleIterator SecondIterator(SecondSnapshot);
+		while (SecondIterator.Next())
+		{
+			NumShared += FirstColumns.FindRef(SecondIterator.GetChunkId()) == SecondIterator.GetArrayView<FFakeItemComponent>().GetData();
+		}
+		ANANKE_TEST_EQUAL(TestFramework, NumShared, 1);
+
+		// Chunks are never compared, so only writes count as changes. Const access doesn't, and non-const access does even
+		// if nothing is actually modified.
+		ANANKE_TEST_NOT_NULL(TestFramework, MantleDB->GetComponent<const FFakeItemComponent>(ItemEntity));
+		FMantleComponentQuery ItemQuery;
+		ItemQuery.AddRequiredComponent<FFakeItemComponent>();
+		FMantleIterator ReadIterator = MantleDB->RunQuery(ItemQuery);
+		while (ReadIterator.Next())
+		{
+			ANANKE_TEST_FALSE(TestFramework, ReadIterator.GetArrayView<const FFakeItemComponent>().IsEmpty());
+		}
+		TMantleQuery<const FFakeItemComponent&> ReadQuery;
+		ReadQuery.ForEach(*MantleDB, [](const FFakeItemComponent& Item) {});
+		MantleDB->PublishSnapshots();
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetSnapshot<FFakeItemComponent>()->NumCopiedChunks(), 0);
+
+		TMantleQuery<FFakeItemComponent&> WriteQuery;
+		WriteQuery.ForEach(*MantleDB, [](FFakeItemComponent& Item) {});
+		MantleDB->PublishSnapshots();
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetSnapshot<FFakeItemComponent>()->NumCopiedChunks(), 2);
+
+		// Snapshots don't change once published, even after the DB does.
+		MantleDB->RemoveEntity(ItemEntity);
+		MantleDB->PublishSnapshots();
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetSnapshot<FFakeItemComponent>()->NumEntities(), 10);
+		ANANKE_TEST_TRUE(TestFramework, SecondIterator.IsValid());
+		ANANKE_TEST_EQUAL(TestFramework, SecondSnapshot->NumEntities(), 11);
+
+		// Any number of threads can read a snapshot at once.
+		std::atomic<int32> NumUpdated = 0;
+		ParallelFor(8, [&SecondSnapshot, &NumUpdated](int32 Index)
+		{
+			FMantleIterator Iterator(SecondSnapshot);
+			while (Iterator.Next())
+			{
+				for (const FFakeItemComponent& Item : Iterator.GetArrayView<FFakeItemComponent>())
+				{
+					NumUpdated += Item.Name == TEXT("UpdatedName");
+				}
+			}
+		});
+		ANANKE_TEST_EQUAL(TestFramework, NumUpdated.load(), 8);
+	}
+
+	void Test_AsyncCommandBuffer()
+	{
+		InitDB();
+
+		TArray<FInstancedStruct> Components;
+		Components.Add(FInstancedStruct::Make(FFakeItemComponent(TEXT("ItemName"), 1.0f, 1.0f)));
+		FGuid Unchanged = MantleDB->AddEntity(Components);
+		FGuid Moved = MantleDB->AddEntity(Components);
+		FGuid Removed = MantleDB->AddEntity(Components);
+		FGuid Untracked = MantleDB->AddEntity(Components);
+
+		FMantleAsyncCommandBuffer Results;
+		Results.TrackEntities(*MantleDB, {Unchanged, Moved, Removed});
+
+		auto SetName = [](FFakeItemComponent& Item)
+		{
+			Item.Name = TEXT("UpdatedName");
+		};
+		Results.UpdateComponent<FFakeItemComponent>(Unchanged, SetName);
+		Results.UpdateComponent<FFakeItemComponent>(Moved, SetName);
+		Results.UpdateComponent<FFakeItemComponent>(Removed, SetName);
+		Results.UpdateComponent<FFakeItemComponent>(Untracked, SetName);
+		Results.WriteEvent(FFakeItemComponent(TEXT("Event"), 1.0f, 1.0f));
+
+		// While the task was running, one entity gained a component and another was removed.
+		uint32 GenerationBeforeMove = MantleDB->FindEntity(Moved)->Generation;
+		TArray<FInstancedStruct> ToAdd;
+		ToAdd.Add(FInstancedStruct::Make(FFakeTransformComponent()));
+		MantleDB->UpdateEntity(Moved, ToAdd);
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->FindEntity(Moved)->Generation, GenerationBeforeMove + 1);
+		MantleDB->RemoveEntity(Removed);
+
+		// Results for the stale entities are dropped, the rest are applied.
+		ANANKE_TEST_EQUAL(TestFramework, Results.Apply(*MantleDB), 2);
+		TestFramework->TestEqual(TEXT("Unchanged.Name"), MantleDB->GetComponent<FFakeItemComponent>(Unchanged)->Name, TEXT("UpdatedName"));
+		TestFramework->TestEqual(TEXT("Moved.Name"), MantleDB->GetComponent<FFakeItemComponent>(Moved)->Name, TEXT("ItemName"));
+		TestFramework->TestEqual(TEXT("Untracked.Name"), MantleDB->GetComponent<FFakeItemComponent>(Untracked)->Name, TEXT("UpdatedName"));
+
+		MantleDB->SwapEventChannels();
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetEventChannel<FFakeItemComponent>().ReadAll().Num(), 1);
+	}
+
+	void Test_AsyncOperation()
+	{
+		InitDB();
+
+		TArray<FInstancedStruct> Components;
+		Components.Add(FInstancedStruct::Make(FFakeItemComponent(TEXT("ItemName"), 1.0f, 1.0f)));
+		const FGuid Item = MantleDB->AddEntity(Components);
+		auto GetItemName = [this, Item]()
+		{
+			return MantleDB->GetComponent<const FFakeItemComponent>(Item)->Name;
+		};
+
+		TStrongObjectPtr<UFakeAsyncOperation> Operation(NewObject<UFakeAsyncOperation>());
+		Operation->TargetEntity = Item;
+		Operation->SetMaxResultAgeFrames(2);
+
+		FMantleEngineLoop EngineLoop;
+		EngineLoop.Options.OperationGroups.AddDefaulted_GetRef().Operations = {Operation.Get()};
+		EngineLoop.OperationContext.MantleDB = MantleDB.Get();
+		EngineLoop.OperationContext.World = TestWorld.Get();
+		EngineLoop.BuildSchedule();
+		auto Tick = [&EngineLoop]()
+		{
+			EngineLoop.ExecuteTick(0.0f, LEVELTICK_All, ENamedThreads::GameThread, FGraphEventRef());
+		};
+
+		// The first tick launches a task, and later ticks skip launching while it is still running.
+		UFakeAsyncOperation::bHoldTasks = true;
+		Tick();
+		ANANKE_TEST_EQUAL(TestFramework, Operation->NumLaunches, 1);
+		ANANKE_TEST_TRUE(TestFramework, Operation->IsTaskInFlight());
+		Tick();
+		ANANKE_TEST_EQUAL(TestFramework, Operation->NumLaunches, 1);
+
+		// Once the task has finished, its results are still pending until a later tick applies them.
+		UFakeAsyncOperation::bHoldTasks = false;
+		Operation->WaitForTask();
+		ANANKE_TEST_TRUE(TestFramework, Operation->IsTaskInFlight());
+		TestFramework->TestEqual(TEXT("Name before apply"), GetItemName(), TEXT("ItemName"));
+
+		// The results are applied at the start of the next tick, which then launches the next task.
+		UFakeAsyncOperation::bHoldTasks = true;
+		Tick();
+		TestFramework->TestEqual(TEXT("Name after apply"), GetItemName(), TEXT("Launch1"));
+		ANANKE_TEST_EQUAL(TestFramework, Operation->NumLaunches, 2);
+
+		// Results that arrive more than MaxResultAgeFrames after their launch are dropped, and a new task is launched.
+		UFakeAsyncOperation::bHoldTasks = false;
+		Operation->WaitForTask();
+		GFrameCounter += 3;
+		Tick();
+		TestFramework->TestEqual(TEXT("Name after drop"), GetItemName(), TEXT("Launch1"));
+		ANANKE_TEST_EQUAL(TestFramework, Operation->NumLaunches, 3);
+
+		Operation->WaitForTask();
+		Tick();
+		TestFramework->TestEqual(TEXT("Name after next apply"), GetItemName(), TEXT("Launch3"));
+	}
+
+	void Test_HealthAccumulation()
+	{
+		TArray<UScriptStruct*> ComponentTypes;
+		ComponentTypes.Add(FMC_Health::StaticStruct());
+		MantleDB->Initialize(ComponentTypes);
+
+		TArray<FInstancedStruct> Components;
+		Components.Add(FInstancedStruct::Make(FMC_Health(100.0f, 100.0f)));
+		FGuid Damaged = MantleDB->AddEntity(Components);
+		FGuid Healed = MantleDB->AddEntity(Components);
+		FGuid Untouched = MantleDB->AddEntity(Components);
+		MantleDB->GetComponent<FMC_Health>(Healed)->SetHealth(50.0f);
+
+		auto MakeModification = [](const FGuid& Target, float Amount, EMC_HealthStacking Stacking, FName StackingGroup = NAME_None)
+		{
+			FMC_HealthModification Modification(Target, Amount);
+			Modification.Stacking = Stacking;
+			Modification.StackingGroup = StackingGroup;
+			return Modification;
+		};
+		
+		TMantleEventChannel<FMC_HealthModification>& Modifications = MantleDB->GetEventChannel<FMC_HealthModification>();
+		Modifications.Write(MakeModification(Damaged, -10.0f, EMC_HealthStacking::Additive));
+		Modifications.Write(MakeModification(Damaged, -20.0f, EMC_HealthStacking::Highest, TEXT("Fire")));
+		Modifications.Write(MakeModification(Damaged, -5.0f, EMC_HealthStacking::Additive));
+		Modifications.Write(MakeModification(Damaged, -7.0f, EMC_HealthStacking::Highest, TEXT("Ice")));
+		Modifications.Write(MakeModification(Damaged, -30.0f, EMC_HealthStacking::Highest, TEXT("Fire")));
+		Modifications.Write(MakeModification(Damaged, 3.0f, EMC_HealthStacking::Additive));
+		Modifications.Write(MakeModification(Healed, 5.0f, EMC_HealthStacking::Highest, TEXT("Regen")));
+		Modifications.Write(MakeModification(Healed, 15.0f, EMC_HealthStacking::Highest, TEXT("Regen")));
+		Modifications.Write(MakeModification(Healed, 4.0f, EMC_HealthStacking::Highest, TEXT("Potion")));
+		MantleDB->SwapEventChannels();
+
+		FMantleOperationContext Ctx;
+		Ctx.MantleDB = MantleDB.Get();
+		Ctx.World = TestWorld.Get();
+		UMO_HealthAccumulation* Accumulation = NewObject<UMO_HealthAccumulation>();
+		Accumulation->Run(Ctx);
+
+		// Additive modifications are summed, and only the strongest modification in each StackingGroup is applied.
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetComponent<FMC_Health>(Damaged)->GetHealth(), 100.0f - 10.0f - 5.0f + 3.0f - 30.0f - 7.0f);
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetComponent<FMC_Health>(Healed)->GetHealth(), 50.0f + 15.0f + 4.0f);
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetComponent<FMC_Health>(Untouched)->GetHealth(), 100.0f);
+
+		// One change per target, no matter how many modifications it received.
+		MantleDB->SwapEventChannels();
+		TConstArrayView<FMC_HealthChangeEvent> HealthChanges = MantleDB->GetEventChannel<FMC_HealthChangeEvent>().ReadAll();
+		ANANKE_TEST_EQUAL(TestFramework, HealthChanges.Num(), 2);
+
+		// Modifications are only applied once.
+		Accumulation->Run(Ctx);
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetComponent<FMC_Health>(Healed)->GetHealth(), 69.0f);
+	}
+
+	void Test_ParallelEffectBatches()
+	{
+		TArray<UScriptStruct*> ComponentTypes;
+		ComponentTypes.Add(FMC_Health::StaticStruct());
+		ComponentTypes.Add(FEP_EffectMetadata::StaticStruct());
+		ComponentTypes.Add(FEP_SimpleDamageEffect::StaticStruct());
+
+		// Small chunks, so the targets are spread over many batches.
+		MantleDB->Initialize(ComponentTypes, 2 * 1024);
+
+		constexpr int32 NumTargets = 512;
+		TArray<FGuid> Targets;
+		TArray<FInstancedStruct> TargetComponents;
+		TargetComponents.Add(FInstancedStruct::Make(FMC_Health(1000.0f, 1000.0f)));
+		for (int32 TargetIndex = 0; TargetIndex < NumTargets; ++TargetIndex)
+		{
+			Targets.Add(MantleDB->AddEntity(TargetComponents));
+		}
+
+		// Effects are added in a different order than their targets, so sorting them into batches matters.
+		for (int32 EffectIndex = 0; EffectIndex < NumTargets; ++EffectIndex)
+		{
+			FEP_SimpleDamageEffect Damage;
+			Damage.TargetEntity = Targets[(EffectIndex * 7) % NumTargets];
+			Damage.DamageAmount = 1.0f + EffectIndex % 5;
+
+			TArray<FInstancedStruct> EffectComponents;
+			EffectComponents.Add(FInstancedStruct::Make(FEP_EffectMetadata::MakeRecurringEffect(0.0)));
+			EffectComponents.Add(FInstancedStruct::Make(Damage));
+			MantleDB->AddEntity(EffectComponents);
+		}
+
+		FMantleOperationContext Ctx;
+		Ctx.MantleDB = MantleDB.Get();
+		Ctx.World = TestWorld.Get();
+		UEE_SimpleDamageEffect* Executor = NewObject<UEE_SimpleDamageEffect>();
+
+		auto RunExecutor = [&](int32 MaxShards)
+		{
+			Executor->MaxShardsOverride = MaxShards;
+			Executor->Run(Ctx);
+			MantleDB->SwapEventChannels();
+			return TArray<FMC_HealthChangeEvent>(MantleDB->GetEventChannel<FMC_HealthChangeEvent>().ReadAll());
+		};
+
+		// Every effect is due on every run, so both runs damage the same targets by the same amounts.
+		TArray<FMC_HealthChangeEvent> SerialChanges = RunExecutor(1);
+		TArray<FMC_HealthChangeEvent> ShardedChanges = RunExecutor(4);
+		ANANKE_TEST_EQUAL(TestFramework, SerialChanges.Num(), NumTargets);
+		ANANKE_TEST_EQUAL(TestFramework, ShardedChanges.Num(), NumTargets);
+
+		// The shards' output is published in batch order, so the event stream matches the serial run.
+		for (int32 ChangeIndex = 0; ChangeIndex < FMath::Min(SerialChanges.Num(), ShardedChanges.Num()); ++ChangeIndex)
+		{
+			const FMC_HealthChangeEvent& Serial = SerialChanges[ChangeIndex];
+			const FMC_HealthChangeEvent& Sharded = ShardedChanges[ChangeIndex];
+			ANANKE_TEST_TRUE(TestFramework, Serial.Entity == Sharded.Entity);
+			ANANKE_TEST_EQUAL(TestFramework, Serial.OldValue - Serial.NewValue, Sharded.OldValue - Sharded.NewValue);
+		}
+	}
+
+	void Test_EffectSchedule()
+	{
+		TArray<UScriptStruct*> ComponentTypes;
+		ComponentTypes.Add(FMC_Health::StaticStruct());
+		ComponentTypes.Add(FEP_EffectMetadata::StaticStruct());
+		ComponentTypes.Add(FEP_SimpleDamageEffect::StaticStruct());
+		MantleDB->Initialize(ComponentTypes);
+
+		TArray<FInstancedStruct> TargetComponents;
+		TargetComponents.Add(FInstancedStruct::Make(FMC_Health(100.0f, 100.0f)));
+		const FGuid Target = MantleDB->AddEntity(TargetComponents);
+
+		// Each effect triggers as soon as it is discovered, and then not again for the rest of the test.
+		auto AddDamageEffect = [&](float DamageAmount)
+		{
+			constexpr double TriggerRateSec = 1000.0;
+			FEP_EffectMetadata Metadata = FEP_EffectMetadata::MakeRecurringEffect(TriggerRateSec);
+			Metadata.LastTimeTriggered = FPlatformTime::Seconds() - TriggerRateSec;
+			
+			FEP_SimpleDamageEffect Damage;
+			Damage.TargetEntity = Target;
+			Damage.DamageAmount = DamageAmount;
+
+			TArray<FInstancedStruct> EffectComponents;
+			EffectComponents.Add(FInstancedStruct::Make(Metadata));
+			EffectComponents.Add(FInstancedStruct::Make(Damage));
+			return MantleDB->AddEntity(EffectComponents);
+		};
+
+		FMantleOperationContext Ctx;
+		Ctx.MantleDB = MantleDB.Get();
+		Ctx.World = TestWorld.Get();
+		UEE_SimpleDamageEffect* Executor = NewObject<UEE_SimpleDamageEffect>();
+
+		const FGuid First = AddDamageEffect(10.0f);
+		Executor->Run(Ctx);
+		Executor->Run(Ctx);
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetComponent<FMC_Health>(Target)->GetHealth(), 90.0f);
+
+		// Effects that were already scheduled aren't scheduled again when a new effect shows up.
+		AddDamageEffect(5.0f);
+		Executor->Run(Ctx);
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetComponent<FMC_Health>(Target)->GetHealth(), 85.0f);
+		ANANKE_TEST_EQUAL(TestFramework, Executor->EffectSchedule.Num(), 2);
+
+		// Canceling doesn't wait for the effect to come due.
+		ANANKE_TEST_TRUE(TestFramework, FEP_EffectMetadata::RequestCancel(*MantleDB, First));
+		MantleDB->SwapEventChannels();
+		Executor->Run(Ctx);
+		ANANKE_TEST_TRUE(TestFramework, MantleDB->FindEntity(First) == nullptr);
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetComponent<FMC_Health>(Target)->GetHealth(), 85.0f);
+
+		// A new executor schedules every existing effect, even ones another executor already scheduled.
+		UEE_SimpleDamageEffect* NewExecutor = NewObject<UEE_SimpleDamageEffect>();
+		NewExecutor->Run(Ctx);
+		ANANKE_TEST_EQUAL(TestFramework, NewExecutor->EffectSchedule.Num(), 1);
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetComponent<FMC_Health>(Target)->GetHealth(), 85.0f);
+	}
+
+	void Test_EffectBatchExecution()
+	{
+		TArray<UScriptStruct*> ComponentTypes;
+		ComponentTypes.Add(FMC_Health::StaticStruct());
+		ComponentTypes.Add(FEP_EffectMetadata::StaticStruct());
+		ComponentTypes.Add(FEP_SimpleDamageEffect::StaticStruct());
+		ComponentTypes.Add(FEP_SimpleHealEffect::StaticStruct());
+		MantleDB->Initialize(ComponentTypes);
+
+		TArray<FInstancedStruct> TargetComponents;
+		TargetComponents.Add(FInstancedStruct::Make(FMC_Health(100.0f, 100.0f)));
+		const FGuid Damaged = MantleDB->AddEntity(TargetComponents);
+		const FGuid Healed = MantleDB->AddEntity(TargetComponents);
+		const FGuid FullHealth = MantleDB->AddEntity(TargetComponents);
+		MantleDB->GetComponent<FMC_Health>(Healed)->SetHealth(50.0f);
+
+		// One-time effects that are due right away.
+		auto AddEffect = [&](const FInstancedStruct& Payload)
+		{
+			FEP_EffectMetadata Metadata = FEP_EffectMetadata::MakeOneTimeEffect();
+			Metadata.LastTimeTriggered = FPlatformTime::Seconds() - Metadata.TriggerRateSec;
+
+			TArray<FInstancedStruct> EffectComponents;
+			EffectComponents.Add(FInstancedStruct::Make(Metadata));
+			EffectComponents.Add(Payload);
+			return MantleDB->AddEntity(EffectComponents);
+		};
+		auto MakeDamage = [](const FGuid& Target, float Amount)
+		{
+			FEP_SimpleDamageEffect Damage;
+			Damage.TargetEntity = Target;
+			Damage.DamageAmount = Amount;
+			return FInstancedStruct::Make(Damage);
+		};
+		auto MakeHeal = [](const FGuid& Target, float Amount)
+		{
+			FEP_SimpleHealEffect Heal;
+			Heal.TargetEntity = Target;
+			Heal.HealAmount = Amount;
+			return FInstancedStruct::Make(Heal);
+		};
+
+		TArray<FGuid> Effects;
+		Effects.Add(AddEffect(MakeDamage(Damaged, 30.0f)));
+		Effects.Add(AddEffect(MakeDamage(Damaged, 10.0f)));
+		Effects.Add(AddEffect(MakeDamage(FGuid::NewGuid(), 10.0f)));
+		Effects.Add(AddEffect(MakeHeal(Healed, 20.0f)));
+		Effects.Add(AddEffect(MakeHeal(FullHealth, 20.0f)));
+
+		FMantleOperationContext Ctx;
+		Ctx.MantleDB = MantleDB.Get();
+		Ctx.World = TestWorld.Get();
+		NewObject<UEE_SimpleDamageEffect>()->Run(Ctx);
+		NewObject<UEE_SimpleHealEffect>()->Run(Ctx);
+
+		// Both damage effects on the same target are applied in one batch.
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetComponent<FMC_Health>(Damaged)->GetHealth(), 60.0f);
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetComponent<FMC_Health>(Healed)->GetHealth(), 70.0f);
+		ANANKE_TEST_EQUAL(TestFramework, MantleDB->GetComponent<FMC_Health>(FullHealth)->GetHealth(), 100.0f);
+
+		// Only the effects that changed health write events.
+		MantleDB->SwapEventChannels();
+		TConstArrayView<FMC_HealthChangeEvent> HealthChanges = MantleDB->GetEventChannel<FMC_HealthChangeEvent>().ReadAll();
+		ANANKE_TEST_EQUAL(TestFramework, HealthChanges.Num(), 3);
+
+		// One-time effects finish, effects with a missing target are canceled, and healing a target at full health
+		// fails (which cancels effects that don't allow any failures). Either way, they are all removed.
+		for (const FGuid& Effect : Effects)
+		{
+			ANANKE_TEST_TRUE(TestFramework, MantleDB->FindEntity(Effect) == nullptr);
+		}
+	}
+
+	void Test_EffectsOnOneTargetKeepTheirOrder()
+	{
+		TArray<UScriptStruct*> ComponentTypes;
+		ComponentTypes.Add(FMC_Health::StaticStruct());
+		ComponentTypes.Add(FEP_EffectMetadata::StaticStruct());
+		ComponentTypes.Add(FEP_SimpleDamageEffect::StaticStruct());
+		MantleDB->Initialize(ComponentTypes);
+
+		TArray<FInstancedStruct> TargetComponents;
+		TargetComponents.Add(FInstancedStruct::Make(FMC_Health(10000.0f, 10000.0f)));
+		const FGuid Target = MantleDB->AddEntity(TargetComponents);
+
+		// Enough effects on one target that sorting them into batches doesn't fall back to an insertion sort.
+		constexpr int32 NumEffects = 64;
+		for (int32 EffectIndex = 0; EffectIndex < NumEffects; ++EffectIndex)
+		{
+			FEP_EffectMetadata Metadata = FEP_EffectMetadata::MakeOneTimeEffect();
+			Metadata.LastTimeTriggered = FPlatformTime::Seconds() - Metadata.TriggerRateSec;
+			
+			FEP_SimpleDamageEffect Damage;
+			Damage.TargetEntity = Target;
+			Damage.DamageAmount = 1.0f + EffectIndex;
+
+			TArray<FInstancedStruct> EffectComponents;
+			EffectComponents.Add(FInstancedStruct::Make(Metadata));
+			EffectComponents.Add(FInstancedStruct::Make(Damage));
+			MantleDB->AddEntity(EffectComponents);
+		}
+
+		FMantleOperationContext Ctx;
+		Ctx.MantleDB = MantleDB.Get();
+		Ctx.World = TestWorld.Get();
+		NewObject<UEE_SimpleDamageEffect>()->Run(Ctx);
+
+		// The effects all live in one chunk, so they are collected (and must be applied) in the order they were added.
+		MantleDB->SwapEventChannels();
+		TConstArrayView<FMC_HealthChangeEvent> HealthChanges = MantleDB->GetEventChannel<FMC_HealthChangeEvent>().ReadAll();
+		ANANKE_TEST_EQUAL(TestFramework, HealthChanges.Num(), NumEffects);
+		for (int32 ChangeIndex = 0; ChangeIndex < HealthChanges.Num(); ++ChangeIndex)
+		{
+			const FMC_HealthChangeEvent& HealthChange = HealthChanges[ChangeIndex];
+			ANANKE_TEST_EQUAL(TestFramework, HealthChange.OldValue - HealthChange.NewValue, 1.0f + ChangeIndex);
+		}
+	}
+
+	void Test_FrameArena()
+	{
+		FMantleFrameArena Arena;
+		
+		{
+			FMantleFrameArenaScope ArenaScope(&Arena);
+			ANANKE_TEST_TRUE(TestFramework, FMantleFrameArena::GetActive() == &Arena);
+
+			TArray<int32, FMantleScratchAllocator> ScratchArray;
+			for (int32 Value = 0; Value < 100; ++Value)
+			{
+				ScratchArray.Add(Value);
+			}
+			ANANKE_TEST_EQUAL(TestFramework, ScratchArray[99], 99);
+			ANANKE_TEST_TRUE(TestFramework, Arena.GetBytesUsed() >= 100 * sizeof(int32));
+
+			// Allocations that don't fit in the first block spill over into a new one.
+			uint8* LargeAllocation = static_cast<uint8*>(Arena.Allocate(256 * 1024, 16));
+			ANANKE_TEST_TRUE(TestFramework, LargeAllocation != nullptr);
+			ANANKE_TEST_TRUE(TestFramework, IsAligned(LargeAllocation, 16));
+		}
+		ANANKE_TEST_TRUE(TestFramework, FMantleFrameArena::GetActive() == nullptr);
+
+		Arena.Reset();
+		ANANKE_TEST_TRUE(TestFramework, Arena.GetBytesUsed() == 0);
+
+		// Without an active arena, scratch arrays fall back to the heap.
+		TArray<int32, FMantleScratchAllocator> HeapArray;
+		HeapArray.Add(1);
+		HeapArray.Add(2);
+		ANANKE_TEST_EQUAL(TestFramework, HeapArray.Num(), 2);
+		ANANKE_TEST_TRUE(TestFramework, Arena.GetBytesUsed() == 0);
+	}
+
 	void Test_UpdateEntities()
 	{
 		AAnankeTestActor* TargetActor_Archetype2 = TestWorld->SpawnActor<AAnankeTestActor>();
@@ -1048,10 +2255,11 @@ public:
 			FMantleIterator Archetype3ResultBefore = MantleDB->RunQuery(Archetype3Query);
 			TArray<int32> ExpectedArchetype3CountsBeforeUpdate;
 			ExpectedArchetype3CountsBeforeUpdate.Append({
-				8, // chunk 0
-				8, // chunk 1
-				8, // chunk 2
-				6  // chunk 3
+				6, // chunk 0
+				6, // chunk 1
+				6, // chunk 2
+				6, // chunk 3
+				6  // chunk 4
 			});
 
 			if(!ANANKE_TEST_EQUAL(TestFramework, Archetype3ResultBefore.LocalCache.MatchingEntries.Num(), 1))
@@ -1100,8 +2308,8 @@ public:
 			ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedComponents.Num(), 2);
 			ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedEntityIds.Num(), 3);
 			ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedEntityIds[0].Num(), 4); // 15 total entities
-			ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedEntityIds[1].Num(), 8);
-			ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedEntityIds[2].Num(), 3);
+			ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedEntityIds[1].Num(), 6);
+			ANANKE_TEST_EQUAL(TestFramework, CachedEntry.ChunkedEntityIds[2].Num(), 5);
 
 			int32 ChunksChecked = 0;
 			int32 EntitiesChecked = 0;
@@ -1203,7 +2411,7 @@ public:
 				ChunksChecked++;
 			}
 			
-			ANANKE_TEST_EQUAL(TestFramework, ChunksChecked, 5);
+			ANANKE_TEST_EQUAL(TestFramework, ChunksChecked, 6);
 			ANANKE_TEST_EQUAL(TestFramework, EntitiesChecked, 35);
 		}
 
@@ -1219,10 +2427,11 @@ public:
 			// The old archetype should have half of its entities removed.
 			TArray<int32> ExpectedArchetype3CountsAfterUpdate;
 			ExpectedArchetype3CountsAfterUpdate.Append({
-				4, // chunk 0
-				4, // chunk 1
-				4, // chunk 2
-				3  // chunk 3
+				3, // chunk 0
+				3, // chunk 1
+				3, // chunk 2
+				3, // chunk 3
+				3  // chunk 4
 			});
 
 			for (int32 ChunkIndex = 0; ChunkIndex < ExpectedArchetype3CountsAfterUpdate.Num(); ++ChunkIndex)
@@ -1326,7 +2535,7 @@ public:
 		{
 			return;
 		}
-		ANANKE_TEST_EQUAL(TestFramework, Entry->Chunks.Find(Entry->AllChunkIds[0])->EntityIds.Num(), NumberToStrip);
+		ANANKE_TEST_EQUAL(TestFramework, Entry->Chunks.Find(Entry->AllChunkIds[0])->GetNumEntities(), NumberToStrip);
 
 		FMantleComponentQuery TransformQuery;
 		TransformQuery.AddRequiredComponent<FFakeTransformComponent>();
@@ -1409,7 +2618,7 @@ public:
 		{
 			return;
 		}
-		ANANKE_TEST_EQUAL(TestFramework, Entry->Chunks.Find(Entry->AllChunkIds[0])->EntityIds.Num(), NumberToStrip);
+		ANANKE_TEST_EQUAL(TestFramework, Entry->Chunks.Find(Entry->AllChunkIds[0])->GetNumEntities(), NumberToStrip);
 
 		FMantleComponentQuery TransformQuery;
 		TransformQuery.AddRequiredComponent<FFakeTransformComponent>();
@@ -1467,10 +2676,32 @@ public:
 		REGISTER_TEST_SUITE_FN(Test_SingleArchetypeQuery);
 		REGISTER_TEST_SUITE_FN(Test_SingleArchetypeQueryNoResults);
 		REGISTER_TEST_SUITE_FN(Test_MultiArchetypeQuery);
+		REGISTER_TEST_SUITE_FN(Test_TypedQuery);
 		REGISTER_TEST_SUITE_FN(Test_EmptyComponentQuery);
 		REGISTER_TEST_SUITE_FN(Test_GetComponent);
+		REGISTER_TEST_SUITE_FN(Test_GetComponents);
 		REGISTER_TEST_SUITE_FN(Test_RemoveEntities);
+		REGISTER_TEST_SUITE_FN(Test_RemoveEntitiesWhere);
+		REGISTER_TEST_SUITE_FN(Test_RemovedComponentsAreDestroyed);
+		REGISTER_TEST_SUITE_FN(Test_GetOptionalArrayView);
 		REGISTER_TEST_SUITE_FN(Test_DBModificationInvalidatesIterator);
+		REGISTER_TEST_SUITE_FN(Test_QueryVersionAndChunkIds);
+		REGISTER_TEST_SUITE_FN(Test_EventChannel);
+		REGISTER_TEST_SUITE_FN(Test_ComponentObservers);
+		REGISTER_TEST_SUITE_FN(Test_SideTable);
+		REGISTER_TEST_SUITE_FN(Test_CommandQueue);
+		REGISTER_TEST_SUITE_FN(Test_ExecuteOrQueue);
+		REGISTER_TEST_SUITE_FN(Test_ComponentAccessConflicts);
+		REGISTER_TEST_SUITE_FN(Test_ConcurrentOperations);
+		REGISTER_TEST_SUITE_FN(Test_PublishedSnapshots);
+		REGISTER_TEST_SUITE_FN(Test_AsyncCommandBuffer);
+		REGISTER_TEST_SUITE_FN(Test_AsyncOperation);
+		REGISTER_TEST_SUITE_FN(Test_HealthAccumulation);
+		REGISTER_TEST_SUITE_FN(Test_ParallelEffectBatches);
+		REGISTER_TEST_SUITE_FN(Test_EffectSchedule);
+		REGISTER_TEST_SUITE_FN(Test_EffectBatchExecution);
+		REGISTER_TEST_SUITE_FN(Test_EffectsOnOneTargetKeepTheirOrder);
+		REGISTER_TEST_SUITE_FN(Test_FrameArena);
 		REGISTER_TEST_SUITE_FN(Test_UpdateEntities);
 		REGISTER_TEST_SUITE_FN(Test_StripComponents);
 		REGISTER_TEST_SUITE_FN(Test_StripComponentsAndEmptyEntry);
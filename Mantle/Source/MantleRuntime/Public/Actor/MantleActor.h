@@ -61,6 +61,7 @@ public:
 	
 protected:
 	void RegisterWithMantle();
+	void AddMantleEntity(UMantleDB& QueuedDB);
 	virtual void InitializeMantleComponents(TArray<FInstancedStruct>& ComponentList);
 	virtual void InitializeActorComponents(FGuid& EntityId);
 
@@ -60,8 +60,6 @@ class MANTLERUNTIME_API AMantleImpactProjectile : public AMantleActor
 public:
 	AMantleImpactProjectile(const FObjectInitializer& Initializer);
 
-	virtual void PostInitializeComponents() override;
-
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	UProjectileMovementComponent* ProjectileMovementComponent;
 
@@ -81,6 +79,7 @@ public:
 
 protected:
 	virtual void InitializeMantleComponents(TArray<FInstancedStruct>& ComponentList) override;
+	virtual void InitializeActorComponents(FGuid& EntityId) override;
 
 	// UFUNCTION required for delegate binding.
 	UFUNCTION()
@@ -0,0 +1,89 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Components/ActorComponent.h"
+#include "Foundation/MantleDB.h"
+#include "MantleComponents/MC_Viewpoint.h"
+#include "Misc/Guid.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+
+#include "MantleViewpointPublisherComponent.generated.h"
+
+class UMO_ViewpointCollector;
+
+/**
+ *  Publishes the viewpoint of its owner (a controller or a player camera manager) to the viewpoint collector whenever
+ *  it changes. The target entity's FMC_Viewpoint is switched to Push mode, so the collector stops polling it, and back to
+ *  Poll mode when the entity is cleared or the publisher ends play.
+ */
+UCLASS()
+class MANTLERUNTIME_API UMantleViewpointPublisherComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UMantleViewpointPublisherComponent(const FObjectInitializer& Initializer);
+
+	void SetViewpointEntity(FGuid NewEntityId);
+	void ClearViewpointEntity();
+	FGuid GetViewpointEntity() { return EntityId; }
+
+	virtual void TickComponent(
+		float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Changes smaller than these are not published.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float LocationTolerance = 0.1f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float RotationToleranceDeg = 0.01f;
+	
+protected:
+	virtual void BeginPlay() override;
+
+	// Hands the viewpoint back to the collector. Otherwise it would stay in Push mode, holding the last published value.
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	
+	bool GetOwnerViewPoint(FVector& OutLocation, FRotator& OutRotation) const;
+	void SetViewpointUpdateMode(EMantleViewpointUpdateMode NewMode);
+	
+	FGuid EntityId;
+	FVector LastPublishedLocation = FVector::ZeroVector;
+	FRotator LastPublishedRotation = FRotator::ZeroRotator;
+	bool bHasPublished = false;
+
+	UPROPERTY()
+	TWeakObjectPtr<UMantleDB> MantleDB = nullptr;
+
+	UPROPERTY()
+	TWeakObjectPtr<UMO_ViewpointCollector> ViewpointCollector = nullptr;
+};
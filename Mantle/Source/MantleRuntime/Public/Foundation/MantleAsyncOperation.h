@@ -0,0 +1,180 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Containers/Array.h"
+#include "Containers/ArrayView.h"
+#include "Containers/Map.h"
+#include "MantleCommandQueue.h"
+#include "MantleDB.h"
+#include "MantleOperation.h"
+#include "Misc/Guid.h"
+#include "Tasks/Task.h"
+#include "Templates/Function.h"
+#include "Templates/SharedPointer.h"
+
+#include <atomic>
+
+#include "MantleAsyncOperation.generated.h"
+
+/**
+ *  The results of a UMantleAsyncOperation's task. The task records changes here instead of making them, and they are
+ *  applied to the DB at the start of a later engine tick (via the DB's command queue), while no operations are running.
+ *
+ *  Entities that were tracked when the task was launched are checked before their commands run: if the entity has been
+ *  removed or has changed archetype since (see FMantleEntity::Generation), the task was working from stale data and
+ *  its commands for that entity are dropped.
+ */
+class MANTLERUNTIME_API FMantleAsyncCommandBuffer
+{
+public:
+	// Remembers the entity's current generation. Must be called on the engine's thread, before the task is launched.
+	void TrackEntity(const UMantleDB& MantleDB, const FGuid& EntityId);
+	void TrackEntities(const UMantleDB& MantleDB, TConstArrayView<FGuid> EntityIds);
+
+	// Runs unconditionally.
+	void Add(FMantleCommand&& Command)
+	{
+		Commands.Add({FGuid(), MoveTemp(Command)});
+	}
+
+	// Runs only if the entity is still current. 
+	void AddForEntity(const FGuid& EntityId, FMantleCommand&& Command)
+	{
+		Commands.Add({EntityId, MoveTemp(Command)});
+	}
+
+	// Skipped if the entity is stale, or no longer has the component.
+	template<typename ComponentType>
+	void UpdateComponent(const FGuid& EntityId, TUniqueFunction<void(ComponentType&)> Update)
+	{
+		AddForEntity(EntityId, [EntityId, Update = MoveTemp(Update)](UMantleDB& MantleDB)
+		{
+			if (ComponentType* Component = MantleDB.GetComponent<ComponentType>(EntityId))
+			{
+				Update(*Component);
+			}
+		});
+	}
+
+	template<typename EventType>
+	void WriteEvent(const EventType& Event)
+	{
+		Add([Event](UMantleDB& MantleDB)
+		{
+			MantleDB.GetEventChannel<EventType>().Write(Event);
+		});
+	}
+
+	// Runs the commands in the order they were added, skipping the ones for stale entities. Returns the number of
+	// commands that were skipped.
+	int32 Apply(UMantleDB& MantleDB);
+
+	bool IsEmpty() const
+	{
+		return Commands.IsEmpty();
+	}
+
+	int32 Num() const
+	{
+		return Commands.Num();
+	}
+
+	// The engine frame (GFrameCounter) the task was launched on.
+	uint64 LaunchFrame = 0;
+
+	// Set when the task is launched, and cleared once its results have been applied (or dropped). The operation doesn't
+	// launch another task until then, even if this one has already finished running.
+	std::atomic<bool> bIsPending{false};
+
+private:
+	struct FEntityCommand
+	{
+		// Invalid for commands that aren't tied to an entity.
+		FGuid EntityId;
+		FMantleCommand Command;
+	};
+
+	bool IsStale(const UMantleDB& MantleDB, const FGuid& EntityId) const;
+	
+	TArray<FEntityCommand> Commands;
+	TMap<FGuid, uint32> TrackedGenerations;
+};
+
+// The work done off the engine's thread. It must only touch what was captured when it was launched, and report its
+// results through the command buffer.
+using FMantleAsyncTask = TUniqueFunction<void(FMantleAsyncCommandBuffer& Results)>;
+
+/**
+ *  Base class for operations whose work is too expensive to finish within a single tick (perception scoring, path
+ *  requests, etc).
+ *
+ *  Whenever the previous task's results have been applied, the operation calls LaunchTask() on the engine's thread.
+ *  The subclass captures whatever the task needs there, either by copying it or by holding on to a published snapshot
+ *  (see UMantleDB::EnableSnapshot()), tracks the entities it is going to report on, and returns the task. The task then
+ *  runs on a worker thread, possibly across several frames, and its results are applied at the start of a later engine
+ *  tick. Only one task per operation is in flight at a time, counting from launch until its results are applied.
+ *
+ *  The declared component access only covers what LaunchTask() reads. Commands in the result buffer run while nothing
+ *  else is running, so they may write to anything and make structural changes.
+ */
+UCLASS(Abstract)
+class MANTLERUNTIME_API UMantleAsyncOperation : public UMantleOperation
+{
+	GENERATED_BODY()
+
+public:
+	// True from the moment a task is launched until its results have been applied or dropped.
+	bool IsTaskInFlight() const
+	{
+		return PendingResults.IsValid() && PendingResults->bIsPending.load();
+	}
+
+	// Blocks until the current task has finished running. Its results may still be waiting to be applied.
+	void WaitForTask() const
+	{
+		PendingTask.Wait();
+	}
+
+protected:
+	virtual void PerformOperation(FMantleOperationContext& Ctx) override final;
+
+	// Called on the engine's thread. Return an empty function to skip launching a task this tick.
+	virtual FMantleAsyncTask LaunchTask(FMantleOperationContext& Ctx, FMantleAsyncCommandBuffer& Results);
+
+	// Results that arrive more than this many frames after their task was launched are dropped entirely. 0 means that
+	// results are never too old.
+	int32 MaxResultAgeFrames = 0;
+
+private:
+	UE::Tasks::FTask PendingTask;
+	TSharedPtr<FMantleAsyncCommandBuffer, ESPMode::ThreadSafe> PendingResults;
+};
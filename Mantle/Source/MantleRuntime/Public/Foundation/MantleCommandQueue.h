@@ -0,0 +1,95 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Containers/Array.h"
+#include "Containers/MpscQueue.h"
+#include "Templates/Function.h"
+
+class UMantleDB;
+
+// A deferred change to the DB. Commands run on the thread that drains the queue, while no operations are running.
+using FMantleCommand = TUniqueFunction<void(UMantleDB& MantleDB)>;
+
+/**
+ *  Lock-free, multi-producer single-consumer queue of DB commands.
+ *
+ *  Any thread can push commands without taking a lock. The engine drains the queue in bulk at the start of every tick
+ *  (see UMantleDB::ExecuteQueuedCommands), and the commands run in the order they were pushed. This lets threads that
+ *  are not allowed to touch the DB directly (physics callbacks, async tasks, etc) feed it without marshalling each
+ *  call to the game thread.
+ */
+class MANTLERUNTIME_API FMantleCommandQueue
+{
+public:
+	void Enqueue(FMantleCommand&& Command)
+	{
+		Commands.Enqueue(MoveTemp(Command));
+	}
+
+	// Runs every queued command and returns how many were run. Only one thread may drain the queue at a time. Commands
+	// that are pushed while the queue is being drained may run in the same drain.
+	int32 Drain(UMantleDB& MantleDB);
+
+private:
+	TMpscQueue<FMantleCommand> Commands;
+};
+
+/**
+ *  Single-threaded list of DB commands that are recorded now and run later, in the order they were added.
+ *
+ *  Operations use this (see FMantleOperationContext::Defer) to make structural changes without acting as sync points:
+ *  the engine loop gives each operation its own buffer, and plays the buffers back in schedule order once nothing else
+ *  is running.
+ */
+class MANTLERUNTIME_API FMantleCommandBuffer
+{
+public:
+	void Add(FMantleCommand&& Command)
+	{
+		Commands.Add(MoveTemp(Command));
+	}
+
+	bool IsEmpty() const
+	{
+		return Commands.IsEmpty();
+	}
+
+	// Runs every buffered command and empties the buffer. Returns how many commands were run.
+	int32 Playback(UMantleDB& MantleDB);
+
+	// Moves every buffered command onto the queue (keeping their order), for when the buffer can't be played back on
+	// the current thread.
+	void MoveTo(FMantleCommandQueue& Queue);
+
+private:
+	TArray<FMantleCommand> Commands;
+};
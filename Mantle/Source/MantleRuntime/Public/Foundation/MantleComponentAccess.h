@@ -0,0 +1,154 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Containers/Set.h"
+#include "Containers/UnrealString.h"
+#include "UObject/Class.h"
+
+// When enabled, operations that touch components (or make structural changes) they did not declare in their
+// FMantleComponentAccess will log an error. Disabled in shipping builds by default.
+#ifndef MANTLE_WITH_ACCESS_CHECKS
+#define MANTLE_WITH_ACCESS_CHECKS !UE_BUILD_SHIPPING
+#endif
+
+/**
+ *  Describes which component types an operation reads and writes, and whether it adds, removes or updates entities.
+ *
+ *  The engine loop uses this information to decide which operations are allowed to run concurrently. An operation that
+ *  does not declare any access is assumed to touch everything and will always run by itself on the game thread.
+ */
+struct MANTLERUNTIME_API FMantleComponentAccess
+{
+public:
+	template<typename TComponentType>
+	void AddRead()
+	{
+		AddRead(TComponentType::StaticStruct());
+	}
+
+	template<typename TComponentType>
+	void AddWrite()
+	{
+		AddWrite(TComponentType::StaticStruct());
+	}
+
+	void AddRead(const UScriptStruct* ComponentType);
+	void AddWrite(const UScriptStruct* ComponentType);
+
+	// Adding, removing, or changing the archetype of entities. Operations that do this act as sync points: every
+	// operation scheduled before them finishes first, and nothing else runs while they are running. Prefer deferring
+	// structural changes instead (see FMantleOperationContext::Defer).
+	void AddStructuralChanges()
+	{
+		bIsDeclared = true;
+		bMakesStructuralChanges = true;
+	}
+
+	// For operations that interact with actors, the world, or anything else that is only safe to use on the game thread.
+	void RequireGameThread()
+	{
+		bIsDeclared = true;
+		bRequiresGameThread = true;
+	}
+
+	bool IsDeclared() const { return bIsDeclared; }
+	bool MakesStructuralChanges() const { return bMakesStructuralChanges; }
+	bool RequiresGameThread() const { return bRequiresGameThread; }
+
+	// If true, this operation cannot run concurrently with any other operation.
+	bool IsSyncPoint() const
+	{
+		return !bIsDeclared || bMakesStructuralChanges || bRequiresGameThread;
+	}
+
+	bool CanAccess(const FString& ComponentName) const
+	{
+		return ReadComponents.Contains(ComponentName) || WriteComponents.Contains(ComponentName);
+	}
+
+	bool CanWrite(const FString& ComponentName) const
+	{
+		return WriteComponents.Contains(ComponentName);
+	}
+
+	// Returns true if two operations with these access sets are not allowed to run at the same time.
+	bool ConflictsWith(const FMantleComponentAccess& Other) const;
+
+protected:
+	TSet<FString> ReadComponents;
+	TSet<FString> WriteComponents;
+
+	bool bIsDeclared = false;
+	bool bMakesStructuralChanges = false;
+	bool bRequiresGameThread = false;
+};
+
+/**
+ *  Debug helper that flags undeclared component access. While a checker is in scope, DB accesses made on the same thread
+ *  are validated against its FMantleComponentAccess. Operations that have not declared any access are not checked.
+ */
+class MANTLERUNTIME_API FMantleAccessChecker
+{
+public:
+	FMantleAccessChecker(const FMantleComponentAccess& NewAccess, const UObject* NewOwner);
+	~FMantleAccessChecker();
+
+	FMantleAccessChecker(const FMantleAccessChecker&) = delete;
+	FMantleAccessChecker& operator=(const FMantleAccessChecker&) = delete;
+
+	// bIsWrite is set for mutable access (non-const views, queries, and GetComponent() calls), which must be declared
+	// with AddWrite(). Reads can be declared either way.
+	static void CheckComponentAccess(const FString& ComponentName, bool bIsWrite);
+	static void CheckStructuralChange();
+
+	// The number of violations found so far, including ones that weren't logged because they had already been reported.
+	static int32 GetNumViolations();
+
+	// Forgets which violations were already logged so they get reported again, e.g. between tests.
+	static void ResetReportedViolations();
+
+private:
+	void ReportViolation(const FString& Description) const;
+	
+	const FMantleComponentAccess& Access;
+	const UObject* Owner = nullptr;
+	FMantleAccessChecker* PreviousChecker = nullptr;
+};
+
+#if MANTLE_WITH_ACCESS_CHECKS
+	#define MANTLE_CHECK_COMPONENT_ACCESS(ComponentName, bIsWrite) \
+		FMantleAccessChecker::CheckComponentAccess(ComponentName, bIsWrite)
+	#define MANTLE_CHECK_STRUCTURAL_CHANGE() FMantleAccessChecker::CheckStructuralChange()
+#else
+	#define MANTLE_CHECK_COMPONENT_ACCESS(ComponentName, bIsWrite)
+	#define MANTLE_CHECK_STRUCTURAL_CHANGE()
+#endif
@@ -0,0 +1,79 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Containers/Array.h"
+#include "Containers/ArrayView.h"
+#include "Delegates/Delegate.h"
+#include "Misc/Guid.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+
+class UMantleDB;
+
+enum class EMantleComponentEvent : uint8
+{
+	// The entity gained the component, either when it was created or when it was updated.
+	Add,
+
+	// The entity lost the component, either because it was removed or because the component was stripped.
+	Remove,
+
+	// The entity already had the component, and it was overwritten (see UMantleDB::NotifyComponentsSet()).
+	Set,
+
+	Num
+};
+
+// Called once per frame for each event type, with every entity that the event happened to during that frame.
+DECLARE_MULTICAST_DELEGATE_TwoParams(FMantleComponentObserver, TWeakObjectPtr<UMantleDB>, TConstArrayView<FGuid>);
+
+// The observers for one component type, along with the events that haven't been delivered to them yet.
+struct FMantleComponentObservers
+{
+	static constexpr int32 kNumEvents = static_cast<int32>(EMantleComponentEvent::Num);
+
+	FMantleComponentObserver& Get(EMantleComponentEvent Event)
+	{
+		return Observers[static_cast<int32>(Event)];
+	}
+
+	bool IsObserved(EMantleComponentEvent Event) const
+	{
+		return Observers[static_cast<int32>(Event)].IsBound();
+	}
+	
+	FMantleComponentObserver Observers[kNumEvents];
+	
+	// Written to as events happen, then swapped with DispatchedEntities at the end of the frame. Both keep their
+	// allocations, so steady-state frames don't allocate.
+	TArray<FGuid> PendingEntities[kNumEvents];
+	TArray<FGuid> DispatchedEntities[kNumEvents];
+};
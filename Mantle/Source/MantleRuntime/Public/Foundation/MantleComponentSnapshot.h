@@ -0,0 +1,99 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Containers/Array.h"
+#include "MantleDB.h"
+#include "Misc/Guid.h"
+#include "Templates/SharedPointer.h"
+
+/**
+ *  A read-only copy of one component column, taken from a single DB chunk at the end of a frame. The copy owns its
+ *  components, so it stays valid no matter what happens to the chunk (or the DB) afterwards.
+ */
+struct MANTLERUNTIME_API FMantleSnapshotChunk
+{
+public:
+	FMantleSnapshotChunk(const FGuid& NewChunkId, const FMantleComponentInfo& TypeInfo, TConstArrayView<FGuid> NewEntityIds, const uint8* SourceColumn);
+	~FMantleSnapshotChunk();
+
+	FMantleSnapshotChunk(const FMantleSnapshotChunk&) = delete;
+	FMantleSnapshotChunk& operator=(const FMantleSnapshotChunk&) = delete;
+
+	FGuid ChunkId;
+	TArray<FGuid> EntityIds;
+	uint8* Components = nullptr;
+
+private:
+	const UScriptStruct* ScriptStruct = nullptr;
+	int32 StructSize = 0;
+	bool bIsPlainOldData = false;
+};
+
+/**
+ *  The published state of one component type, as of the end of some frame. See UMantleDB::EnableSnapshot().
+ *
+ *  Snapshots are immutable once published, so any number of threads can iterate one at the same time without locking.
+ *  Chunks whose column was not written to between frames are shared with the previous snapshot instead of being copied
+ *  again.
+ */
+class MANTLERUNTIME_API FMantleComponentSnapshot
+{
+public:
+	// Incremented every time a new snapshot of this component is published.
+	uint64 GetPublishNumber() const
+	{
+		return PublishNumber;
+	}
+
+	int32 NumEntities() const
+	{
+		return TotalEntities;
+	}
+
+	// The number of chunks that had to be copied for this snapshot. The rest were shared with the previous one.
+	int32 NumCopiedChunks() const
+	{
+		return CopiedChunks;
+	}
+
+private:
+	friend FMantleIterator;
+	friend UMantleDB;
+
+	// Same layout as a DB query result, with views into Chunks, so that FMantleIterator can walk it.
+	FMantleCachedQuery Query;
+	TArray<TSharedRef<FMantleSnapshotChunk, ESPMode::ThreadSafe>> Chunks;
+
+	uint64 PublishNumber = 0;
+	int32 TotalEntities = 0;
+	int32 CopiedChunks = 0;
+};
@@ -32,18 +32,42 @@
 #pragma once
 #include "Containers/AnankeUntypedArrayView.h"
 #include "Containers/Array.h"
+#include "Containers/ArrayView.h"
 #include "Containers/BitArray.h"
 #include "Containers/Map.h"
 #include "Containers/UnrealString.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/PlatformAtomics.h"
 #include "InstancedStruct.h"
+#include "MantleCommandQueue.h"
+#include "MantleComponentAccess.h"
+#include "MantleComponentObservers.h"
+#include "MantleEventChannel.h"
+#include "MantleSideTable.h"
 #include "MantleSingleton.h"
+#include "Templates/Function.h"
 #include "Templates/SharedPointer.h"
+#include "Templates/UniquePtr.h"
+#include "UObject/ObjectKey.h"
+
+#include <atomic>
+#include <type_traits>
 
 #include "MantleDB.generated.h"
 
+// Flags direct DB access from the game thread while an async engine loop is running (see UMantleDB::ExecuteOrQueue).
+#if MANTLE_WITH_ACCESS_CHECKS
+	#define MANTLE_CHECK_DIRECT_ACCESS() CheckDirectAccess()
+#else
+	#define MANTLE_CHECK_DIRECT_ACCESS()
+#endif
+
+class AActor;
+class FMantleComponentSnapshot;
 struct FMantleComponentQuery;
 struct FMantleIterator;
 struct FMantleDBChunk;
+struct FMantleDBChunkHeader;
 struct FMantleDBEntry;
 class TestSuite;
 class UMantleDB;
@@ -61,6 +85,13 @@ namespace Ananke::Mantle
 	// Fire off a warning log if this number of chunks per entry is reached.
 	constexpr int32 kChunkCountWarnThreshold = 80;
 
+	// The number of blobs from emptied chunks that are kept around for reuse (see FMantleDBMasterRecord::FreeBlobs).
+	constexpr int32 kMaxPooledChunkBlobs = 8;
+
+	// Each component column in a chunk starts on its own cache line, so that a column never shares a line with the end
+	// of the previous one.
+	constexpr int32 kChunkColumnAlignment = PLATFORM_CACHE_LINE_SIZE;
+
 	constexpr int32 kInvalidIndex = -1;
 	constexpr int32 kInvalidSize = -1;
 	constexpr int32 kBareEntityChunkIndex = 0; // The first entry in the DB is reserved for bare entities.
@@ -85,6 +116,10 @@ public:
 	TBitArray<> Archetype;
 	FGuid ChunkId;
 	int32 Index = -1;
+
+	// Incremented every time the entity moves to a different archetype. Lets work that was based on an older copy of the
+	// entity (see UMantleAsyncOperation) tell whether it has gained or lost components since.
+	uint32 Generation = 0;
 };
 
 USTRUCT()
@@ -99,8 +134,11 @@ public:
 	int32 StructSize = Ananke::Mantle::kInvalidSize;
 	int32 StructAlignment = Ananke::Mantle::kInvalidSize;
 
-	// A temporary position within a chunk.
-	uint8* ChunkLocation = nullptr;
+	// Used to destroy component instances when they are removed from a chunk.
+	UScriptStruct* ScriptStruct = nullptr;
+
+	// Where this component's column starts, relative to the start of the chunk blob.
+	int32 ChunkOffset = Ananke::Mantle::kInvalidIndex;
 };
 
 USTRUCT()
@@ -120,7 +158,7 @@ public:
 		bIsValid = false;
 	}
 
-	bool IsValid()
+	bool IsValid() const
 	{
 		return bIsValid;
 	}
@@ -159,6 +197,9 @@ public:
 		return ChunkedEntityIds.Num();
 	}
 
+	// Records that the given component may have been written to in the chunk at ChunkIndex.
+	void MarkColumnChanged(const FString& ComponentName, int32 ChunkIndex);
+
 	TBitArray<> Archetype;
 	
 	// [type] -> [chunk][entityComponent]
@@ -166,6 +207,16 @@ public:
 	
 	// [chunk][entity]
 	TArray<TArrayView<FGuid>> ChunkedEntityIds;
+
+	// [chunk]
+	TArray<FGuid> ChunkIds;
+
+	// [chunk] Used to record writes made through the views above (see FMantleDBChunkHeader::GetColumnChanges()). Empty
+	// for snapshot results.
+	TArray<FMantleDBChunkHeader*> ChunkHeaders;
+
+	// [type] -> column index within each chunk of this archetype.
+	TMap<FString, int32> ColumnIndices;
 	
 	TSet<TBitArray<>> MatchingQueries;
 	bool bIsValid = false;
@@ -201,6 +252,14 @@ struct FMantleDBMasterRecord
 	GENERATED_BODY()
 
 public:
+	~FMantleDBMasterRecord()
+	{
+		for (uint8* Blob : FreeBlobs)
+		{
+			FMemory::Free(Blob);
+		}
+	}
+	
 	FGuid RegisterEntity(TBitArray<>& Archetype, FGuid& ChunkId, int32 ChunkIndex)
 	{
 		FMantleEntity NewEntity = FMantleEntity(Archetype, ChunkId, ChunkIndex);
@@ -243,8 +302,18 @@ public:
 		return Archetype[ComponentInfo->ArchetypeIndex];	
 	}
 
-	// The number of bytes to allocate for each chunk.
+	// The number of bytes to allocate for each chunk. This covers the chunk header and entity ids as well as the
+	// component data.
 	int32 ChunkComponentBlobSize = 0;
+
+	// Assigned to each new entry, and recorded in the header of each of its chunks.
+	int32 NextEntryIndex = 0;
+
+	// Recorded in a chunk's header whenever its entities change (see FMantleDBChunkHeader::EntitiesVersion).
+	uint32 LastEntitiesVersion = 0;
+
+	// Blobs released by emptied chunks, kept around so that chunks which fill up again don't have to reallocate.
+	TArray<uint8*> FreeBlobs;
 	
 	TMap<FString, FMantleComponentInfo> ComponentInfoMap;
 	TMap<FGuid, FMantleEntity> EntitiesById;
@@ -253,6 +322,9 @@ public:
 	TMap<TBitArray<>, FMantleCachedQuery> CachedQueries;
 	TMap<TBitArray<>, FMantleCachedEntry> CachedEntries;
 
+	// Operations that don't make structural changes may run queries concurrently, which can refresh the query cache.
+	FRWLock QueryCacheLock;
+
 	// Scenario 1: A new archetype is added:
 	//   - Create a new 'dirty' cached entry for that archetype
 	//   - Loop through all known queries and add them to the match list
@@ -271,20 +343,107 @@ public:
 	//   Otherwise, update the 'dirty' archetypes/entries.
 };
 
+template<>
+struct TStructOpsTypeTraits<FMantleDBMasterRecord> : public TStructOpsTypeTraitsBase2<FMantleDBMasterRecord>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+// Every chunk blob starts with this header. It is followed by a table of NumColumns column offsets (in the order of
+// FMantleDBEntry::Columns), a table of NumColumns column change flags, the entity id column, and then the component
+// columns. Everything needed to read a chunk lives in its blob, so a chunk can be copied or inspected as one block of
+// memory.
+struct FMantleDBChunkHeader
+{
+	int32 NumEntities = 0;
+
+	// For the bare archetype, which grows its one chunk instead of adding more, this is the number of id slots that
+	// are currently allocated.
+	int32 TotalCapacity = 0;
+
+	// The FMantleDBEntry::EntryIndex of the entry this chunk belongs to.
+	int32 EntryIndex = Ananke::Mantle::kInvalidIndex;
+	
+	int32 NumColumns = 0;
+	int32 EntityIdsOffset = 0;
+
+	// Changes whenever entities are added to or removed from this chunk. Versions are unique across the whole DB, so a
+	// chunk that reuses another chunk's blob never ends up with a version it had before.
+	uint32 EntitiesVersion = 0;
+
+	int32* GetColumnOffsets()
+	{
+		return reinterpret_cast<int32*>(this + 1);
+	}
+
+	// Followed by one flag per column, which is set whenever that column may have been written to or its rows changed.
+	// Published snapshots use these to decide which chunks need to be copied again (see UMantleDB::PublishSnapshots()).
+	int32* GetColumnChanges()
+	{
+		return GetColumnOffsets() + NumColumns;
+	}
+
+	// Atomic, since one operation may write to the same column from several worker threads at once.
+	void MarkColumnChanged(int32 ColumnIndex)
+	{
+		if (ColumnIndex >= 0 && ColumnIndex < NumColumns)
+		{
+			FPlatformAtomics::AtomicStore_Relaxed(GetColumnChanges() + ColumnIndex, 1);
+		}
+	}
+
+	void MarkAllColumnsChanged()
+	{
+		for (int32 ColumnIndex = 0; ColumnIndex < NumColumns; ++ColumnIndex)
+		{
+			GetColumnChanges()[ColumnIndex] = 1;
+		}
+	}
+
+	// Returns whether the column was marked since the last call, and clears the mark.
+	bool ConsumeColumnChange(int32 ColumnIndex)
+	{
+		return FPlatformAtomics::InterlockedExchange(GetColumnChanges() + ColumnIndex, 0) != 0;
+	}
+};
+
+inline void FMantleCachedEntry::MarkColumnChanged(const FString& ComponentName, int32 ChunkIndex)
+{
+	const int32* ColumnIndex = ColumnIndices.Find(ComponentName);
+	if (ColumnIndex && ChunkHeaders.IsValidIndex(ChunkIndex) && ChunkHeaders[ChunkIndex])
+	{
+		ChunkHeaders[ChunkIndex]->MarkColumnChanged(*ColumnIndex);
+	}
+}
+
 struct FMantleDBChunk
 {
 public:
 	explicit FMantleDBChunk(FGuid& NewChunkId, TBitArray<>& NewArchetype, FMantleDBEntry* NewEntry, FMantleDBMasterRecord* NewMasterRecord);
 	~FMantleDBChunk();
+
+	int32 GetNumEntities() const
+	{
+		return ComponentBlob ? GetHeader()->NumEntities : 0;
+	}
 	
 	int32 GetRemainingCapacity()
 	{
-		return FMath::Max(TotalCapacity - EntityIds.Num(), 0);
+		return FMath::Max(TotalCapacity - GetNumEntities(), 0);
 	}
 
 	int32 IsEmpty()
 	{
-		return EntityIds.Num() == 0;
+		return GetNumEntities() == 0;
+	}
+
+	// The ids of the entities stored in this chunk. Only valid until the next structural change to the DB.
+	TArrayView<FGuid> GetEntityIds()
+	{
+		return ComponentBlob ? TArrayView<FGuid>(GetEntityIdData(), GetNumEntities()) : TArrayView<FGuid>();
 	}
 
 	int32 AddEntities(
@@ -295,6 +454,9 @@ public:
 
 	void RemoveEntity(FMantleEntity& Entity, bool bEntityWasMoved=false);
 
+	// Removes every entity in this chunk at once. Returns the number of entities removed.
+	int32 RemoveAllEntities();
+
 	int32 TakeEntities(
 		TArrayView<FGuid>& IdsToTake,
 		FMantleDBEntry& TakeFrom,
@@ -306,6 +468,9 @@ public:
 	{
 		return GetComponentInternal(TypeName, Entity.Index);
 	}
+
+	// Records that the given component may have been written to. See FMantleDBChunkHeader::GetColumnChanges().
+	void MarkColumnChanged(const FString& TypeName);
 	
 private:
 	friend UMantleDB;
@@ -313,26 +478,55 @@ private:
 	friend TestSuite;
 
 	bool MaybeAllocateBlob();
+
+	// Called whenever entities are added to or removed from this chunk.
+	void MarkEntitiesChanged();
+
+	// The bare archetype has no component columns, so its one chunk grows to fit however many ids it needs to hold.
+	bool ReserveBareEntities(int32 NumToAdd);
+	
+	void InitializeHeader();
+
+	FMantleDBChunkHeader* GetHeader() const
+	{
+		return reinterpret_cast<FMantleDBChunkHeader*>(ComponentBlob);
+	}
+
+	FGuid* GetEntityIdData() const
+	{
+		return reinterpret_cast<FGuid*>(ComponentBlob + GetHeader()->EntityIdsOffset);
+	}
+
+	uint8* GetColumn(const FMantleComponentInfo& TypeInfo) const
+	{
+		return ComponentBlob ? ComponentBlob + TypeInfo.ChunkOffset : nullptr;
+	}
+
+	// Calls the destructor on the component(s) stored at EntityIndex. The memory itself is left in place.
+	void DestroyComponent(const FMantleComponentInfo& TypeInfo, int32 EntityIndex);
+	void DestroyComponents(int32 EntityIndex);
 	
 	void DeallocateBlob()
 	{
 		if (ComponentBlob != nullptr)
 		{
-			FMemory::Free(ComponentBlob);
+			// Only blobs of the standard size are interchangeable (the bare chunk's blob is sized to fit).
+			if (BlobSize == MasterRecord->ChunkComponentBlobSize &&
+				MasterRecord->FreeBlobs.Num() < Ananke::Mantle::kMaxPooledChunkBlobs)
+			{
+				MasterRecord->FreeBlobs.Add(ComponentBlob);
+			}
+			else
+			{
+				FMemory::Free(ComponentBlob);
+			}
+			
 			ComponentBlob = nullptr;
 			MaxLocation = nullptr;
+			BlobSize = 0;
 		}
 	}
 	
-	bool ValidateComponentInfo(FMantleComponentInfo& Info)
-	{
-		return (
-			!Info.Name.Equals(TEXT("")) &&
-			Info.StructSize > 0 &&
-			Info.StructAlignment > 0
-		);
-	}
-
 	bool LocationIsValid(void* Location)
 	{
 		if (Location == nullptr || ComponentBlob == nullptr || MaxLocation == nullptr)
@@ -345,17 +539,7 @@ private:
 
 	void RegisterEntities(int32 NumEntities, FMantleCachedEntry& OutResult);
 
-	void* GetComponentInternal(FString& TypeName, int32 EntityIndex)
-	{
-		FMantleComponentInfo* TypeInfo = ComponentTypeInfo.Find(TypeName);
-
-		if (!TypeInfo)
-		{
-			return nullptr;
-		}
-
-		return TypeInfo->ChunkLocation + (EntityIndex * TypeInfo->StructSize);
-	}
+	void* GetComponentInternal(FString& TypeName, int32 EntityIndex);
 
 	int32 TakeBareArchetypeEntities(
 		TArrayView<FGuid>& IdsToTake,
@@ -364,24 +548,20 @@ private:
 	);
 	
 	// Pointer to raw memory. The uint8 type is used here just to allow for advancing the pointer by some number of bytes.
+	// See FMantleDBChunkHeader for the layout.
 	uint8* ComponentBlob = nullptr;
 	uint8* MaxLocation = nullptr;
+	int32 BlobSize = 0;
 
 	TBitArray<> Archetype;
 	
 	FGuid ChunkId;
 
-	// The total number of entities supported by this chunk.
+	// The total number of entities supported by this chunk. This is 0 for the bare archetype.
 	int32 TotalCapacity = 0;
 
-	// The actual entities reserved for this chunk.
-	TArray<FGuid> EntityIds;
-
 	FMantleDBEntry* Entry = nullptr;
 	FMantleDBMasterRecord* MasterRecord = nullptr;
-
-	// Specifies where in the ComponentBlob to look for a particular component type.
-	TMap<FString, FMantleComponentInfo> ComponentTypeInfo;
 };
 
 struct FMantleDBEntry
@@ -394,11 +574,26 @@ public:
 
 	FMantleDBChunk& GetAvailableChunk();
 	void MakeAvailable(FGuid& ChunkId);
+
+	const FMantleComponentInfo* FindColumn(const FString& TypeName) const
+	{
+		const int32* ColumnIndex = ColumnIndices.Find(TypeName);
+		return ColumnIndex ? &Columns[*ColumnIndex] : nullptr;
+	}
 	
 	FMantleDBMasterRecord* MasterRecord = nullptr;
 
 	TBitArray<> Archetype;
 	TArray<FString> ComponentTypes;
+
+	// The chunk layout, which is the same for every chunk in this entry (see FMantleDBChunkHeader). Columns are stored
+	// in the order they appear in the blob.
+	int32 EntryIndex = Ananke::Mantle::kInvalidIndex;
+	int32 ChunkCapacity = 0;
+	int32 EntityIdsOffset = 0;
+	TArray<FMantleComponentInfo> Columns;
+	TMap<FString, int32> ColumnIndices;
+	
 	TMap<FGuid, FMantleDBChunk> Chunks;
 	TArray<FGuid> AvailableChunkIds;
 	TArray<FGuid> AllChunkIds;
@@ -420,11 +615,17 @@ public:
 	// ENTITY REMOVE
 	void RemoveEntity(const FGuid EntityId)
 	{
-		TArray<FGuid> EntityIds;
-		EntityIds.Add(EntityId);
-		RemoveEntities(EntityIds);
+		RemoveEntities(TConstArrayView<FGuid>(&EntityId, 1));
 	}
-	void RemoveEntities(const TArray<FGuid>& EntityIds);
+	void RemoveEntities(TConstArrayView<FGuid> EntityIds);
+
+	// Removes every entity matched by Query for which ShouldRemove sets a bit. ShouldRemove is called once per chunk,
+	// with OutShouldRemove sized to the number of entities in that chunk. Chunks where every entity is removed are
+	// cleared in one step instead of row by row. Returns the number of entities removed.
+	int32 RemoveEntitiesWhere(
+		FMantleComponentQuery& Query,
+		TFunctionRef<void(FMantleIterator& Iterator, TBitArray<>& OutShouldRemove)> ShouldRemove
+	);
 
 	// ENTITY UPDATE
 	FMantleIterator UpdateEntity(FGuid& EntityId, TArray<FInstancedStruct>& ComponentsToAdd, TArray<UScriptStruct*>& ComponentsToRemove);
@@ -438,9 +639,17 @@ public:
 	// ENTITY FETCH
 	FMantleIterator RunQuery(FMantleComponentQuery& Query);
 
+	// Returns true if the results of Query haven't changed (no matching entities were added, removed, or moved) since
+	// the version was recorded from an iterator. This is much cheaper than running the query.
+	bool QueryIsUnchanged(FMantleComponentQuery& Query, const FMantleDBVersion& Version);
+
+	// Request a const TComponentType (e.g. GetComponent<const FMC_Health>()) when only reading. Non-const access marks
+	// the component as changed, which makes published snapshots of it copy the chunk again (see EnableSnapshot()).
 	template<typename TComponentType>
 	TComponentType* GetComponent(FGuid EntityId)
 	{
+		MANTLE_CHECK_DIRECT_ACCESS();
+		
 		FMantleEntity* Entity = MasterRecord.EntitiesById.Find(EntityId);
 		if (!Entity)
 		{
@@ -459,15 +668,264 @@ public:
 		}
 
 		UScriptStruct* ComponentStruct = TComponentType::StaticStruct();
+		MANTLE_CHECK_COMPONENT_ACCESS(ComponentStruct->GetName(), !std::is_const_v<TComponentType>);
+		if constexpr (!std::is_const_v<TComponentType>)
+		{
+			Chunk->MarkColumnChanged(ComponentStruct->GetName());
+		}
 		return (TComponentType*)(Chunk->GetComponent(ComponentStruct->GetName(), *Entity));
 	}
 
+	// Batch version of GetComponent(). OutComponents[i] is set to the component for EntityIds[i], or nullptr if that
+	// entity doesn't exist or doesn't have the component. The lookups are sorted by chunk and row first, so each chunk is
+	// resolved once and its rows are read front to back. Prefer this over calling GetComponent() in a loop.
+	template<typename TComponentType>
+	void GetComponents(TConstArrayView<FGuid> EntityIds, TArrayView<TComponentType*> OutComponents)
+	{
+		MANTLE_CHECK_DIRECT_ACCESS();
+		
+		for (TComponentType*& Component : OutComponents)
+		{
+			Component = nullptr;
+		}
+		
+		UScriptStruct* ComponentStruct = TComponentType::StaticStruct();
+		MANTLE_CHECK_COMPONENT_ACCESS(ComponentStruct->GetName(), !std::is_const_v<TComponentType>);
+		ForEachComponentInternal(ComponentStruct, EntityIds, OutComponents.Num(), !std::is_const_v<TComponentType>, [&](int32 EntityIndex, void* Component)
+		{
+			OutComponents[EntityIndex] = static_cast<TComponentType*>(Component);
+		});
+	}
+
+	// Visits TComponentType for every entity in EntityIds that has one. Entities are visited in storage order rather than
+	// in the order they are listed; EntityIndex is the entity's position in EntityIds.
+	template<typename TComponentType>
+	void ForEachComponent(
+		TConstArrayView<FGuid> EntityIds,
+		TFunctionRef<void(int32 EntityIndex, TComponentType& Component)> Func)
+	{
+		MANTLE_CHECK_DIRECT_ACCESS();
+		
+		UScriptStruct* ComponentStruct = TComponentType::StaticStruct();
+		MANTLE_CHECK_COMPONENT_ACCESS(ComponentStruct->GetName(), !std::is_const_v<TComponentType>);
+		ForEachComponentInternal(ComponentStruct, EntityIds, EntityIds.Num(), !std::is_const_v<TComponentType>, [&](int32 EntityIndex, void* Component)
+		{
+			Func(EntityIndex, *static_cast<TComponentType*>(Component));
+		});
+	}
+
 	// ENTITY UTIL
 	bool HasEntity(FGuid EntityId)
 	{
 		return EntityId.IsValid() && MasterRecord.EntitiesById.Contains(EntityId);
 	}
 
+	// Returns the entity's current storage location, or nullptr if it doesn't exist. The returned pointer is only valid
+	// until the next structural change to the DB.
+	const FMantleEntity* FindEntity(FGuid EntityId) const
+	{
+		return MasterRecord.EntitiesById.Find(EntityId);
+	}
+
+	// AVATAR INDEX
+	// The DB keeps track of which entity each avatar actor (see FMC_AvatarActor) belongs to. The index is updated
+	// automatically when FMC_AvatarActor is added or removed, but must be updated manually via UpdateAvatarIndex() when
+	// the actor on an existing FMC_AvatarActor is changed in place. Async engine loops can't make structural changes, so
+	// lookups are safe on the game thread even while one is running.
+	FGuid FindEntityByActor(const AActor* Actor) const;
+	void FindEntitiesByActors(TConstArrayView<const AActor*> Actors, TArrayView<FGuid> OutEntityIds) const;
+	void UpdateAvatarIndex(FGuid EntityId, AActor* AvatarActor);
+
+	// EVENT CHANNELS
+	// Returns the channel for the given event type, creating it if it doesn't exist yet. Channels live as long as the
+	// DB does, so the returned reference can be cached.
+	template<typename EventType>
+	TMantleEventChannel<EventType>& GetEventChannel()
+	{
+		const FString ChannelName = EventType::StaticStruct()->GetName();
+		
+		FScopeLock Lock(&EventChannelLock);
+		TUniquePtr<FMantleEventChannelBase>& Channel = EventChannels.FindOrAdd(ChannelName);
+		if (!Channel.IsValid())
+		{
+			Channel = MakeUnique<TMantleEventChannel<EventType>>();
+		}
+		
+		return static_cast<TMantleEventChannel<EventType>&>(*Channel);
+	}
+
+	// Called by the engine at the end of every frame.
+	void SwapEventChannels();
+
+	// Returns the side table for the given value type, creating it if it doesn't exist yet. Like event channels, side
+	// tables live as long as the DB does, so the returned reference can be cached.
+	template<typename ValueType>
+	TMantleSideTable<ValueType>& GetSideTable()
+	{
+		const FString TableName = ValueType::StaticStruct()->GetName();
+		
+		FScopeLock Lock(&SideTableLock);
+		TUniquePtr<FMantleSideTableBase>& Table = SideTables.FindOrAdd(TableName);
+		if (!Table.IsValid())
+		{
+			Table = MakeUnique<TMantleSideTable<ValueType>>();
+		}
+		
+		return static_cast<TMantleSideTable<ValueType>&>(*Table);
+	}
+
+	// COMPONENT OBSERVERS
+	// Observers are told which entities gained, lost, or had a component overwritten. Events are collected as they happen
+	// and delivered at the end of the frame, with a single call per observer. An entity may show up more than once, and
+	// entities passed to Remove observers no longer exist. Observers must not be added or removed while operations are
+	// running.
+	template<typename ComponentType>
+	FDelegateHandle AddComponentObserver(EMantleComponentEvent Event, FMantleComponentObserver::FDelegate Observer)
+	{
+		FScopeLock Lock(&ComponentObserverLock);
+		TUniquePtr<FMantleComponentObservers>& Observers = ComponentObservers.FindOrAdd(ComponentType::StaticStruct()->GetName());
+		if (!Observers.IsValid())
+		{
+			Observers = MakeUnique<FMantleComponentObservers>();
+		}
+		
+		return Observers->Get(Event).Add(MoveTemp(Observer));
+	}
+
+	template<typename ComponentType>
+	void RemoveComponentObserver(EMantleComponentEvent Event, FDelegateHandle Handle)
+	{
+		FScopeLock Lock(&ComponentObserverLock);
+		if (TUniquePtr<FMantleComponentObservers>* Observers = ComponentObservers.Find(ComponentType::StaticStruct()->GetName()))
+		{
+			(*Observers)->Get(Event).Remove(Handle);
+		}
+	}
+
+	// The DB can't see components being written to in place, so operations that do this should report it here if they
+	// want Set observers to be called. Safe to call from any thread.
+	template<typename ComponentType>
+	void NotifyComponentsSet(TConstArrayView<FGuid> EntityIds)
+	{
+		RecordComponentEvent(EMantleComponentEvent::Set, ComponentType::StaticStruct()->GetName(), EntityIds);
+	}
+
+	// Called by the engine at the end of every frame. Events recorded while the observers run are delivered next frame.
+	void DispatchComponentObservers();
+
+	// QUEUED COMMANDS
+	// The rest of the DB is not thread safe. Threads other than the one running the engine (physics callbacks, async
+	// tasks, etc) should queue their changes instead, and they will be applied at the start of the engine's next tick.
+	// These are all safe to call from any thread.
+	FMantleCommandQueue& GetCommandQueue()
+	{
+		return *CommandQueue;
+	}
+
+	// For work that may outlive the DB (async tasks, etc). Holding the queue instead of the DB means a worker thread
+	// never has to check whether the DB is still alive. Commands pushed after the DB is gone are never run.
+	TSharedRef<FMantleCommandQueue, ESPMode::ThreadSafe> GetSharedCommandQueue() const
+	{
+		return CommandQueue;
+	}
+	
+	void QueueAddEntity(TArray<FInstancedStruct> InitialComposition)
+	{
+		CommandQueue->Enqueue([InitialComposition = MoveTemp(InitialComposition)](UMantleDB& MantleDB)
+		{
+			MantleDB.AddEntity(InitialComposition);
+		});
+	}
+
+	void QueueRemoveEntity(const FGuid& EntityId)
+	{
+		CommandQueue->Enqueue([EntityId](UMantleDB& MantleDB)
+		{
+			MantleDB.RemoveEntity(EntityId);
+		});
+	}
+
+	// Update is skipped if the entity was removed (or lost the component) before the command ran.
+	template<typename ComponentType>
+	void QueueComponentUpdate(const FGuid& EntityId, TUniqueFunction<void(ComponentType&)> Update)
+	{
+		CommandQueue->Enqueue([EntityId, Update = MoveTemp(Update)](UMantleDB& MantleDB)
+		{
+			if (ComponentType* Component = MantleDB.GetComponent<ComponentType>(EntityId))
+			{
+				Update(*Component);
+			}
+		});
+	}
+
+	template<typename EventType>
+	void QueueEvent(const EventType& Event)
+	{
+		CommandQueue->Enqueue([Event](UMantleDB& MantleDB)
+		{
+			MantleDB.GetEventChannel<EventType>().Write(Event);
+		});
+	}
+
+	// Called by the engine at the start of every tick, before any operations run. Returns the number of commands run.
+	int32 ExecuteQueuedCommands()
+	{
+		return CommandQueue->Drain(*this);
+	}
+
+	// ASYNC ENGINE LOOPS
+	// While an async engine loop is running (see FMantleEngineLoopOptions::bRunAsync), its operations are using the DB on
+	// a worker thread, so game thread code (actors, components, function libraries, etc) must not use the DB directly.
+	// In non-shipping builds, doing so is reported as an error.
+	bool IsAsyncLoopRunning() const
+	{
+		return NumAsyncLoopsRunning.load() > 0;
+	}
+
+	// Returns false if the calling thread is the game thread and an async engine loop is running. Operations are always
+	// allowed to use the DB directly, since the engine only runs them when it is safe to.
+	bool CanAccessDirectly() const;
+
+	// Runs the command immediately if the DB can be used directly from the calling thread. Otherwise, the command is
+	// queued and runs at the start of the engine's next game thread loop. Game thread code that might run while an async
+	// loop is in flight (for example in response to overlap or hit events) should use this instead of calling the DB.
+	void ExecuteOrQueue(FMantleCommand&& Command);
+
+	// Called by async engine loops. BeginAsyncLoop() is called on the game thread before the loop is allowed to start (so
+	// there is no window where both the loop and the game thread think they can use the DB). EnterAsyncLoop() and
+	// EndAsyncLoop() are called on the thread that runs the loop.
+	void BeginAsyncLoop();
+	void EnterAsyncLoop();
+	void EndAsyncLoop();
+
+	// PUBLISHED SNAPSHOTS
+	// Threads outside the engine (UI, animation, AI planning, etc) can't read chunks directly, since operations write to
+	// them in place and structural changes move rows around. Instead, a component can opt in to being published: at the
+	// end of every frame its column is copied into an immutable FMantleComponentSnapshot, which other threads can keep
+	// and iterate for as long as they like. Only chunks whose column was written to (through a non-const view, query
+	// argument, or GetComponent()) or whose rows changed are copied; the rest are shared with the previous snapshot. Must
+	// not be called while operations are running.
+	template<typename ComponentType>
+	void EnableSnapshot()
+	{
+		EnableSnapshot(ComponentType::StaticStruct()->GetName());
+	}
+
+	void EnableSnapshot(const FString& ComponentName);
+
+	// Returns the most recently published snapshot of the given component, or nullptr if none has been published yet.
+	// Safe to call from any thread. Use FMantleIterator(Snapshot) to iterate it.
+	template<typename ComponentType>
+	TSharedPtr<const FMantleComponentSnapshot, ESPMode::ThreadSafe> GetSnapshot() const
+	{
+		return GetSnapshot(ComponentType::StaticStruct()->GetName());
+	}
+	
+	TSharedPtr<const FMantleComponentSnapshot, ESPMode::ThreadSafe> GetSnapshot(const FString& ComponentName) const;
+
+	// Called by the engine at the end of every frame.
+	void PublishSnapshots();
+
 	template<typename ComponentType>
 	bool HasComponent(FGuid EntityId)
 	{
@@ -520,15 +978,50 @@ protected:
 		return Entry->Get()->Chunks.Find(ChunkId);
 	}
 
+	void ForEachComponentInternal(
+		UScriptStruct* ComponentType,
+		TConstArrayView<FGuid> EntityIds,
+		int32 NumOutputs,
+		bool bMarkChanged,
+		TFunctionRef<void(int32 EntityIndex, void* Component)> Func);
+
 	FMantleIterator RunQueryInternal(TBitArray<>& QueryArchetype);
 	bool RefreshCachedEntry(FMantleCachedEntry& Entry);
 	void EntryWasModified(TBitArray<>& EntryArchetype);
 	bool RefreshCachedQuery(TBitArray<>& Archetype);
+	void RemoveAvatarIndex(FGuid EntityId);
+	void AddAvatarIndex(const TArray<FInstancedStruct>& AddedComponents, TArrayView<const FGuid> EntityIds);
+
+	void RemoveFromSideTables(TConstArrayView<FGuid> EntityIds);
+
+	void CheckDirectAccess() const;
+
+	void RecordComponentEvent(EMantleComponentEvent Event, const FString& ComponentName, TConstArrayView<FGuid> EntityIds);
+	void RecordComponentEvents(EMantleComponentEvent Event, TConstArrayView<FString> ComponentNames, TConstArrayView<FGuid> EntityIds);
 	
 	TMap<TBitArray<>, TSharedPtr<FMantleDBEntry>> EntriesByArchetype;
 	TArray<TBitArray<>> ActiveArchetypes; // Allows us to iterate through EnteriesByArchetype in a deterministic way (for testing).
 	FMantleDBMasterRecord MasterRecord;
 
+	TMap<TObjectKey<AActor>, FGuid> EntitiesByAvatarActor;
+	TMap<FGuid, TObjectKey<AActor>> AvatarActorsByEntity;
+
+	TMap<FString, TUniquePtr<FMantleEventChannelBase>> EventChannels;
+	FCriticalSection EventChannelLock;
+
+	TMap<FString, TUniquePtr<FMantleSideTableBase>> SideTables;
+	FCriticalSection SideTableLock;
+
+	TMap<FString, TUniquePtr<FMantleComponentObservers>> ComponentObservers;
+	FCriticalSection ComponentObserverLock;
+
+	TSharedRef<FMantleCommandQueue, ESPMode::ThreadSafe> CommandQueue =
+		MakeShared<FMantleCommandQueue, ESPMode::ThreadSafe>();
+	std::atomic<int32> NumAsyncLoopsRunning{0};
+
+	TMap<FString, TSharedPtr<const FMantleComponentSnapshot, ESPMode::ThreadSafe>> Snapshots;
+	mutable FRWLock SnapshotLock;
+
 	// TODO(): Add back when there is an actual use-case for this.
 	// UPROPERTY()
 	// TMap<FString, TObjectPtr<UMantleSingleton>> Singletons;
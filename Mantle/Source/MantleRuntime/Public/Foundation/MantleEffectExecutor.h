@@ -30,8 +30,13 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include "Containers/ArrayView.h"
+#include "Foundation/MantleCommandQueue.h"
+#include "Foundation/MantleEventChannel.h"
 #include "Foundation/MantleOperation.h"
 #include "Foundation/MantleQueries.h"
+#include "MantleComponents/EffectPayloads/EP_EffectMetadata.h"
+#include "Misc/Optional.h"
 
 #include "MantleEffectExecutor.generated.h"
 
@@ -55,6 +60,35 @@ public:
 	EMantleEffectExecutionStatus ExecutionStatus = EMantleEffectExecutionStatus::Failed;
 };
 
+// A single pending execution of an effect.
+struct FMantleEffectInvocation
+{
+	// Which call to LoadEffectPayloads() this effect's payload came from (0 for the first chunk loaded this frame, etc).
+	int32 PayloadChunk = Ananke::Mantle::kInvalidIndex;
+
+	// Index of the effect within its payload chunk.
+	int32 EffectIndex = Ananke::Mantle::kInvalidIndex;
+
+	FGuid EffectId;
+
+	// Filled in by GetEffectTargets(). Invocations are grouped by the storage location of their target.
+	FGuid TargetEntity;
+	
+	bool bCancelRequested = false;
+};
+
+// Entry in an executor's schedule of upcoming effect triggers.
+struct FMantleScheduledEffect
+{
+	double DueTimeSec = 0.0;
+	FGuid EffectId;
+
+	bool operator<(const FMantleScheduledEffect& Other) const
+	{
+		return DueTimeSec < Other.DueTimeSec;
+	}
+};
+
 UCLASS()
 class MANTLERUNTIME_API UMantleEffectExecutor : public UMantleOperation
 {
@@ -66,15 +100,142 @@ public:
 protected:
 	virtual void PerformOperation(FMantleOperationContext& Ctx) override;
 
-	// Override this fn to grab whatever payload components are attached to your specific effect entity type. While you
-	// technically *can* also grab FEP_EffectMetadata, modifying it could cause this base Executor class to stop
-	// functioning properly. Ideally, any changes to the EffectMetadata should be communicated from the child executor
-	// to this base class via the FMantleEffectExecutionResult struct.
-	virtual void LoadEffectPayloads(FMantleIterator& Iterator) {} 
-	virtual FMantleEffectExecutionResult Execute(FMantleOperationContext& Ctx, int32 EffectIndex, bool CancelRequested)
+	// Override this fn to grab whatever payload components are attached to your specific effect entity type. It is called
+	// once per chunk that has effects ready to execute, and the payloads should be appended so that they can later be
+	// looked up by FMantleEffectInvocation::PayloadChunk. While you technically *can* also grab
+	// FEP_EffectMetadata, modifying it could cause this base Executor class to stop functioning properly. Ideally, any
+	// changes to the EffectMetadata should be communicated from the child executor to this base class via the
+	// FMantleEffectExecutionResult struct.
+	virtual void LoadEffectPayloads(FMantleIterator& Iterator) {}
+
+	// Called at the end of each frame's execution. Payload views must not be held past this point.
+	virtual void ClearEffectPayloads() {}
+
+	// Fill in TargetEntity for each invocation. All invocations passed in share the same PayloadChunk.
+	virtual void GetEffectTargets(int32 PayloadChunk, TArrayView<FMantleEffectInvocation> Invocations) {}
+
+	// Executes a batch of effects. Invocations are sorted by the storage location of their targets, and all targets in
+	// a single batch live in the same DB chunk. OutResults is parallel to Invocations.
+	virtual void ExecuteBatch(
+		FMantleOperationContext& Ctx,
+		TConstArrayView<FMantleEffectInvocation> Invocations,
+		TArrayView<FMantleEffectExecutionResult> OutResults
+	) {}
+
+	// Events, component notifications, and anything else ExecuteBatch() publishes should go through this rather than
+	// straight to the DB. When batches run in parallel, each shard holds on to its output until every shard has
+	// finished, and the outputs are then published in batch order, so the result is the same as a serial run no matter
+	// how the batches were split up. Otherwise, Publish runs immediately.
+	void PublishBatchOutput(FMantleOperationContext& Ctx, FMantleCommand&& Publish);
+
+	// ExecuteBatch() for effects that modify a single component on their target. Looks up the targets' components for
+	// the whole batch at once, and cancels effects that were canceled or whose target no longer has the component.
+	// Every other invocation is passed to ApplyEffect(Invocation, Component, OutEvent), which returns the execution
+	// status and sets OutEvent if it changed the component. The events, and the matching
+	// UMantleDB::NotifyComponentsSet() call, are published through PublishBatchOutput().
+	template<typename ComponentType, typename EventType, typename ApplyEffectType>
+	void ExecuteComponentBatch(
+		FMantleOperationContext& Ctx,
+		TConstArrayView<FMantleEffectInvocation> Invocations,
+		TArrayView<FMantleEffectExecutionResult> OutResults,
+		ApplyEffectType&& ApplyEffect
+	)
 	{
-		return FMantleEffectExecutionResult();
+		TArray<FGuid, FMantleScratchAllocator> TargetEntities;
+		TargetEntities.SetNumUninitialized(Invocations.Num());
+		for (int32 InvocationIndex = 0; InvocationIndex < Invocations.Num(); ++InvocationIndex)
+		{
+			TargetEntities[InvocationIndex] = Invocations[InvocationIndex].TargetEntity;
+		}
+
+		TArray<ComponentType*, FMantleScratchAllocator> TargetComponents;
+		TargetComponents.SetNumUninitialized(Invocations.Num());
+		Ctx.MantleDB->GetComponents<ComponentType>(TargetEntities, TargetComponents);
+
+		TArray<EventType, FMantleScratchAllocator> Events;
+		TArray<FGuid, FMantleScratchAllocator> ModifiedTargets;
+		
+		for (int32 InvocationIndex = 0; InvocationIndex < Invocations.Num(); ++InvocationIndex)
+		{
+			const FMantleEffectInvocation& Invocation = Invocations[InvocationIndex];
+
+			// Targets that no longer exist (or no longer have the component) are found here as well.
+			ComponentType* TargetComponent = TargetComponents[InvocationIndex];
+			if (Invocation.bCancelRequested || !TargetComponent)
+			{
+				OutResults[InvocationIndex].ExecutionStatus = EMantleEffectExecutionStatus::Cancel;
+				continue;
+			}
+
+			TOptional<EventType> Event;
+			OutResults[InvocationIndex].ExecutionStatus = ApplyEffect(Invocation, *TargetComponent, Event);
+			
+			if (Event.IsSet())
+			{
+				Events.Add(MoveTemp(Event.GetValue()));
+				ModifiedTargets.Add(Invocation.TargetEntity);
+			}
+		}
+
+		PublishBatchOutput(
+			Ctx,
+			[Events = MoveTemp(Events), ModifiedTargets = MoveTemp(ModifiedTargets)](UMantleDB& MantleDB)
+			{
+				MantleDB.GetEventChannel<EventType>().Write(Events);
+				MantleDB.NotifyComponentsSet<ComponentType>(ModifiedTargets);
+			}
+		);
 	}
 	
 	FMantleComponentQuery Query;
+
+	// Subclasses can set this if ExecuteBatch() is safe to call for different batches at the same time. Batches never
+	// share a target chunk, so this is true of executors that only write to their targets' components (and publish
+	// everything else through PublishBatchOutput()). Large frames are then split into shards that run on worker threads.
+	bool bCanExecuteBatchesInParallel = false;
+
+private:
+	friend TestSuite;
+	
+	// Forgets every scheduled effect, so that they are all discovered again on the next run.
+	void ResetSchedule();
+	
+	void ScheduleNewEffects(FMantleIterator& Iterator);
+	void ScheduleEffect(const FGuid& EffectId, double DueTimeSec);
+	void SortInvocationsByTarget(FMantleOperationContext& Ctx, TArray<FGuid, FMantleScratchAllocator>& OutTargetChunkIds);
+	void ExecuteBatches(FMantleOperationContext& Ctx, TConstArrayView<int32> BatchStarts);
+
+	// Min-heap of upcoming effect triggers. Entries for effects that have since been removed (or have left the query)
+	// are dropped when popped.
+	TArray<FMantleScheduledEffect> EffectSchedule;
+
+	// Effects that have at least one entry in EffectSchedule.
+	TSet<FGuid> ScheduledEffects;
+
+	// The DB the schedule was built from. The schedule is reset if the executor is run against a different one.
+	TWeakObjectPtr<UMantleDB> ScheduledDB;
+
+	// New effects are only discovered when the query results change from this version.
+	FMantleDBVersion ScheduledQueryVersion;
+
+	// The FMantleDBChunkHeader::EntitiesVersion of each chunk in the query results as of the last discovery. Chunks
+	// whose entities haven't changed since then are not searched again.
+	TMap<FGuid, uint32> DiscoveredChunkVersions;
+
+	// Tracks which FEP_EffectCancelRequest events have been handled.
+	FMantleEventCursor CancelRequestCursor;
+	
+	TArray<TArrayView<FEP_EffectMetadata>> MetadataChunks;
+	TArray<FMantleEffectInvocation> PendingInvocations;
+	TArray<FMantleEffectExecutionResult> PendingResults;
+
+	// Scratch memory for each shard when batches are executed in parallel (the frame arena is not thread safe).
+	TArray<TUniquePtr<FMantleFrameArena>> ShardFrameArenas;
+
+	// Output held back by each shard (see PublishBatchOutput()).
+	TArray<FMantleCommandBuffer> ShardOutputs;
+
+	// If set, batches are split into (up to) this many shards regardless of the number of worker threads. Tests use
+	// this to compare parallel and serial runs.
+	int32 MaxShardsOverride = 0;
 };
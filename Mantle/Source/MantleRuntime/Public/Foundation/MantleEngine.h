@@ -30,6 +30,7 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include "MantleFrameArena.h"
 #include "MantleOperation.h"
 #include "Async/TaskGraphFwd.h"
 #include "Async/TaskGraphInterfaces.h"
@@ -37,6 +38,7 @@
 #include "Engine/EngineBaseTypes.h"
 #include "Engine/World.h"
 #include "Subsystems/GameInstanceSubsystem.h"
+#include "Templates/UniquePtr.h"
 #include "UObject/Class.h"
 #include "UObject/Object.h"
 #include "UObject/ObjectPtr.h"
@@ -44,8 +46,8 @@
 
 #include "MantleEngine.generated.h"
 
-// Lightweight container for a collection of operations. We may use this to specify operations that can run concurrently
-// in the future.
+// Lightweight container for a collection of operations. Groups are run in order. When multithreading is enabled,
+// operations are scheduled based on their declared component access (see FMantleComponentAccess).
 USTRUCT()
 struct MANTLERUNTIME_API FMantleOperationGroup
 {
@@ -64,7 +66,71 @@ struct MANTLERUNTIME_API FMantleEngineLoopOptions
 public:
 	UPROPERTY()
 	TArray<FMantleOperationGroup> OperationGroups;
-	bool bRunMultithreaded = false; // Currently not supported.
+	
+	// If true, operations that don't conflict with each other are run concurrently on task graph worker threads.
+	// Operations that make structural changes, require the game thread, or don't declare their component access are
+	// still run on the game thread, and act as a barrier for the operations around them. Commands that operations defer
+	// (see FMantleOperationContext::Defer) are run at those barriers, and at the end of the loop.
+	bool bRunMultithreaded = false;
+
+	// If true, the whole loop is dispatched to a task graph worker thread when its tick group starts, and only has to
+	// finish by AsyncEndTickGroup. This lets Mantle overlap physics and other game thread work instead of adding to the
+	// frame. Later engine loops still wait for it to finish. While it is running, game thread code must not touch the DB
+	// directly (see UMantleDB::ExecuteOrQueue), and commands deferred by its operations run at the start of the next game
+	// thread loop.
+	//
+	// Only loops where every operation could run on a worker thread anyway (see FMantleComponentAccess::IsSyncPoint)
+	// can run async. Otherwise this is ignored, and the loop runs on the game thread as usual.
+	bool bRunAsync = false;
+	ETickingGroup AsyncEndTickGroup = TG_PostPhysics;
+};
+
+// An operation with its position in the engine loop resolved into explicit dependencies.
+struct FMantleScheduledOperation
+{
+	TWeakObjectPtr<UMantleOperation> Operation;
+
+	// Indices of earlier (non sync point) operations in the schedule that must finish before this one can start.
+	TArray<int32> Dependencies;
+
+	bool bIsSyncPoint = true;
+
+	// Operations that run on worker threads can't share the loop's arena, so each one gets its own.
+	TUniquePtr<FMantleFrameArena> FrameArena;
+
+	// Commands deferred by the operation this tick. Played back in schedule order, so the result doesn't depend on
+	// which operations happened to finish first.
+	FMantleCommandBuffer Commands;
+};
+
+// Runs on the game thread right before an async engine loop is allowed to start, and tells the DB that the game thread
+// can't use it directly until the loop has finished (see UMantleDB::BeginAsyncLoop).
+USTRUCT()
+struct FMantleAsyncLoopGate : public FTickFunction
+{
+	GENERATED_BODY()
+
+public:
+	FMantleAsyncLoopGate();
+
+	TWeakObjectPtr<UMantleDB> MantleDB;
+
+protected:
+	virtual void ExecuteTick(
+		float DeltaTime,
+		ELevelTick TickType,
+		ENamedThreads::Type CurrentThread,
+		const FGraphEventRef& MyCompletionGraphEvent
+	) override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FMantleAsyncLoopGate> : public TStructOpsTypeTraitsBase2<FMantleAsyncLoopGate>
+{
+	enum
+	{
+		WithCopy = false // It is unsafe to copy FTickFunctions
+	};
 };
 
 USTRUCT()
@@ -81,6 +147,20 @@ public:
 	UPROPERTY()
 	FMantleOperationContext OperationContext;
 
+	// Must be called after all operations are initialized, since operations may declare their access in Initialize().
+	void BuildSchedule();
+
+	// Set on the last loop of the frame, which also does the DB's end of frame bookkeeping.
+	bool bIsFrameEnd = false;
+
+	bool IsAsync() const
+	{
+		return bRunOnAnyThread;
+	}
+
+	// Only registered for async loops, which always have it as a prerequisite.
+	FMantleAsyncLoopGate AsyncLoopGate;
+
 protected:
 	virtual void ExecuteTick(
 		float DeltaTime,
@@ -88,6 +168,25 @@ protected:
 		ENamedThreads::Type CurrentThread,
 		const FGraphEventRef& MyCompletionGraphEvent
 	) override;
+
+	void RunOperationsConcurrently(ENamedThreads::Type CurrentThread);
+
+	// Runs the deferred commands in the buffer. Async loops aren't allowed to make structural changes, so they pass the
+	// commands on to the DB's command queue instead.
+	void PlaybackCommands(FMantleCommandBuffer& Buffer);
+
+	// Returns false (and the reason) if this loop has to run on the game thread.
+	bool CanRunAsync(FString& OutReason) const;
+	
+	TArray<FMantleScheduledOperation> Schedule;
+
+	// Scratch memory for operations that run on the game thread. Reset at the end of every tick.
+	FMantleFrameArena FrameArena;
+
+	// Commands deferred by operations that run on the game thread.
+	FMantleCommandBuffer Commands;
+
+	friend TestSuite;
 };
 
 template<>
@@ -145,11 +244,32 @@ public:
 		return TWeakObjectPtr<OperationType>(Operation);
 	}
 
+	// Returns the first operation of the given type, or null if there isn't one.
+	template<typename OperationType>
+	TWeakObjectPtr<OperationType> GetOperation()
+	{
+		for (UMantleOperation* Operation : Operations)
+		{
+			if (OperationType* TypedOperation = Cast<OperationType>(Operation))
+			{
+				return TWeakObjectPtr<OperationType>(TypedOperation);
+			}
+		}
+
+		return nullptr;
+	}
+
 protected:
 	void ResetCounters();
 	
 	void ActivateEngineLoop(FMantleEngineLoop& TickFunction, UWorld& World);
 	void DeactivateEngineLoop(FMantleEngineLoop& TickFunction);
+
+	// Makes every loop after an async loop wait for it to finish.
+	void AddAsyncLoopPrerequisites();
+	void RemoveAsyncLoopPrerequisites();
+
+	TArray<FMantleEngineLoop*> GetEngineLoops();
 	
 	UPROPERTY()
 	TObjectPtr<UMantleDB> MantleDB = nullptr;
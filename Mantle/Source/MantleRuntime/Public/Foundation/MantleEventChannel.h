@@ -0,0 +1,145 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Containers/Array.h"
+#include "Containers/ArrayView.h"
+#include "HAL/CriticalSection.h"
+#include "MantleComponentAccess.h"
+#include "Misc/ScopeLock.h"
+
+#include <atomic>
+
+// Tracks how far a consumer has read into an event channel.
+struct FMantleEventCursor
+{
+	uint64 NextEvent = 0;
+};
+
+// Lets the DB own and swap event channels without knowing their event type.
+class MANTLERUNTIME_API FMantleEventChannelBase
+{
+public:
+	virtual ~FMantleEventChannelBase() = default;
+
+	// Makes the events written since the last swap readable, and starts a new (empty) write buffer.
+	virtual void SwapBuffers() = 0;
+};
+
+/**
+ *  A per-frame, double-buffered stream of events.
+ *
+ *  Producers write to the current frame's buffer from any thread. At the end of each frame the buffers are swapped, and
+ *  consumers read the previous frame's events as a contiguous array. Both buffers keep their allocations between
+ *  frames, so steady-state writes don't allocate. Events that are not read within one frame are dropped.
+ *
+ *  Writes are safe at any time. Reads are not locked, so they are only legal while the buffers can't be swapped:
+ *  from operations (the engine swaps at the end of the frame, once every operation has finished), or from the game
+ *  thread while no async engine loop is running (see UMantleDB::CanAccessDirectly). The returned views are only valid
+ *  until the next swap. In non-shipping builds, reads that overlap a swap are caught by an assert.
+ */
+template<typename EventType>
+class TMantleEventChannel final : public FMantleEventChannelBase
+{
+public:
+	void Write(const EventType& Event)
+	{
+		FScopeLock Lock(&WriteLock);
+		WriteBuffer.Add(Event);
+	}
+	
+	void Write(TConstArrayView<EventType> Events)
+	{
+		FScopeLock Lock(&WriteLock);
+		WriteBuffer.Append(Events.GetData(), Events.Num());
+	}
+
+	// Returns all events that were written during the previous frame.
+	TConstArrayView<EventType> ReadAll() const
+	{
+		CheckNotSwapping();
+		return ReadBuffer;
+	}
+
+	// Returns the events from the previous frame that the cursor has not seen yet, and advances the cursor past them.
+	TConstArrayView<EventType> Read(FMantleEventCursor& Cursor) const
+	{
+		CheckNotSwapping();
+		
+		const uint64 ReadEnd = ReadStart + ReadBuffer.Num();
+		const uint64 FirstUnread = FMath::Max(Cursor.NextEvent, ReadStart);
+		Cursor.NextEvent = ReadEnd;
+
+		if (FirstUnread >= ReadEnd)
+		{
+			return TConstArrayView<EventType>();
+		}
+
+		const int32 FirstIndex = static_cast<int32>(FirstUnread - ReadStart);
+		return TConstArrayView<EventType>(ReadBuffer.GetData() + FirstIndex, ReadBuffer.Num() - FirstIndex);
+	}
+
+	virtual void SwapBuffers() override
+	{
+		FScopeLock Lock(&WriteLock);
+#if MANTLE_WITH_ACCESS_CHECKS
+		bIsSwapping.store(true);
+#endif
+		
+		ReadStart += ReadBuffer.Num();
+		Swap(ReadBuffer, WriteBuffer);
+		WriteBuffer.Reset();
+
+#if MANTLE_WITH_ACCESS_CHECKS
+		bIsSwapping.store(false);
+#endif
+	}
+
+private:
+	void CheckNotSwapping() const
+	{
+#if MANTLE_WITH_ACCESS_CHECKS
+		checkf(!bIsSwapping.load(), TEXT("Event channels must not be read while their buffers are being swapped."));
+#endif
+	}
+	
+	TArray<EventType> ReadBuffer;
+	TArray<EventType> WriteBuffer;
+
+	// Sequence number of the first event in ReadBuffer.
+	uint64 ReadStart = 0;
+	
+	FCriticalSection WriteLock;
+
+#if MANTLE_WITH_ACCESS_CHECKS
+	std::atomic<bool> bIsSwapping{false};
+#endif
+};
@@ -0,0 +1,233 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Containers/Array.h"
+#include "Containers/ContainerAllocationPolicies.h"
+#include "HAL/UnrealMemory.h"
+
+/**
+ *  A linear allocator for data that only lives for one tick of an engine loop.
+ *
+ *  Allocations bump a pointer inside a block, and are never freed individually. Instead, the whole arena is rewound once
+ *  per tick. If a tick needed more than one block, the blocks are merged into a single block big enough for the whole
+ *  tick, so after the first few ticks the arena stops touching the heap.
+ *
+ *  An arena is not thread safe. When operations run concurrently, each one gets its own arena.
+ */
+class MANTLERUNTIME_API FMantleFrameArena
+{
+public:
+	FMantleFrameArena() = default;
+	~FMantleFrameArena();
+
+	FMantleFrameArena(const FMantleFrameArena&) = delete;
+	FMantleFrameArena& operator=(const FMantleFrameArena&) = delete;
+
+	void* Allocate(SIZE_T Size, SIZE_T Alignment);
+
+	// Invalidates everything that was allocated from this arena.
+	void Reset();
+
+	SIZE_T GetBytesUsed() const;
+
+	// The arena used by FMantleScratchAllocator on the calling thread, or null if there isn't one.
+	static FMantleFrameArena* GetActive();
+
+private:
+	struct FBlock
+	{
+		uint8* Data = nullptr;
+		SIZE_T Size = 0;
+	};
+
+	void AddBlock(SIZE_T MinSize);
+
+	static constexpr SIZE_T kDefaultBlockSize = 64 * 1024;
+	static constexpr SIZE_T kBlockAlignment = 64;
+	
+	TArray<FBlock> Blocks;
+	int32 CurrentBlock = INDEX_NONE;
+	SIZE_T CurrentOffset = 0;
+	SIZE_T BytesUsedInPreviousBlocks = 0;
+};
+
+// Makes an arena the active arena on this thread for the lifetime of the scope.
+class MANTLERUNTIME_API FMantleFrameArenaScope
+{
+public:
+	explicit FMantleFrameArenaScope(FMantleFrameArena* Arena);
+	~FMantleFrameArenaScope();
+
+private:
+	FMantleFrameArena* PreviousArena;
+};
+
+/**
+ *  TArray allocator for per-tick scratch buffers, e.g. TArray<FGuid, FMantleScratchAllocator>.
+ *
+ *  Memory comes from the thread's active frame arena (see UMantleOperation::Run), so arrays that use this allocator must
+ *  not outlive the operation that created them. If no arena is active, the allocator falls back to the heap.
+ */
+class FMantleScratchAllocator
+{
+public:
+	using SizeType = int32;
+
+	enum { NeedsElementType = true };
+	enum { RequireRangeCheck = true };
+
+	template<typename ElementType>
+	class ForElementType
+	{
+	public:
+		ForElementType() = default;
+
+		~ForElementType()
+		{
+			if (bHeapAllocated)
+			{
+				FMemory::Free(Data);
+			}
+		}
+
+		void MoveToEmpty(ForElementType& Other)
+		{
+			checkSlow(this != &Other);
+
+			if (bHeapAllocated)
+			{
+				FMemory::Free(Data);
+			}
+			
+			Data = Other.Data;
+			bHeapAllocated = Other.bHeapAllocated;
+			Other.Data = nullptr;
+			Other.bHeapAllocated = false;
+		}
+
+		ElementType* GetAllocation() const
+		{
+			return Data;
+		}
+
+		void ResizeAllocation(SizeType PreviousNumElements, SizeType NumElements, SIZE_T NumBytesPerElement)
+		{
+			if (NumElements == 0)
+			{
+				if (bHeapAllocated)
+				{
+					FMemory::Free(Data);
+				}
+				Data = nullptr;
+				bHeapAllocated = false;
+				return;
+			}
+
+			const SIZE_T NumBytes = NumElements * NumBytesPerElement;
+			const uint32 Alignment = FMath::Max<uint32>(alignof(ElementType), kMinAlignment);
+
+			if (bHeapAllocated && !FMantleFrameArena::GetActive())
+			{
+				Data = static_cast<ElementType*>(FMemory::Realloc(Data, NumBytes, Alignment));
+				return;
+			}
+			
+			ElementType* NewData = nullptr;
+			bool bNewDataHeapAllocated = false;
+			if (FMantleFrameArena* Arena = FMantleFrameArena::GetActive())
+			{
+				NewData = static_cast<ElementType*>(Arena->Allocate(NumBytes, Alignment));
+			}
+			else
+			{
+				NewData = static_cast<ElementType*>(FMemory::Malloc(NumBytes, Alignment));
+				bNewDataHeapAllocated = true;
+			}
+
+			if (Data && PreviousNumElements > 0)
+			{
+				FMemory::Memcpy(NewData, Data, FMath::Min(PreviousNumElements, NumElements) * NumBytesPerElement);
+			}
+			if (bHeapAllocated)
+			{
+				FMemory::Free(Data);
+			}
+
+			// Arena allocations are not freed here. The space is reclaimed when the arena is reset.
+			Data = NewData;
+			bHeapAllocated = bNewDataHeapAllocated;
+		}
+
+		SizeType CalculateSlackReserve(SizeType NumElements, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackReserve(NumElements, NumBytesPerElement, false);
+		}
+
+		SizeType CalculateSlackShrink(SizeType NumElements, SizeType NumAllocatedElements, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackShrink(NumElements, NumAllocatedElements, NumBytesPerElement, false);
+		}
+
+		SizeType CalculateSlackGrow(SizeType NumElements, SizeType NumAllocatedElements, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackGrow(NumElements, NumAllocatedElements, NumBytesPerElement, false);
+		}
+
+		SIZE_T GetAllocatedSize(SizeType NumAllocatedElements, SIZE_T NumBytesPerElement) const
+		{
+			return NumAllocatedElements * NumBytesPerElement;
+		}
+
+		bool HasAllocation() const
+		{
+			return !!Data;
+		}
+
+		SizeType GetInitialCapacity() const
+		{
+			return 0;
+		}
+
+	private:
+		ForElementType(const ForElementType&) = delete;
+		ForElementType& operator=(const ForElementType&) = delete;
+		
+		static constexpr uint32 kMinAlignment = 16;
+
+		ElementType* Data = nullptr;
+		
+		// Set when the current allocation came from the heap (no arena was active), and must be freed by this allocator.
+		bool bHeapAllocated = false;
+	};
+
+	typedef ForElementType<FScriptContainerElement> ForAnyElementType;
+};
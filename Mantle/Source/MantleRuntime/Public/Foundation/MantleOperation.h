@@ -30,8 +30,10 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include "MantleCommandQueue.h"
+#include "MantleComponentAccess.h"
 #include "MantleDB.h"
-#include "Containers/Set.h"
+#include "MantleFrameArena.h"
 #include "UObject/Class.h"
 #include "UObject/Object.h"
 #include "UObject/WeakObjectPtrTemplates.h"
@@ -49,6 +51,22 @@ public:
 	
 	UPROPERTY()
 	TWeakObjectPtr<UWorld> World;
+
+	// Scratch memory for the current tick. Owned by the engine loop, and reset at the end of every tick.
+	FMantleFrameArena* FrameArena = nullptr;
+
+	// Where deferred commands are recorded. Owned by the engine loop. If null, deferred commands run immediately.
+	FMantleCommandBuffer* Commands = nullptr;
+
+	// Records a change that the operation is not allowed to make while it is running: structural changes (adding or
+	// removing entities, changing their composition), or work that has to happen on the game thread. The engine loop
+	// runs deferred commands on the game thread once every operation scheduled alongside this one has finished, in
+	// schedule order. Async loops hand them to the DB's command queue instead, so they run at the start of the next
+	// game thread loop.
+	//
+	// Deferring these changes (instead of declaring AddStructuralChanges or RequireGameThread) keeps the operation from
+	// acting as a sync point.
+	void Defer(FMantleCommand&& Command);
 };
 
 UCLASS(Abstract)
@@ -63,11 +81,15 @@ public:
 	
 	void Run(FMantleOperationContext& Ctx);
 
-	virtual TSet<UScriptStruct*> GetRequiredComponents()
+	const FMantleComponentAccess& GetComponentAccess() const
 	{
-		return TSet<UScriptStruct*>();
+		return ComponentAccess;
 	}
 
 protected:
 	virtual void PerformOperation(FMantleOperationContext& Ctx);
+
+	// Subclasses should declare the components they read and write (either in their constructor or in Initialize()).
+	// Operations that don't declare anything are never run concurrently with other operations.
+	FMantleComponentAccess ComponentAccess;
 };
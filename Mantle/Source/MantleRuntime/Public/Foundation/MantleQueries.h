@@ -40,10 +40,17 @@
 #include "MantleRuntimeLoggingDefs.h"
 #include "Macros/AnankeCoreLoggingMacros.h"
 #include "Misc/Guid.h"
+#include "Templates/SharedPointer.h"
 #include "UObject/Class.h"
 
+#include <type_traits>
+#include <utility>
+
 #include "MantleQueries.generated.h"
 
+template<typename... TArgs>
+struct TMantleQuery;
+
 USTRUCT()
 struct FMantleComponentQuery
 {
@@ -89,15 +96,57 @@ public:
 		LocalCache = DBCache;
 		MasterRecord = DBMasterRecord;
 	}
-	
+
+	// Iterates a published snapshot (see UMantleDB::EnableSnapshot()) instead of the DB itself. The iterator keeps the
+	// snapshot alive and never goes out of date, so it can be used from any thread. Only the snapshot's component (and
+	// the entity ids) can be read, and the returned views must be treated as read-only. Invalid if Snapshot is null.
+	explicit FMantleIterator(TSharedPtr<const FMantleComponentSnapshot, ESPMode::ThreadSafe> NewSnapshot);
+
+	// Use a const ViewType (e.g. GetArrayView<const FMC_Health>()) when only reading. Non-const views mark the chunk's
+	// column as changed, which makes published snapshots of that component copy the chunk again.
 	template <typename ViewType>
 	TArrayView<ViewType> GetArrayView()
 	{
 		return GetArrayViewInternal<ViewType>(EntryIndex, ChunkIndex);
 	}
 
+	// Like GetArrayView(), but for components the query doesn't require. Returns an empty view if the chunk at the
+	// CURRENT INDEX doesn't have this component.
+	template <typename ViewType>
+	TArrayView<ViewType> GetOptionalArrayView()
+	{
+		if (!IsValid() || !LocalCache.MatchingEntries.IsValidIndex(EntryIndex))
+		{
+			return TArrayView<ViewType>();
+		}
+		if (!LocalCache.MatchingEntries[EntryIndex].ChunkedComponents.Contains(std::remove_const_t<ViewType>::StaticStruct()->GetName()))
+		{
+			return TArrayView<ViewType>();
+		}
+		
+		return GetArrayView<ViewType>();
+	}
+
 	// NOTE: This gets the entities at the CURRENT INDEX.
 	TArrayView<FGuid> GetEntities();
+
+	// The id of the DB chunk at the CURRENT INDEX.
+	FGuid GetChunkId();
+
+	// The FMantleDBChunkHeader::EntitiesVersion of the chunk at the CURRENT INDEX. Changes whenever entities are added
+	// to or removed from the chunk. Always 0 for snapshots.
+	uint32 GetChunkEntitiesVersion();
+
+	// Moves straight to the chunk that holds Entity, without walking the chunks before it. Returns false (and leaves
+	// the iterator where it was) if that chunk isn't part of these results.
+	bool MoveToChunk(const FMantleEntity& Entity);
+
+	// The version of the query results this iterator was created from. See UMantleDB::QueryIsUnchanged().
+	const FMantleDBVersion& GetVersion() const
+	{
+		return LocalCache.Version;
+	}
+	
 	bool Next();
 	void Reset();
 	bool IsValid();
@@ -106,6 +155,7 @@ private:
 	friend FMantleDBChunk;
 	friend TestSuite;
 	friend UMantleDB;
+	template<typename... TArgs> friend struct TMantleQuery;
 
 	template <typename ViewType>
 	TArrayView<ViewType> GetArrayViewInternal(int32 TargetEntryIndex, int32 TargetChunkIndex)
@@ -125,10 +175,16 @@ private:
 			return TArrayView<ViewType>();
 		}
 
-		const UScriptStruct* ComponentType = ViewType::StaticStruct();
+		const UScriptStruct* ComponentType = std::remove_const_t<ViewType>::StaticStruct();
 		const FString ComponentName = ComponentType->GetName();
+		if (!Snapshot.IsValid())
+		{
+			// Snapshots are copies, so reading them doesn't need to be declared.
+			MANTLE_CHECK_COMPONENT_ACCESS(ComponentName, !std::is_const_v<ViewType>);
+		}
 		
-		TArray<FAnankeUntypedArrayView>* Chunks = LocalCache.MatchingEntries[TargetEntryIndex].ChunkedComponents.Find(ComponentName);
+		FMantleCachedEntry& Entry = LocalCache.MatchingEntries[TargetEntryIndex];
+		TArray<FAnankeUntypedArrayView>* Chunks = Entry.ChunkedComponents.Find(ComponentName);
 		if (!Chunks)
 		{
 			UE_LOG(LogMantle, Error, TEXT("Chunks for component %s are missing."), *ComponentName);
@@ -144,7 +200,12 @@ private:
 			return TArrayView<ViewType>();
 		}
 
-		return (*Chunks)[TargetChunkIndex].GetArrayView<ViewType>();
+		if constexpr (!std::is_const_v<ViewType>)
+		{
+			Entry.MarkColumnChanged(ComponentName, TargetChunkIndex);
+		}
+
+		return (*Chunks)[TargetChunkIndex].GetArrayView<std::remove_const_t<ViewType>>();
 	}
 	
 	int32 EntryIndex = -1;
@@ -154,4 +215,166 @@ private:
 
 	// TODO(): Consider storing a weakptr to the MantleDB instead.
 	FMantleDBMasterRecord* MasterRecord = nullptr;
-};
\ No newline at end of file
+
+	// Set if this iterates a published snapshot rather than the DB.
+	TSharedPtr<const FMantleComponentSnapshot, ESPMode::ThreadSafe> Snapshot;
+};
+
+/**
+ *  Statically typed query. Each argument is a reference to a component type; const references are read-only, non-const
+ *  references may be written to. Component columns are looked up once per archetype instead of once per chunk.
+ *
+ *  Example:
+ *    TMantleQuery<const FMC_Viewpoint&, FMC_ViewpointTrace&> TraceQuery;
+ *    TraceQuery.ForEach(*Ctx.MantleDB, [](const FMC_Viewpoint& Viewpoint, FMC_ViewpointTrace& Trace) { ... });
+ */
+template<typename... TArgs>
+struct TMantleQuery
+{
+	static_assert(sizeof...(TArgs) > 0, "TMantleQuery requires at least one component type.");
+	static_assert((std::is_reference_v<TArgs> && ...), "TMantleQuery arguments must be references (const FMC_A& or FMC_A&).");
+	
+public:
+	TMantleQuery()
+	{
+		(Query.AddRequiredComponent<std::decay_t<TArgs>>(), ...);
+		ComponentNames = { std::decay_t<TArgs>::StaticStruct()->GetName()... };
+	}
+
+	// Adds a read for each const argument and a write for each non-const argument.
+	void DeclareAccess(FMantleComponentAccess& Access) const
+	{
+		(DeclareAccessFor<TArgs>(Access), ...);
+	}
+
+	FMantleComponentQuery& GetComponentQuery()
+	{
+		return Query;
+	}
+
+	// Func signature: (int32 NumEntities, const FGuid* EntityIds, TArgs* Columns...), where each column is a pointer to the
+	// first component of that type in the chunk.
+	template<typename TFunc>
+	void ForEachChunk(UMantleDB& DB, TFunc&& Func)
+	{
+		FMantleIterator Iterator = DB.RunQuery(Query);
+		ForEachChunk(Iterator, Func);
+	}
+
+	template<typename TFunc>
+	void ForEachChunk(FMantleIterator& Iterator, TFunc&& Func)
+	{
+		if (!Iterator.IsValid())
+		{
+			ANANKE_LOG_PERIODIC(Error, TEXT("Invalid Iterator."), 1.0);
+			return;
+		}
+
+		if (!Iterator.Snapshot.IsValid())
+		{
+			CheckAccess(std::index_sequence_for<TArgs...>());
+		}
+
+		ForEachChunkInternal(Iterator, Func, std::index_sequence_for<TArgs...>());
+	}
+
+	// Func signature: (TArgs... Components) or (const FGuid& EntityId, TArgs... Components).
+	template<typename TFunc>
+	void ForEach(UMantleDB& DB, TFunc&& Func)
+	{
+		ForEachChunk(DB, [&Func](int32 NumEntities, const FGuid* RESTRICT EntityIds, std::remove_reference_t<TArgs>* RESTRICT... Columns)
+		{
+			for (int32 EntityIndex = 0; EntityIndex < NumEntities; ++EntityIndex)
+			{
+				if constexpr (std::is_invocable_v<TFunc&, const FGuid&, TArgs...>)
+				{
+					Func(EntityIds[EntityIndex], Columns[EntityIndex]...);
+				}
+				else
+				{
+					Func(Columns[EntityIndex]...);
+				}
+			}
+		});
+	}
+
+private:
+	template<typename TArg>
+	static void DeclareAccessFor(FMantleComponentAccess& Access)
+	{
+		if constexpr (std::is_const_v<std::remove_reference_t<TArg>>)
+		{
+			Access.AddRead<std::decay_t<TArg>>();
+		}
+		else
+		{
+			Access.AddWrite<std::decay_t<TArg>>();
+		}
+	}
+
+	template<size_t... Indices>
+	void CheckAccess(std::index_sequence<Indices...>) const
+	{
+#if MANTLE_WITH_ACCESS_CHECKS
+		(MANTLE_CHECK_COMPONENT_ACCESS(ComponentNames[Indices], !std::is_const_v<std::remove_reference_t<TArgs>>), ...);
+#endif
+	}
+
+	template<typename TArg>
+	static void MarkColumnChanged(FMantleCachedEntry& Entry, const FString& ComponentName, int32 ChunkIndex)
+	{
+		if constexpr (!std::is_const_v<std::remove_reference_t<TArg>>)
+		{
+			Entry.MarkColumnChanged(ComponentName, ChunkIndex);
+		}
+	}
+
+	template<typename TArg>
+	static std::remove_reference_t<TArg>* GetColumn(FAnankeUntypedArrayView& ChunkView)
+	{
+		return ChunkView.GetArrayView<std::decay_t<TArg>>().GetData();
+	}
+	
+	template<typename TFunc, size_t... Indices>
+	void ForEachChunkInternal(FMantleIterator& Iterator, TFunc& Func, std::index_sequence<Indices...>)
+	{
+		for (FMantleCachedEntry& Entry : Iterator.LocalCache.MatchingEntries)
+		{
+			if (Entry.NumChunks() == 0)
+			{
+				continue;
+			}
+			
+			TArray<FAnankeUntypedArrayView>* Columns[] = { Entry.ChunkedComponents.Find(ComponentNames[Indices])... };
+
+			bool bHasAllColumns = true;
+			for (TArray<FAnankeUntypedArrayView>* Column : Columns)
+			{
+				if (!Column || Column->Num() != Entry.NumChunks())
+				{
+					bHasAllColumns = false;
+				}
+			}
+			if (!bHasAllColumns)
+			{
+				UE_LOG(LogMantle, Error, TEXT("TMantleQuery: Malformed cached entry."));
+				continue;
+			}
+
+			for (int32 ChunkIndex = 0; ChunkIndex < Entry.NumChunks(); ++ChunkIndex)
+			{
+				TArrayView<FGuid> EntityIds = Entry.ChunkedEntityIds[ChunkIndex];
+				if (EntityIds.Num() == 0)
+				{
+					continue;
+				}
+				
+				(MarkColumnChanged<TArgs>(Entry, ComponentNames[Indices], ChunkIndex), ...);
+				Func(EntityIds.Num(), EntityIds.GetData(), GetColumn<TArgs>((*Columns[Indices])[ChunkIndex])...);
+			}
+		}
+	}
+	
+	FMantleComponentQuery Query;
+	TArray<FString> ComponentNames;
+};
@@ -0,0 +1,107 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Containers/ArrayView.h"
+#include "Containers/Map.h"
+#include "MantleComponentAccess.h"
+#include "Misc/Guid.h"
+
+// Lets the DB own side tables, and drop the entries for removed entities, without knowing their value type.
+class MANTLERUNTIME_API FMantleSideTableBase
+{
+public:
+	virtual ~FMantleSideTableBase() = default;
+
+	virtual void RemoveEntities(TConstArrayView<FGuid> EntityIds) = 0;
+};
+
+/**
+ *  Sparse per-entity data that lives outside of the chunks. Intended for data that only a small fraction of entities
+ *  ever have (callbacks, debug info, etc), where even a separate component would waste space on every entity in the
+ *  archetype. Entries are removed automatically when their entity is removed from the DB.
+ *
+ *  Adding or removing entries counts as a structural change, so it must not happen while operations are running
+ *  concurrently (operations that do it without declaring structural changes are reported, see FMantleAccessChecker).
+ *  Lookups are safe from any thread.
+ */
+template<typename ValueType>
+class TMantleSideTable final : public FMantleSideTableBase
+{
+public:
+	ValueType& FindOrAdd(const FGuid& EntityId)
+	{
+		if (ValueType* Existing = Values.Find(EntityId))
+		{
+			return *Existing;
+		}
+
+		MANTLE_CHECK_STRUCTURAL_CHANGE();
+		return Values.Add(EntityId);
+	}
+
+	ValueType* Find(const FGuid& EntityId)
+	{
+		return Values.Find(EntityId);
+	}
+	
+	const ValueType* Find(const FGuid& EntityId) const
+	{
+		return Values.Find(EntityId);
+	}
+
+	void Remove(const FGuid& EntityId)
+	{
+		MANTLE_CHECK_STRUCTURAL_CHANGE();
+		Values.Remove(EntityId);
+	}
+
+	int32 Num() const
+	{
+		return Values.Num();
+	}
+
+	virtual void RemoveEntities(TConstArrayView<FGuid> EntityIds) override
+	{
+		if (Values.IsEmpty())
+		{
+			return;
+		}
+		
+		for (const FGuid& EntityId : EntityIds)
+		{
+			Values.Remove(EntityId);
+		}
+	}
+
+private:
+	TMap<FGuid, ValueType> Values;
+};
@@ -34,13 +34,12 @@
 #include "MantleTypes.generated.h"
 
 // Is it safe to add a container type (TArray, TMap, etc) to FMantleComponent?
-//   -> Currently, I think NO, it would result in a memory leak. Basically what I think happens is when you add an entity
-//      to the DB (see FMantleDBChunk::AddEntities), it creates a deep copy of the struct, including any TArray, TMap,
-//      etc (see ComponentInstance.GetScriptStruct()->CopyScriptStruct, FArrayProperty::CopyValuesInternal). However,
-//      when the entity is destroyed, we currently do not call the destructor on each component struct. So any memory
-//      that got allocated during the copy (array data for example), get leaked.
-//
-//		TODO(): To fix, need to fetch the script struct and call ScriptStruct->DestroyStruct(DataPtr) (see FMassArchetypeData::RemoveEntity for example)
+//   -> Yes. When you add an entity to the DB (see FMantleDBChunk::AddEntities), it creates a deep copy of the struct,
+//      including any TArray, TMap, etc (see ComponentInstance.GetScriptStruct()->CopyScriptStruct). Components are
+//      destroyed (ScriptStruct->DestroyStruct) when their entity is removed, when they are stripped from an entity, and
+//      when their chunk is destroyed. Note that components are moved between chunks with a memcpy, so component types
+//      must be trivially relocatable (which is true of almost all UE types). For small lists, prefer
+//      TMantleInlineBuffer, which keeps its first few elements inside the chunk.
 //
 // Do mantle components respect GC?
 //   -> No. So basically there is no point in using the UPROPERTY() tag on an FMantleComponent, and furthermore it is
@@ -44,6 +44,8 @@ class MANTLERUNTIME_API UMantleEntityLibrary : public UBlueprintFunctionLibrary
 	GENERATED_BODY()
 
 public:
+	// These are safe to call while an async engine loop is running, in which case the change is queued and made at the
+	// start of the engine's next game thread loop (see UMantleDB::ExecuteOrQueue). SetEntityAvatar() then returns true.
 	static bool SetEntityAvatar(
 		TObjectPtr<UMantleDB> MantleDB,
 		FGuid EntityId,
@@ -50,12 +50,50 @@ enum class EMantleEffectType: uint8
 	Ongoing
 };
 
+// Optional callbacks for an effect. Almost no effects bind these, so rather than being a component they live in a DB
+// side table (see TMantleSideTable), and only effects that have FEP_EffectMetadata::bHasCallbacks set have an entry.
+USTRUCT()
+struct MANTLERUNTIME_API FEP_EffectCallbacks
+{
+	GENERATED_BODY()
+
+public:
+	// Returns the callbacks for an effect that has already been added to the DB, creating them if needed. Creating them is
+	// a structural change, so it can't be done while operations are running concurrently (or an async loop is running).
+	// The returned pointer is only valid until the next time callbacks are bound.
+	static FEP_EffectCallbacks* Bind(UMantleDB& MantleDB, const FGuid& EffectId);
+	
+	// Called when the effect has been canceled.
+	FEP_EffectMetadata_Canceled OnCanceled;
+
+	// Called every time the effect successfully executes
+	FEP_EffectMetadata_Executed OnExecuted;
+
+	// Called when the effect is "finished" (only for MantleEffectType::Limited).
+	FEP_EffectMetadata_Finished OnFinished;
+};
+
+// Written by FEP_EffectMetadata::RequestCancel(), so that executors can cancel the effect right away instead of waiting
+// until it is next due to trigger.
+USTRUCT()
+struct MANTLERUNTIME_API FEP_EffectCancelRequest
+{
+	GENERATED_BODY()
+
+public:
+	FGuid EffectId;
+};
+
 USTRUCT()
 struct MANTLERUNTIME_API FEP_EffectMetadata : public FMantleComponent
 {
 	GENERATED_BODY()
 
 public:
+	// Cancels an effect that has already been added to the DB. Its executor picks up the request the next time it runs
+	// after the event channels are swapped. Returns false if the entity isn't an effect.
+	static bool RequestCancel(UMantleDB& MantleDB, const FGuid& EffectId);
+	
 	static FEP_EffectMetadata MakeOneTimeEffect()
 	{
 		// For now, one-time effect is the default.
@@ -66,6 +104,7 @@ public:
 	static FEP_EffectMetadata MakeRecurringEffect(double InTriggerRateSec, int32 NumTriggers = -1)
 	{
 		FEP_EffectMetadata NewEffect;
+		NewEffect.TriggerRateSec = InTriggerRateSec;
 		
 		if (NumTriggers > 0)
 		{
@@ -87,20 +126,44 @@ public:
 
 	// How many times this effect can fail before it is canceled.
 	int32 MaxFailures = 0;
-
-	// Called when the effect has been canceled.
-	FEP_EffectMetadata_Canceled OnCanceled;
-
-	// Called every time the effect successfully executes
-	FEP_EffectMetadata_Executed OnExecuted;
-
-	// Called when the effect is "finished" (only for MantleEffectType::Limited).
-	FEP_EffectMetadata_Finished OnFinished;
 	
 	// Instance data --------------------------------------------------------------------------------------------------
 	double LastTimeTriggered = 0.0;
 	int32 NumFailures = 0;
 
+	// Set if the effect has an entry in the FEP_EffectCallbacks side table (see FEP_EffectCallbacks::Bind).
+	bool bHasCallbacks = false;
+
 	// Event data -----------------------------------------------------------------------------------------------------
+	// Set by RequestCancel(). If this is set directly instead, the cancellation is processed the next time the effect is
+	// due to trigger.
 	bool CancelRequested = false;
 };
+
+inline FEP_EffectCallbacks* FEP_EffectCallbacks::Bind(UMantleDB& MantleDB, const FGuid& EffectId)
+{
+	FEP_EffectMetadata* EffectMetadata = MantleDB.GetComponent<FEP_EffectMetadata>(EffectId);
+	if (!EffectMetadata)
+	{
+		return nullptr;
+	}
+
+	EffectMetadata->bHasCallbacks = true;
+	return &MantleDB.GetSideTable<FEP_EffectCallbacks>().FindOrAdd(EffectId);
+}
+
+inline bool FEP_EffectMetadata::RequestCancel(UMantleDB& MantleDB, const FGuid& EffectId)
+{
+	FEP_EffectMetadata* EffectMetadata = MantleDB.GetComponent<FEP_EffectMetadata>(EffectId);
+	if (!EffectMetadata)
+	{
+		return false;
+	}
+
+	EffectMetadata->CancelRequested = true;
+
+	FEP_EffectCancelRequest CancelRequest;
+	CancelRequest.EffectId = EffectId;
+	MantleDB.GetEventChannel<FEP_EffectCancelRequest>().Write(CancelRequest);
+	return true;
+}
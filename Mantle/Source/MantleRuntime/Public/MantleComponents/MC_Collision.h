@@ -30,6 +30,7 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include "Foundation/MantleInlineBuffer.h"
 #include "Foundation/MantleTypes.h"
 
 #include "MC_Collision.generated.h"
@@ -41,6 +42,7 @@ struct MANTLERUNTIME_API FMC_Collision : public FMantleComponent
 	GENERATED_BODY()
 
 public:
-	// This field will be emptied at the end of each frame.
-	TArray<FGuid> Entities;
+	// This field will be emptied at the end of each frame. Most projectiles hit only a few entities before they are
+	// destroyed, so a handful of ids are stored inline.
+	TMantleInlineBuffer<FGuid, 4> Entities;
 };
@@ -34,11 +34,69 @@
 #include "Foundation/MantleDB.h"
 #include "Foundation/MantleTypes.h"
 #include "Math/UnrealMathUtility.h"
+#include "Misc/Guid.h"
+#include "UObject/NameTypes.h"
 
 #include "MC_Health.generated.h"
 
-// TODO(): Consider making this a MULTICAST_DELEGATE since it isn't currently bound to using BP.
-DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FMC_Health_HealthChangedEvent, float, OldVal, float, NewVal);
+UENUM()
+enum class EMC_HealthValue : uint8
+{
+	Health,
+	MaxHealth
+};
+
+/**
+ *  Records a change to an entity's FMC_Health. Changes are written to the FMC_HealthChangeEvent event channel (see
+ *  UMantleDB::GetEventChannel) by whatever modified the health, so listeners can handle a whole frame's worth of
+ *  changes at once instead of being called back for each entity.
+ */
+USTRUCT()
+struct MANTLERUNTIME_API FMC_HealthChangeEvent
+{
+	GENERATED_BODY()
+
+public:
+	FGuid Entity;
+	EMC_HealthValue ChangedValue = EMC_HealthValue::Health;
+	float OldValue = 0.0f;
+	float NewValue = 0.0f;
+};
+
+UENUM()
+enum class EMC_HealthStacking : uint8
+{
+	// Summed with every other additive modification to the same target.
+	Additive,
+
+	// Only the largest modification (by magnitude) with the same target and StackingGroup is applied.
+	Highest
+};
+
+/**
+ *  A pending change to an entity's health. Modifications are written to the FMC_HealthModification event channel (see
+ *  UMantleDB::GetEventChannel), and UMO_HealthAccumulation combines all of the modifications for a target into a single
+ *  update of its FMC_Health.
+ */
+USTRUCT()
+struct MANTLERUNTIME_API FMC_HealthModification
+{
+	GENERATED_BODY()
+
+public:
+	FMC_HealthModification() = default;
+	FMC_HealthModification(const FGuid& NewTarget, float NewAmount): TargetEntity(NewTarget), Amount(NewAmount) { }
+	
+	FGuid TargetEntity;
+
+	// Positive values heal the target, negative values damage it.
+	float Amount = 0.0f;
+	
+	EMC_HealthStacking Stacking = EMC_HealthStacking::Additive;
+
+	// Only used by EMC_HealthStacking::Highest.
+	FName StackingGroup;
+};
 
 USTRUCT(BlueprintType)
 struct MANTLERUNTIME_API FMC_Health : public FMantleComponent
@@ -61,31 +119,35 @@ public:
 	{
 		return MaxHealth;
 	}
-	
-	void ApplyHealing(float Amount)
+
+	// The mutators below return true if the value changed. If so, OutChange (if not null) is filled in with the old and
+	// new values. The caller is expected to set OutChange->Entity and write it to the FMC_HealthChangeEvent channel,
+	// ideally along with the rest of its changes in a single write.
+	bool ApplyHealing(float Amount, FMC_HealthChangeEvent* OutChange = nullptr)
 	{
-		UpdateHealth(FMath::Abs(Amount));
+		return UpdateHealth(FMath::Abs(Amount), OutChange);
 	}
-	void ApplyDamage(float Amount)
+	bool ApplyDamage(float Amount, FMC_HealthChangeEvent* OutChange = nullptr)
 	{
-		UpdateHealth(FMath::Abs(Amount) * -1);
+		return UpdateHealth(FMath::Abs(Amount) * -1, OutChange);
 	}
-	void SetHealth(float NewHealth)
+	bool SetHealth(float NewHealth, FMC_HealthChangeEvent* OutChange = nullptr)
 	{
 		if (Health == NewHealth)
 		{
-			return;	
+			return false;	
 		}
 
 		float OldHealth = Health;
 		Health = NewHealth;
-		OnHealthChanged.Broadcast(OldHealth, Health);
+		RecordChange(EMC_HealthValue::Health, OldHealth, Health, OutChange);
+		return true;
 	}
-	void SetMaxHealth(FAnankeDynamicValue NewMaxHealth)
+	bool SetMaxHealth(FAnankeDynamicValue NewMaxHealth, FMC_HealthChangeEvent* OutChange = nullptr)
 	{
 		if (NewMaxHealth == MaxHealth)
 		{
-			return;
+			return false;
 		}
 
 		float OldValue = MaxHealth.Value();
@@ -95,27 +157,40 @@ public:
 		// We still have to check the values here because the dynamic value could have updated, but the result value
 		// could stay the same. For example, if the old dynamic value is {(10 * 1) + 5} and the new value is
 		// {(10 * 2) - 5}.
-		if (OldValue != NewValue)
+		if (OldValue == NewValue)
 		{
-			OnMaxHealthChanged.Broadcast(OldValue, NewValue);	
+			return false;
 		}
+		
+		RecordChange(EMC_HealthValue::MaxHealth, OldValue, NewValue, OutChange);
+		return true;
 	}
 
-	FMC_Health_HealthChangedEvent OnHealthChanged;
-	FMC_Health_HealthChangedEvent OnMaxHealthChanged;
-
 private:
 	float Health = 0.0f;
 	FAnankeDynamicValue MaxHealth;
 	
-	void UpdateHealth(float Amount)
+	bool UpdateHealth(float Amount, FMC_HealthChangeEvent* OutChange)
 	{
 		float OldHealth = Health;
 		Health = FMath::Clamp(Health + Amount, 0, MaxHealth.Value());
 
-		if (Health != OldHealth)
+		if (Health == OldHealth)
+		{
+			return false;
+		}
+		
+		RecordChange(EMC_HealthValue::Health, OldHealth, Health, OutChange);
+		return true;
+	}
+
+	static void RecordChange(EMC_HealthValue ChangedValue, float OldValue, float NewValue, FMC_HealthChangeEvent* OutChange)
+	{
+		if (OutChange)
 		{
-			OnHealthChanged.Broadcast(OldHealth, Health);
+			OutChange->ChangedValue = ChangedValue;
+			OutChange->OldValue = OldValue;
+			OutChange->NewValue = NewValue;
 		}
 	}
 };
@@ -36,8 +36,9 @@
 #include "MC_PerceptionEvent.generated.h"
 
 /**
- *  Indicates that an entity is perceiving another entity in some way. Additional components add context. For example,
- *  an entity with this component + the MC_ViewpointTraceEvent component is produced when the ViewpointTrace operation
+ *  Indicates that an entity is perceiving another entity in some way. These are normally read from the
+ *  FMC_PerceptionEvent event channel. When emitted as entities, additional components add context. For example, an
+ *  entity with this component + the MC_ViewpointTraceEvent component is produced when the ViewpointTrace operation
  *  performs a line trace from an entity's "viewpoint".
  */
 USTRUCT()
@@ -65,6 +66,9 @@ public:
 
 	// If true, this was a 'blocking' hit. Otherwise this was an overlap.
 	bool bBlockingHit = false;
+
+	// If true, the source entity is controlled by a player. Otherwise it is controlled by AI.
+	bool bIsPlayerPerception = false;
 };
 
 /**
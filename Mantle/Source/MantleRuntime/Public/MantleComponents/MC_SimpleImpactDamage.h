@@ -31,6 +31,8 @@
 
 #pragma once
 #include "Foundation/MantleTypes.h"
+#include "MantleComponents/MC_Health.h"
+#include "UObject/NameTypes.h"
 
 #include "MC_SimpleImpactDamage.generated.h"
 
@@ -48,4 +50,8 @@ public:
 	
 	float DamageAmount = 0.0f;
 	bool IgnoreOwner = true;
+
+	// How the damage combines with other hits on the same target in the same frame (see FMC_HealthModification).
+	EMC_HealthStacking Stacking = EMC_HealthStacking::Additive;
+	FName StackingGroup;
 };
@@ -36,6 +36,16 @@
 
 #include "MC_Viewpoint.generated.h"
 
+UENUM()
+enum class EMantleViewpointUpdateMode : uint8
+{
+	// The viewpoint collector reads the source controller every time it runs.
+	Poll,
+
+	// Viewpoint changes are published to the viewpoint collector (see UMantleViewpointPublisherComponent).
+	Push
+};
+
 /**
  *  Holds data about the location and direction of an entity's "eyes".
  */
@@ -52,22 +62,45 @@ public:
 	}
 	
 	void SetViewpointSourceController(AController* NewSource) { ViewpointSource = NewSource; }
-	AController* GetViewpointSourceController() { return ViewpointSource.IsValid() ? ViewpointSource.Get() : nullptr; }
+	AController* GetViewpointSourceController() const
+	{
+		return ViewpointSource.IsValid() ? ViewpointSource.Get() : nullptr;
+	}
 
-	bool IsValid()
+	bool IsValid() const
 	{
 		return ViewpointSource.IsValid();
 	}
 	
-	bool IsPlayerViewpoint()
+	bool IsPlayerViewpoint() const
 	{
 		return ViewpointSource.IsValid() && ViewpointSource->IsA<APlayerController>();
 	}
 	
+	// Returns true if the location or rotation was actually changed.
+	bool SetView(const FVector& NewLocation, const FRotator& NewRotation)
+	{
+		if (NewLocation == Location && NewRotation == Rotation)
+		{
+			return false;
+		}
+
+		Location = NewLocation;
+		Rotation = NewRotation;
+		++ChangeVersion;
+		return true;
+	}
+	
 	FVector Location = FVector::ZeroVector;
 	FRotator Rotation = FRotator::ZeroRotator;
 	double LastTimeProcessedSec = 0.0;
 
+	EMantleViewpointUpdateMode UpdateMode = EMantleViewpointUpdateMode::Poll;
+
+	// Incremented whenever Location or Rotation changes. Operations can compare this against a value they stored
+	// earlier to skip work for viewpoints that haven't moved.
+	uint32 ChangeVersion = 0;
+
 protected:
 	// The controller to retrieve data from.
 	UPROPERTY()
@@ -32,6 +32,7 @@
 #pragma once
 #include "Containers/EnumAsByte.h"
 #include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
 #include "Foundation/MantleTypes.h"
 #include "MantleComponents/MC_PerceptionEvent.h"
 
@@ -86,5 +87,27 @@ public:
 	EOverlapEmission OverlapRule = EOverlapEmission::None;
 	EBlockingHitEmission BlockingHitRule = EBlockingHitEmission::Delta;
 	bool bDrawDebugGeometry = false;
-	double MaxViewpointDataAgeSec = 0.5; // 500 ms
+	double MaxViewpointDataAgeSec = 0.5; // 500 ms. Not checked for pushed viewpoints, which only update on change.
+
+	// If true, traces are submitted with AsyncLineTraceByChannel and their results are processed on the operation's next
+	// run. This moves trace cost off the game thread at the cost of one frame of latency.
+	bool bAsyncTrace = false;
+
+	// Async trace state
+	FTraceHandle PendingTraceHandle;
+	FVector PendingTraceEnd = FVector::ZeroVector;
+
+	// Motion coherence options. If enabled, a scan is skipped when the viewpoint has moved less than the thresholds
+	// since the last trace and the last blocking hit target still exists. A trace is always performed at least once
+	// every CoherenceMaxIntervalSec. Only applies when OverlapRule is None, since overlaps are not cached.
+	bool bSkipCoherentTraces = false;
+	float CoherenceLocationThreshold = 5.0f;
+	float CoherenceRotationThresholdDeg = 1.0f;
+	double CoherenceMaxIntervalSec = 0.5;
+
+	// Motion coherence state
+	FVector LastTraceLocation = FVector::ZeroVector;
+	FRotator LastTraceRotation = FRotator::ZeroRotator;
+	double LastTraceTimeSec = 0.0;
+	uint32 LastTraceViewpointVersion = 0;
 };
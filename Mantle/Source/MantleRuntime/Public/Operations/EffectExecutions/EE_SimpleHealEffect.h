@@ -46,8 +46,15 @@ public:
 	UEE_SimpleHealEffect(const FObjectInitializer& Initializer);
 	
 	virtual void LoadEffectPayloads(FMantleIterator& Iterator) override;
-	virtual FMantleEffectExecutionResult Execute(FMantleOperationContext& Ctx, int32 EffectIndex, bool CancelRequested) override;
+	virtual void ClearEffectPayloads() override;
+	virtual void GetEffectTargets(int32 PayloadChunk, TArrayView<FMantleEffectInvocation> Invocations) override;
+	virtual void ExecuteBatch(
+		FMantleOperationContext& Ctx,
+		TConstArrayView<FMantleEffectInvocation> Invocations,
+		TArrayView<FMantleEffectExecutionResult> OutResults
+	) override;
 
 protected:
-	TArrayView<FEP_SimpleHealEffect> EffectData;
+	// [PayloadChunk][EffectIndex]
+	TArray<TArrayView<const FEP_SimpleHealEffect>> EffectData;
 };
\ No newline at end of file
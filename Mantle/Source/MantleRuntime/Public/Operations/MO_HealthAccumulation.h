@@ -0,0 +1,62 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Foundation/MantleEventChannel.h"
+#include "Foundation/MantleOperation.h"
+
+#include "MO_HealthAccumulation.generated.h"
+
+/**
+ * HealthAccumulation Mantle operation. Applies the health modifications that were written to the
+ * FMC_HealthModification event channel during the previous frame.
+ *
+ * The modifications are combined per target before they are applied, so each target's MC_Health is looked up and
+ * updated once per frame no matter how many times it was hit. Additive modifications are summed, and for each
+ * StackingGroup only the largest Highest modification is kept. The resulting changes are written to the
+ * FMC_HealthChangeEvent event channel.
+ *
+ * Input Entity Composition (targets):
+ *   + MC_Health
+ */
+UCLASS()
+class MANTLERUNTIME_API UMO_HealthAccumulation : public UMantleOperation
+{
+	GENERATED_BODY()
+
+public:
+	UMO_HealthAccumulation(const FObjectInitializer& Initializer);
+
+protected:
+	virtual void PerformOperation(FMantleOperationContext& Ctx) override;
+
+	FMantleEventCursor ModificationCursor;
+};
@@ -32,12 +32,29 @@
 #pragma once
 #include "Foundation/MantleOperation.h"
 #include "Foundation/MantleQueries.h"
+#include "MantleComponents/MC_Collision.h"
+#include "MantleComponents/MC_Owner.h"
+#include "MantleComponents/MC_SimpleImpactDamage.h"
 #include "UObject/UObjectGlobals.h"
 
 #include "MO_ImpactDamage.generated.h"
 
-struct FEP_SimpleDamageEffect;
+struct FMC_HealthModification;
 
+/**
+ * ImpactDamage Mantle operation. Damages every entity that collided with an entity that has MC_SimpleImpactDamage.
+ *
+ * By default each hit is emitted as its own FEP_SimpleDamageEffect entity, to be applied by UEE_SimpleDamageEffect. If
+ * bEmitDamageEffects is cleared, each hit is instead written to the FMC_HealthModification event channel, and
+ * UMO_HealthAccumulation (which must then be registered as well) combines all of the hits on a target into a single
+ * health update. Damage effects are added through a deferred command, so they exist once the engine loop has played back
+ * its commands.
+ *
+ * Input Entity Composition:
+ *   + MC_Collision
+ *   + MC_SimpleImpactDamage
+ *   + MC_Owner
+ */
 UCLASS()
 class MANTLERUNTIME_API UMO_ImpactDamage : public UMantleOperation
 {
@@ -45,11 +62,13 @@ class MANTLERUNTIME_API UMO_ImpactDamage : public UMantleOperation
 
 public:
 	UMO_ImpactDamage(const FObjectInitializer& Initializer);
-	
+
+	bool bEmitDamageEffects = true;
+
 	virtual void PerformOperation(FMantleOperationContext& Ctx) override;
 
 protected:
-	void EmitDamageEffects(FMantleOperationContext& Ctx, TArray<FEP_SimpleDamageEffect>& Effects);
+	static void EmitDamageEffects(UMantleDB& MantleDB, TConstArrayView<FMC_HealthModification> Hits);
 	
-	FMantleComponentQuery SimpleImpactQuery;
+	TMantleQuery<FMC_Collision&, const FMC_SimpleImpactDamage&, const FMC_Owner&> SimpleImpactQuery;
 };
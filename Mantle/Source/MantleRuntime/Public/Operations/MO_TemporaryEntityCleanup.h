@@ -32,6 +32,7 @@
 #pragma once
 #include "Foundation/MantleOperation.h"
 #include "Foundation/MantleQueries.h"
+#include "MantleComponents/MC_TemporaryEntity.h"
 
 #include "MO_TemporaryEntityCleanup.generated.h"
 
@@ -52,5 +53,5 @@ public:
 protected:
 	virtual void PerformOperation(FMantleOperationContext& Ctx) override;
 	
-	FMantleComponentQuery Query;
+	TMantleQuery<const FMC_TemporaryEntity&> Query;
 };
@@ -30,11 +30,28 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include "Containers/MpscQueue.h"
 #include "Foundation/MantleOperation.h"
 #include "Foundation/MantleQueries.h"
+#include "MantleComponents/MC_Viewpoint.h"
 
 #include "MO_ViewpointCollector.generated.h"
 
+struct FMantleViewpointUpdate
+{
+	FGuid EntityId;
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+};
+
+/**
+ *  Keeps FMC_Viewpoint components up to date.
+ *
+ *  Viewpoints in Poll mode are read from their source controller every run. Controllers can only be read on the game
+ *  thread, so this happens in a deferred command, and the new values are visible once the engine loop has played back
+ *  its commands. Viewpoints in Push mode are only updated when a new value is published through PublishViewpoint(),
+ *  which may be called from any thread.
+ */
 UCLASS()
 class MANTLERUNTIME_API UMO_ViewpointCollector : public UMantleOperation
 {
@@ -42,9 +59,30 @@ class MANTLERUNTIME_API UMO_ViewpointCollector : public UMantleOperation
 
 public:
 	UMO_ViewpointCollector(const FObjectInitializer& Initializer);
+
+	void PublishViewpoint(FGuid EntityId, const FVector& Location, const FRotator& Rotation);
+
+	// Polled viewpoints that haven't moved still get their LastTimeProcessedSec refreshed this often, so traces don't
+	// treat them as stale. Keep it below the traces' MaxViewpointDataAgeSec.
+	double TimestampRefreshIntervalSec = 0.25;
 	
 protected:
 	virtual void PerformOperation(FMantleOperationContext& Ctx) override;
 
-	FMantleComponentQuery Query;
+	// Game thread only.
+	void PollViewpoints(UMantleDB& MantleDB, double CurrentTimeSec);
+
+	// Applies each update to its entity's viewpoint if the viewpoint is in UpdateMode.
+	void ApplyViewpointUpdates(
+		UMantleDB& MantleDB,
+		TConstArrayView<FMantleViewpointUpdate> Updates,
+		EMantleViewpointUpdateMode UpdateMode,
+		double CurrentTimeSec
+	);
+
+	TMantleQuery<const FMC_Viewpoint&> Query;
+
+	TMpscQueue<FMantleViewpointUpdate> PublishedUpdates;
+	TArray<FMantleViewpointUpdate> StagedUpdates;
+	TArray<FMantleViewpointUpdate> PolledUpdates;
 };
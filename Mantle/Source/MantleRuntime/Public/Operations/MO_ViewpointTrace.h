@@ -30,11 +30,13 @@
 // ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
+#include "CollisionQueryParams.h"
 #include "Containers/Array.h"
 #include "Foundation/MantleOperation.h"
 #include "Foundation/MantleQueries.h"
 #include "InstancedStruct.h"
 #include "Math/Color.h"
+#include "Engine/HitResult.h"
 #include "Misc/Guid.h"
 
 #include "MO_ViewpointTrace.generated.h"
@@ -44,6 +46,9 @@ struct FMC_ViewpointTrace;
 struct FMC_Viewpoint;
 struct FMC_AvatarActor;
 
+// Perception events collected during one run of the operation.
+using FVPTEventBuffer = TArray<FMC_PerceptionEvent, FMantleScratchAllocator>;
+
 /**
  * Args to pass to DrawDebugSphere().
  */
@@ -65,18 +70,21 @@ struct FVPTDebugSphereData
 /**
  * ViewpointTrace Mantle operation. For each entity, performs a line trace from that entity's "viewpoint".
  *
- * Options such as the scan rate can be configured on a per-entity basis using the MC_ViewpointTrace component.
+ * Options such as the scan rate can be configured on a per-entity basis using the MC_ViewpointTrace component. Entities
+ * with bAsyncTrace enabled submit async traces, and their events are emitted when the results are collected on the
+ * operation's next run. Async traces can only be submitted and collected on the game thread, so those entities are
+ * handled in a deferred command (see FMantleOperationContext::Defer), while everything else can run on any thread.
  *
- * This operation outputs temporary perception event entities that can be consumed by downstream systems. These events
- * are produced when the line trace detects an actor in the world with a MantleAvatarComponent, which indicates that the
- * Actor in question represents some entity in the Mantle engine.
+ * This operation writes perception events to the FMC_PerceptionEvent event channel (see UMantleDB::GetEventChannel),
+ * where they can be read by downstream systems on the next frame. These events are produced when the line trace detects
+ * an actor in the world that is the avatar of some entity in the Mantle engine.
  *
  * Input Entity Composition:
  *   + MC_Avatar
  *   + MC_Viewpoint
  *   + MC_ViewpointTrace
  *   
- * Output Entity Composition:
+ * Unless bEmitEventEntities is cleared, each event is also emitted as a temporary entity composed of:
  *   + MC_PerceptionEvent
  *   + MC_ViewpointTraceEvent
  *   + MC_TemporaryEntity
@@ -86,30 +94,71 @@ UCLASS()
 class MANTLERUNTIME_API UMO_ViewpointTrace : public UMantleOperation
 {
 	GENERATED_BODY()
+
+public:
+	// Consumers that have moved to the FMC_PerceptionEvent channel can clear this to skip spawning the event entities.
+	bool bEmitEventEntities = true;
 	
 protected:
 	//~UMantleOperation Interface
 	virtual void Initialize() override;
 	virtual void PerformOperation(FMantleOperationContext& Ctx) override;
 	//~End UMantleOperation Interface
+
+	// Runs the traces for every entity whose bAsyncTrace option matches bAsyncTraces. Returns true if any entities were
+	// skipped because it didn't.
+	bool TraceEntities(FMantleOperationContext& Ctx, bool bAsyncTraces);
 	
 	void PerformLineTrace(
 		FMantleOperationContext& Ctx,
 		FGuid& SourceEntity,
-		FMC_AvatarActor& Avatar,
-		FMC_Viewpoint& Viewpoint,
+		const FMC_AvatarActor& Avatar,
+		const FMC_Viewpoint& Viewpoint,
+		FMC_ViewpointTrace& TraceOptions,
+		FVPTDebugSphereData& DebugSphereData,
+		FVPTEventBuffer* OutEvents
+	);
+	void SubmitAsyncLineTrace(
+		FMantleOperationContext& Ctx,
+		const FMC_AvatarActor& Avatar,
+		const FMC_Viewpoint& Viewpoint,
+		FMC_ViewpointTrace& TraceOptions
+	);
+	
+	// Returns false if the trace is still in flight.
+	bool CollectAsyncLineTrace(
+		FMantleOperationContext& Ctx,
+		FGuid& SourceEntity,
 		FMC_ViewpointTrace& TraceOptions,
+		FVPTEventBuffer* OutEvents
+	);
+	void ProcessTraceResults(
+		FMantleOperationContext& Ctx,
+		FGuid& SourceEntity,
+		FMC_ViewpointTrace& TraceOptions,
+		const TArray<FHitResult>& TraceResults,
+		const FVector& TraceEndPoint,
 		FVPTDebugSphereData& DebugSphereData,
-		TArray<FMC_PerceptionEvent>* OutEvents
+		FVPTEventBuffer* OutEvents
 	);
 	void EmitPerceptionEvents(
 		FMantleOperationContext& Ctx,
-		TArray<FMC_PerceptionEvent>& EventsToEmit,
+		TConstArrayView<FMC_PerceptionEvent> EventsToEmit,
 		FInstancedStruct& SourceFilter
 	);
 	void DrawDebugGeometry(FMantleOperationContext& Ctx, FVPTDebugSphereData& DebugSphereData);
+	bool IsCoherentWithLastTrace(
+		FMantleOperationContext& Ctx,
+		const FMC_Viewpoint& Viewpoint,
+		FMC_ViewpointTrace& TraceOptions,
+		double CurrentTimeSec
+	);
+	void GetTraceSegment(
+		const FMC_Viewpoint& Viewpoint, FMC_ViewpointTrace& TraceOptions, FVector& OutStart, FVector& OutEnd);
+	FCollisionQueryParams MakeTraceQueryParams(const FMC_AvatarActor& Avatar);
 
 	//~UMO_ViewpointTrace Interface
+	// Overrides should also declare access to their trace component in ComponentAccess.
 	virtual void AddRequiredTraceComponent(FMantleComponentQuery& Query);
 	virtual void LoadTraceData(FMantleIterator& Iterator);
 	virtual FMC_ViewpointTrace& GetTraceOptions(int32 EntityIndex);
@@ -169,3 +169,18 @@ struct FFakeEmptyComponent : public FMantleTestComponent
 {
 	GENERATED_BODY()
 };
+
+// Counts how many instances are currently alive, so tests can check that the DB destroys components.
+USTRUCT()
+struct FFakeLifetimeComponent : public FMantleTestComponent
+{
+	GENERATED_BODY()
+
+public:
+	FFakeLifetimeComponent() { ++NumAlive; }
+	FFakeLifetimeComponent(const FFakeLifetimeComponent& Other) { ++NumAlive; }
+	FFakeLifetimeComponent& operator=(const FFakeLifetimeComponent& Other) = default;
+	~FFakeLifetimeComponent() { --NumAlive; }
+
+	static inline int32 NumAlive = 0;
+};
@@ -0,0 +1,136 @@
+// Copyright © Mason Stevenson
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted (subject to the limitations in the disclaimer
+// below) provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+// THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+// CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+// NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+// PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "Containers/Array.h"
+#include "Foundation/MantleAsyncOperation.h"
+#include "Foundation/MantleOperation.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Testing/Fakes/FakeMantleComponents.h"
+#include "UObject/UObjectGlobals.h"
+
+#include <atomic>
+
+#include "FakeMantleOperations.generated.h"
+
+// Records how many fake operations are running at the same time, and the order their deferred commands run in. Each run
+// waits (briefly) for another operation to start, so operations that are allowed to overlap reliably do.
+UCLASS()
+class UFakeConcurrentOperation : public UMantleOperation
+{
+	GENERATED_BODY()
+
+public:
+	FMantleComponentAccess& GetMutableComponentAccess()
+	{
+		return ComponentAccess;
+	}
+
+	static void ResetCounters()
+	{
+		NumRunning = 0;
+		MaxRunning = 0;
+		PlaybackOrder.Reset();
+	}
+
+	int32 OperationId = 0;
+	
+	static inline std::atomic<int32> NumRunning{0};
+	static inline std::atomic<int32> MaxRunning{0};
+
+	// Only written by deferred commands, which run on the game thread.
+	static inline TArray<int32> PlaybackOrder;
+
+protected:
+	virtual void PerformOperation(FMantleOperationContext& Ctx) override
+	{
+		const int32 Running = ++NumRunning;
+		int32 PreviousMax = MaxRunning.load();
+		while (PreviousMax < Running && !MaxRunning.compare_exchange_weak(PreviousMax, Running))
+		{
+		}
+
+		const double GiveUpTimeSec = FPlatformTime::Seconds() + 0.2;
+		while (MaxRunning.load() < 2 && FPlatformTime::Seconds() < GiveUpTimeSec)
+		{
+			FPlatformProcess::Yield();
+		}
+
+		--NumRunning;
+
+		Ctx.Defer([OperationId = OperationId](UMantleDB& MantleDB)
+		{
+			PlaybackOrder.Add(OperationId);
+		});
+	}
+};
+
+// Renames TargetEntity's FFakeItemComponent to "Launch<N>" from an async task, where N counts the launches. While
+// bHoldTasks is set, tasks keep running (for up to a few seconds), so tests can tick the engine with one in flight.
+UCLASS()
+class UFakeAsyncOperation : public UMantleAsyncOperation
+{
+	GENERATED_BODY()
+
+public:
+	void SetMaxResultAgeFrames(int32 NewMaxResultAgeFrames)
+	{
+		MaxResultAgeFrames = NewMaxResultAgeFrames;
+	}
+
+	FGuid TargetEntity;
+	int32 NumLaunches = 0;
+
+	static inline std::atomic<bool> bHoldTasks{false};
+
+protected:
+	virtual FMantleAsyncTask LaunchTask(FMantleOperationContext& Ctx, FMantleAsyncCommandBuffer& Results) override
+	{
+		NumLaunches++;
+		Results.TrackEntity(*Ctx.MantleDB, TargetEntity);
+
+		return [EntityId = TargetEntity, NewName = FString::Printf(TEXT("Launch%d"), NumLaunches)](
+			FMantleAsyncCommandBuffer& TaskResults)
+		{
+			const double GiveUpTimeSec = FPlatformTime::Seconds() + 5.0;
+			while (bHoldTasks.load() && FPlatformTime::Seconds() < GiveUpTimeSec)
+			{
+				FPlatformProcess::Yield();
+			}
+
+			TaskResults.UpdateComponent<FFakeItemComponent>(EntityId, [NewName](FFakeItemComponent& Item)
+			{
+				Item.Name = NewName;
+			});
+		};
+	}
+};